@@ -0,0 +1,73 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Per-operation overhead of replaying a sequence, with and without CompiledSequence
+*/
+
+#include "tenzing/compiled_sequence.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// a host operation that does the least possible work
+class Count : public CpuOp {
+  std::string name_;
+  size_t *count_;
+
+public:
+  Count(const std::string &name, size_t *count) : name_(name), count_(count) {}
+  void run(Platform & /*plat*/) override { ++*count_; }
+  std::string name() const override { return name_; }
+  bool operator<(const Count &rhs) const { return name_ < rhs.name_; }
+  bool operator==(const Count &rhs) const { return name_ == rhs.name_; }
+  CLONE_DEF(Count);
+  LT_DEF(Count);
+  EQ_DEF(Count);
+};
+
+template <typename F> double time_ns(F f, int reps) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / reps;
+}
+
+int main(void) {
+  Platform plat(MPI_COMM_WORLD); // CPU operations only, so no streams or events
+
+  std::printf("ops,kind,run each (ns/op),compiled (ns/op)\n");
+  for (size_t n : {10, 100, 1000}) {
+    size_t count = 0;
+    Sequence<BoundOp> noops, hosts;
+    for (size_t i = 0; i < n; ++i) {
+      noops.push_back(std::make_shared<NoOp>("noop" + std::to_string(i)));
+      hosts.push_back(std::make_shared<Count>("count" + std::to_string(i), &count));
+    }
+
+    const int reps = 1000000 / n;
+    for (const Sequence<BoundOp> *seq : {&noops, &hosts}) {
+      const CompiledSequence cs = CompiledSequence::compile(*seq, plat);
+      double each = time_ns(
+          [&]() {
+            for (const std::shared_ptr<BoundOp> &op : *seq) {
+              op->run(plat);
+            }
+          },
+          reps);
+      double compiled = time_ns([&]() { cs.run(plat); }, reps);
+      std::printf("%zu,%s,%.2f,%.2f\n", n, seq == &noops ? "NoOp" : "host", each / n,
+                  compiled / n);
+    }
+    if (0 == count) {
+      std::printf("unexpected zero count\n");
+    }
+  }
+}
@@ -0,0 +1,196 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Compare Graph clone, replace, and lookup against the map-of-sets storage it replaced,
+    and pointer lookups against the linear scan they replaced
+*/
+
+#include "tenzing/graph.hpp"
+#include "tenzing/operation.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+typedef std::shared_ptr<OpBase> op_t;
+
+/* OpBase::compare_lt as it was before operations were interned (LT_DEF):
+   order by type tag, then downcast the right side and compare with the type's operator<
+*/
+struct LegacyLt {
+  template <typename T> static bool lt_as(const op_t &a, const op_t &b) {
+    const auto rp = std::dynamic_pointer_cast<const T>(b);
+    if (!rp) {
+      throw std::runtime_error("LegacyLt: " + a->name() + " <? " + b->name());
+    }
+    return static_cast<const T &>(*a) < *rp;
+  }
+
+  bool operator()(const op_t &a, const op_t &b) const {
+    const OpBase &ra = *a, &rb = *b;
+    // tag() was typeid(*this).hash_code() narrowed to an int
+    const int ta = int(typeid(ra).hash_code()), tb = int(typeid(rb).hash_code());
+    if (ta != tb) {
+      return ta < tb;
+    }
+    // LT_DEF was a virtual member of each type: dispatch on the left side's type
+    if (typeid(ra) == typeid(NoOp)) {
+      return lt_as<NoOp>(a, b);
+    } else if (typeid(ra) == typeid(Start)) {
+      return lt_as<Start>(a, b);
+    } else if (typeid(ra) == typeid(Finish)) {
+      return lt_as<Finish>(a, b);
+    }
+    throw std::runtime_error("LegacyLt: unexpected type " + a->name());
+  }
+};
+
+/* the storage Graph<T> used before vertex ids:
+   each op maps to a set of successors and a set of predecessors, all ordered by the old OpBase::lt
+*/
+struct MapGraph {
+  typedef std::set<op_t, LegacyLt> OpSet;
+  typedef std::map<op_t, OpSet, LegacyLt> OpMap;
+  OpMap succs_;
+  OpMap preds_;
+
+  void then(const op_t &a, const op_t &b) {
+    succs_[a].insert(b);
+    succs_[b];
+    preds_[a];
+    preds_[b].insert(a);
+  }
+
+  MapGraph clone_but_replace(const op_t &dst, const op_t &src) const {
+    std::map<op_t, op_t, LegacyLt> clones;
+    for (auto &kv : succs_) {
+      clones[kv.first] = src == kv.first ? dst : op_t(kv.first->clone());
+    }
+    MapGraph ret;
+    for (auto &kv : clones) {
+      for (const op_t &os : succs_.at(kv.first)) {
+        ret.then(kv.second, clones[os]);
+      }
+    }
+    return ret;
+  }
+};
+
+std::vector<op_t> make_ops(size_t n) {
+  std::vector<op_t> ops;
+  for (size_t i = 0; i < n; ++i) {
+    ops.push_back(std::make_shared<NoOp>("noop" + std::to_string(i)));
+  }
+  return ops;
+}
+
+// how Graph::preds(T*) and friends used to find a vertex
+Graph<OpBase>::vid_t scan_ptr(const Graph<OpBase> &graph, const OpBase *tp) {
+  for (Graph<OpBase>::vid_t v : graph.vertices()) {
+    if (graph.op(v).get() == tp) {
+      return v;
+    }
+  }
+  return Graph<OpBase>::npos;
+}
+
+template <typename F> double time_us(F f, int reps) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(stop - start).count() / reps;
+}
+
+int main(void) {
+  const size_t width = 10;
+
+  std::printf("vertices,map clone (us),graph clone (us),map replace (us),graph replace (us),map "
+              "lookup (us),graph lookup (us),scan pointer (us),graph pointer (us)\n");
+  for (size_t n : {100, 1000, 10000}) {
+    std::vector<op_t> ops = make_ops(n);
+
+    // a layered DAG, `width` ops per layer, each op depending on two ops in the previous layer
+
+    Graph<OpBase> graph;
+    MapGraph mapGraph;
+    for (size_t i = 0; i < n; ++i) {
+      if (i < width) {
+        graph.start_then(ops[i]);
+        mapGraph.then(graph.start(), ops[i]);
+      } else {
+        size_t layer = i / width - 1;
+        const op_t &a = ops[layer * width + i % width];
+        const op_t &b = ops[layer * width + (i + 1) % width];
+        graph.then(a, ops[i]);
+        graph.then(b, ops[i]);
+        mapGraph.then(a, ops[i]);
+        mapGraph.then(b, ops[i]);
+      }
+      if (i + width >= n) {
+        graph.then_finish(ops[i]);
+        mapGraph.then(ops[i], graph.finish());
+      }
+    }
+
+    const int reps = n > 1000 ? 10 : 100;
+    double mapClone = time_us([&]() { mapGraph.clone_but_replace(nullptr, nullptr); }, reps);
+    double graphClone = time_us([&]() { graph.clone(); }, reps);
+
+    // replace one op with a different op, as SDP::State::apply does for a ChooseOp.
+    // (binding an op to a stream is cheaper, since the index is not copied)
+    op_t replacement = std::make_shared<NoOp>("replacement");
+    double mapReplace =
+        time_us([&]() { mapGraph.clone_but_replace(replacement, ops[n / 2]); }, reps);
+    double graphReplace = time_us([&]() { graph.clone_but_replace(replacement, ops[n / 2]); }, reps);
+
+    // look up every op and walk its successors
+    size_t sink = 0;
+    double mapLookup = time_us(
+        [&]() {
+          for (const op_t &op : ops) {
+            sink += mapGraph.succs_.find(op)->second.size();
+          }
+        },
+        reps);
+    double graphLookup = time_us(
+        [&]() {
+          for (const op_t &op : ops) {
+            sink += graph.succs(graph.find_or_find_unbound(op)).size();
+          }
+        },
+        reps);
+
+    // find every op's vertex by pointer, as Graph::preds(T*) and Graph::erase(T*) do
+    double scanPointer = time_us(
+        [&]() {
+          for (const op_t &op : ops) {
+            sink += scan_ptr(graph, op.get());
+          }
+        },
+        n > 1000 ? 1 : reps);
+    double graphPointer = time_us(
+        [&]() {
+          for (const op_t &op : ops) {
+            sink += graph.find_ptr(op.get());
+          }
+        },
+        reps);
+
+    std::printf("%zu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", graph.vertex_size(), mapClone,
+                graphClone, mapReplace, graphReplace, mapLookup, graphLookup, scanPointer,
+                graphPointer);
+    if (0 == sink) {
+      std::printf("unexpected empty graph\n");
+    }
+  }
+}
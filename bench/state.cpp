@@ -0,0 +1,142 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Compare SDP::State::apply against the exception-driven dispatch it replaced
+*/
+
+#include "tenzing/decision.hpp"
+#include "tenzing/graph.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/state.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/* the Decision class hierarchy State::apply used to dispatch on,
+   by trying each dynamic_cast<const T&> in turn and catching std::bad_cast
+*/
+struct LegacyDecision {
+  virtual ~LegacyDecision() {}
+};
+template <typename D> struct Legacy : public LegacyDecision {
+  D d;
+  Legacy(const D &_d) : d(_d) {}
+};
+
+SDP::State legacy_apply(const SDP::State &state, const LegacyDecision &ld) {
+  try {
+    return state.apply(dynamic_cast<const Legacy<ExecuteOp> &>(ld).d);
+  } catch (std::bad_cast &) {
+    // pass
+  }
+  try {
+    return state.apply(dynamic_cast<const Legacy<ExpandOp> &>(ld).d);
+  } catch (std::bad_cast &) {
+    // pass
+  }
+  try {
+    return state.apply(dynamic_cast<const Legacy<AssignOpStream> &>(ld).d);
+  } catch (std::bad_cast &) {
+    // pass
+  }
+  try {
+    return state.apply(dynamic_cast<const Legacy<ChooseOp> &>(ld).d);
+  } catch (std::bad_cast &) {
+    // pass
+  }
+  THROW_RUNTIME("failed to apply decision, unexpected Decision type");
+}
+
+class Kernel : public GpuOp {
+  std::string name_;
+
+public:
+  Kernel(const std::string &name) : name_(name) {}
+  void run(cudaStream_t) override {}
+  std::string name() const override { return name_; }
+  bool operator<(const Kernel &rhs) const { return name_ < rhs.name_; }
+  bool operator==(const Kernel &rhs) const { return name_ == rhs.name_; }
+  CLONE_DEF(Kernel);
+  LT_DEF(Kernel);
+  EQ_DEF(Kernel);
+};
+
+class Choice : public ChoiceOp {
+  std::string name_;
+
+public:
+  Choice(const std::string &name) : name_(name) {}
+  std::vector<std::shared_ptr<OpBase>> choices() const override {
+    return {std::make_shared<NoOp>(name_ + "-a"), std::make_shared<NoOp>(name_ + "-b")};
+  }
+  std::string name() const override { return name_; }
+  bool operator<(const Choice &rhs) const { return name_ < rhs.name_; }
+  bool operator==(const Choice &rhs) const { return name_ == rhs.name_; }
+  CLONE_DEF(Choice);
+  LT_DEF(Choice);
+  EQ_DEF(Choice);
+};
+
+template <typename F> double time_us(F f, int reps) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(stop - start).count() / reps;
+}
+
+int main(void) {
+  std::printf("vertices,decision,legacy apply (us),apply (us)\n");
+  for (size_t n : {10, 100, 1000}) {
+
+    // start -> noop, kernel, choice, and n other noops -> finish
+    Graph<OpBase> graph;
+    auto noop = std::make_shared<NoOp>("noop");
+    auto kernel = std::make_shared<Kernel>("kernel");
+    auto choice = std::make_shared<Choice>("choice");
+    for (const std::shared_ptr<OpBase> &op :
+         std::vector<std::shared_ptr<OpBase>>{noop, kernel, choice}) {
+      graph.start_then(op);
+      graph.then_finish(op);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      auto op = std::make_shared<NoOp>("noop" + std::to_string(i));
+      graph.start_then(op);
+      graph.then_finish(op);
+    }
+    SDP::State state(graph);
+
+    struct Case {
+      const char *name;
+      Decision decision;
+      std::shared_ptr<LegacyDecision> legacy;
+    };
+    ExecuteOp execute(noop);
+    AssignOpStream assign(kernel, Stream(0));
+    ChooseOp choose(choice, choice->choices()[0]);
+    std::vector<Case> cases{
+        {"execute", execute, std::make_shared<Legacy<ExecuteOp>>(execute)},
+        {"assign", assign, std::make_shared<Legacy<AssignOpStream>>(assign)},
+        {"choose", choose, std::make_shared<Legacy<ChooseOp>>(choose)},
+    };
+
+    const int reps = n > 100 ? 1000 : 10000;
+    size_t sink = 0;
+    for (const Case &c : cases) {
+      double legacy =
+          time_us([&]() { sink += legacy_apply(state, *c.legacy).sequence().size(); }, reps);
+      double visit = time_us([&]() { sink += state.apply(c.decision).sequence().size(); }, reps);
+      std::printf("%zu,%s,%.2f,%.2f\n", graph.vertex_size(), c.name, legacy, visit);
+    }
+    if (0 == sink) {
+      std::printf("unexpected empty sequence\n");
+    }
+  }
+}
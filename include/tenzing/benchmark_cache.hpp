@@ -0,0 +1,181 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Reuse benchmark results across searches and runs
+*/
+
+#pragma once
+
+#include "tenzing/benchmarker.hpp"
+#include "tenzing/graph.hpp"
+#include "tenzing/platform.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <limits>
+#include <map>
+#include <string>
+
+/*! \brief identifies the problem and machine a result was measured for
+
+    A hash of the graph's operation names and edges, the number of streams in the platform, the
+    number of ranks, and `tag` (e.g. a machine name)
+*/
+std::string benchmark_signature(const Graph<OpBase> &g, const Platform &plat,
+                                const std::string &tag = "");
+
+/*! \brief results by canonical_sequence(), for one signature, persisted in a file
+
+    The file has one JSON object per line, and is only appended to. Lines for other signatures
+    are ignored, so one file can hold results for many problems. A line cut short by an
+    interrupted write is skipped, and ended before the next line is appended.
+    Results for the same sequence are merged: each percentile and the variance are averaged,
+    weighted by the number of iterations that produced them. Why racing stopped, and its estimate
+    and best, are those of the latest result.
+*/
+class BenchmarkCache {
+public:
+  struct Entry {
+    Benchmark::Result result;
+    size_t nIters;  // how many iterations the result summarizes
+    double racePct; // the percentile the latest result was raced on, 0 if it wasn't
+  };
+
+  /*! \brief load the results for `signature` from `path`, if it exists. Empty `path` keeps
+      results in memory only
+  */
+  BenchmarkCache(const std::string &path, const std::string &signature);
+
+  /// the merged result for key, or nullptr
+  const Entry *find(const std::string &key) const;
+
+  /*! \brief merge `result` from `nIters` iterations, raced on the `racePct` percentile, into key,
+      and append it to the file
+  */
+  const Entry &insert(const std::string &key, const Benchmark::Result &result, size_t nIters,
+                      double racePct = 0);
+
+  size_t size() const { return entries_.size(); }
+
+private:
+  static void merge(Entry &dst, const Benchmark::Result &result, size_t nIters, double racePct);
+
+  std::string path_;
+  std::string signature_;
+  std::map<std::string, Entry> entries_;
+};
+
+namespace caching_benchmarker {
+// the best percentile `inner` has raced against, or infinity if it doesn't race
+template <typename Inner> auto best(const Inner &inner, int) -> decltype(double(inner.best())) {
+  return inner.best();
+}
+template <typename Inner> double best(const Inner &, long) {
+  return std::numeric_limits<double>::infinity();
+}
+
+// race the sequences `inner` measures later against `estimate` too, if it races
+template <typename Inner>
+auto observe(Inner &inner, double estimate, int) -> decltype(inner.observe(estimate)) {
+  return inner.observe(estimate);
+}
+template <typename Inner> void observe(Inner &, double, long) {}
+} // namespace caching_benchmarker
+
+/*! \brief a benchmarker that answers from a BenchmarkCache, and asks `Inner` otherwise
+
+    A sequence whose cached results come from at least `opts.nIters` iterations is not run again.
+    Nor is one whose latest run was stopped by racing on the same percentile, if it converged, or
+    if it was worse than a best time that the inner benchmarker has matched since.
+    Otherwise, it is benchmarked by the inner benchmarker and the new result merged into the cache,
+    counted as the Result::nIters measurements it summarizes. A result with an unknown count (0)
+    is counted as `opts.nIters`.
+    The returned Result::nIters is that of the merged result.
+
+    A cached estimate of the raced percentile is passed to `Inner::observe()`, if it has one, so
+    later sequences race against it as if the inner benchmarker had measured it.
+
+    Rank 0 decides and broadcasts the result, so all ranks agree on whether to run the benchmark.
+    Only rank 0 writes the file.
+*/
+template <typename Inner> class CachingBenchmarker : public Benchmark {
+public:
+  CachingBenchmarker(Inner &inner, const std::string &path, const std::string &signature)
+      : inner_(inner), cache_(path, signature), hits_(0), misses_(0) {}
+
+  Result benchmark(Sequence<BoundOp> &order, Platform &plat, const Opts &opts = Opts()) {
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    int rank = 0;
+    if (initialized) {
+      MPI_Comm_rank(plat.comm(), &rank);
+    }
+
+    const std::string key = canonical_sequence(order);
+    int hit = 0;
+    double observed = std::numeric_limits<double>::infinity(); // a cached estimate to race against
+    Result result;
+    if (0 == rank) {
+      const BenchmarkCache::Entry *entry = cache_.find(key);
+      if (entry && (entry->nIters >= opts.nIters || raced_final(*entry, opts))) {
+        hit = 1;
+        result = entry->result;
+        result.nIters = entry->nIters;
+        if (opts.racing.pct > 0 && entry->racePct == opts.racing.pct &&
+            Racing::Verdict::worse != entry->result.stopped) {
+          observed = entry->result.estimate;
+        }
+      }
+    }
+    if (initialized) {
+      MPI_Bcast(&hit, 1, MPI_INT, 0, plat.comm());
+      MPI_Bcast(&observed, 1, MPI_DOUBLE, 0, plat.comm());
+    }
+
+    if (hit) {
+      ++hits_;
+      caching_benchmarker::observe(inner_, observed, 0);
+    } else {
+      ++misses_;
+      result = inner_.benchmark(order, plat, opts);
+      if (0 == rank) {
+        const BenchmarkCache::Entry &entry = cache_.insert(
+            key, result, result.nIters ? result.nIters : opts.nIters, opts.racing.pct);
+        result = entry.result;
+        result.nIters = entry.nIters;
+      }
+    }
+    if (initialized) {
+      MPI_Bcast(&result, sizeof(result), MPI_BYTE, 0, plat.comm());
+    }
+    return result;
+  }
+
+  const BenchmarkCache &cache() const { return cache_; }
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+private:
+  // whether racing with `opts` would stop the sequence where its latest run stopped
+  bool raced_final(const BenchmarkCache::Entry &entry, const Opts &opts) const {
+    if (0 == opts.racing.pct || entry.racePct != opts.racing.pct) {
+      return false;
+    }
+    switch (entry.result.stopped) {
+    case Racing::Verdict::converged:
+      return true;
+    case Racing::Verdict::worse:
+      // the best only improves, so it is worse than this one too
+      return caching_benchmarker::best(inner_, 0) <= entry.result.best;
+    default:
+      return false;
+    }
+  }
+
+  Inner &inner_;
+  BenchmarkCache cache_;
+  size_t hits_;
+  size_t misses_;
+};
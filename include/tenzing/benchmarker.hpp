@@ -5,13 +5,50 @@
 
 #pragma once
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "tenzing/schedule.hpp"
 #include "tenzing/sequence.hpp"
 
+class ResultFile;
+class Trace;
+
 struct Benchmark {
+  /* when to stop measuring a schedule before nIters
+
+     After each measurement (from the minIters-th on), a distribution-free confidence interval of
+     the pct-th percentile is made from the order statistics of the times so far. Measuring stops
+     when the interval is entirely slower than the best time so far, or narrower than relWidth of
+     the estimate.
+  */
+  struct Racing {
+    enum class Verdict { more, worse, converged };
+
+    double pct;      // which percentile, e.g. 10 for pct10. 0 always runs nIters
+    size_t minIters; // measurements before the first test
+    double z;        // half-width of the intervals in standard deviations (1.96 is 95%)
+    double relWidth; // precise enough when the interval is this fraction of the estimate
+
+    Racing() : pct(0), minIters(10), z(1.96), relWidth(0.01) {}
+
+    // whether to keep measuring, given the times so far in order, and the best pct-th percentile
+    Verdict verdict(const std::vector<double> &sorted, double best) const;
+
+    // add t to `sorted` in order, so each verdict doesn't sort all the times again
+    static void insert(std::vector<double> &sorted, double t);
+
+    /* the pct-th percentile of `sorted`, and the bounds of its confidence interval
+     */
+    static double interval(const std::vector<double> &sorted, double pct, double z, double *lo,
+                           double *hi);
+  };
+
   struct Result {
     double pct01;
     double pct10;
@@ -19,26 +56,120 @@ struct Benchmark {
     double pct90;
     double pct99;
     double stddev;
+    size_t nIters; // how many measurements this summarizes, 0 if unknown
+
+    // with racing, why measuring stopped (`more` if it ran out of nIters), the estimate of the
+    // raced percentile, and the best one it was raced against. Otherwise `more`, 0, and 0
+    Racing::Verdict stopped;
+    double estimate;
+    double best;
+
+    Result()
+        : pct01(0), pct10(0), pct50(0), pct90(0), pct99(0), stddev(0), nIters(0),
+          stopped(Racing::Verdict::more), estimate(0), best(0) {}
   };
 
   struct Opts {
     size_t nIters;
     size_t maxRetries; // 0 is unlimited
+    Trace *trace;      // if not null, record each operation's time of every run into it
+    Racing racing;
 
-    Opts() : nIters(1000), maxRetries(10) {}
+    Opts() : nIters(1000), maxRetries(10), trace(nullptr) {}
   };
+
+  /* percentiles and standard deviation of times, which are sorted in place, and their count
+   */
+  static Result summarize(std::vector<double> &times);
 };
 
 /* actually run the code to do the benchmark
+
+   With opts.racing, a sequence is compared against the best percentile this benchmarker has
+   measured so far, and may return after fewer than nIters measurements.
  */
 struct EmpiricalBenchmarker : public Benchmark {
+  EmpiricalBenchmarker();
+
   Result benchmark(Sequence<BoundOp> &order, Platform &plat,
                    const Benchmark::Opts &opts = Benchmark::Opts());
   std::vector<Result> benchmark(std::vector<Schedule> &schedules, Platform &plat,
                                 const Benchmark::Opts &opts = Benchmark::Opts());
+
+  // the best percentile measured with racing, or infinity
+  double best() const { return best_; }
+  // race later sequences against `estimate` too, e.g. the percentile of a cached result
+  void observe(double estimate) { best_ = std::min(best_, estimate); }
+  // measurements made, and sequences stopped early because they were worse
+  size_t measurements() const { return measurements_; }
+  size_t stopped() const { return stopped_; }
+
+private:
+  double best_;
+  size_t measurements_;
+  size_t stopped_;
+};
+
+/* simulate running the code on a model of the host, streams, events, and MPI
+
+   A discrete-event simulation of one rank issuing the sequence:
+   - the host issues operations in order, spending `launch` on each GPU or event operation,
+     and `cpu` (or the time in `times`) on every other operation
+   - each stream runs its GPU operations in order, each for `gpu` (or the time in `times`),
+     on one of `slots` execution slots of the device (0 is unlimited)
+   - CudaEventRecord, CudaStreamWaitEvent, and StreamWait order streams, and CudaEventSync and
+     StreamSync block the host, as CUDA does
+   - every rank runs the same sequence, so the n-th Isend to a peer is matched by the peer's n-th
+     Irecv from this rank with the same tag and communicator, which the peer posts when this rank
+     posts its own n-th such Irecv. A message completes `mpiLatency` plus its size over
+     `mpiBandwidth` after both are posted. An Irecv with no matching Isend in the sequence was
+     sent at time 0. Ialltoallv takes `mpiLatency`
+   - Wait, MultiWait, and OwningWaitall block the host until their requests are complete
+   - other operations, including the SpMV PostSend, PostRecv, WaitSend, and WaitRecv, only take
+     host time, and their MPI requests are not modeled
+
+   The time of a run is when the host and all streams are done. Each of the `nIters` runs scales
+   every duration by a normally-distributed factor with mean 1 and standard deviation `noise`.
+   Start, Finish, and NoOp take no time.
+*/
+struct SimulatedBenchmarker : public Benchmark {
+  struct Model {
+    double launch; // host time to issue a GPU, event record, or stream wait operation
+    double gpu;    // device time of a GPU operation not in `times`
+    double cpu;    // host time of a CPU operation not in `times`
+    double sync;   // host time of a CudaEventSync or StreamSync, after the wait
+    double mpiLatency;
+    double mpiBandwidth; // bytes per second
+    size_t slots;        // GPU operations that can run at once, 0 for unlimited
+    double noise;
+    std::map<std::string, double> times; // duration of operations by name
+
+    Model()
+        : launch(5e-6), gpu(10e-6), cpu(1e-6), sync(1e-6), mpiLatency(2e-6), mpiBandwidth(10e9),
+          slots(0), noise(0) {}
+  };
+
+  SimulatedBenchmarker(const Model &model = Model(), unsigned seed = 0)
+      : model_(model), rng_(seed) {}
+  Result benchmark(Sequence<BoundOp> &order, Platform &plat,
+                   const Benchmark::Opts &opts = Benchmark::Opts());
+
+  /* the time of one run of `order`, with durations scaled by `noise`
+   */
+  double simulate(const Sequence<BoundOp> &order);
+
+  const Model &model() const { return model_; }
+
+private:
+  Model model_;
+  std::mt19937 rng_;
 };
 
 /* find the results in a loaded database and return them
+
+   Rows are indexed by a hash of canonical_sequence(), so a lookup only compares against rows that
+   could be equivalent instead of scanning the whole file. A ResultFile stays mapped and is indexed
+   from its integer cells; a row's operations are only gathered up to compare against it.
  */
 struct CsvBenchmarker : public Benchmark {
 
@@ -48,11 +179,19 @@ struct CsvBenchmarker : public Benchmark {
     DataRow(const Result &result, const Sequence<BoundOp> &sequence) : res(result), seq(sequence) {}
   };
 
-  // what CSV file to read in and what graph to pull the operations from
+  // what CSV or ResultFile to read in and what graph to pull the operations from
   CsvBenchmarker(const std::string &path, const Graph<OpBase> &g);
   Result benchmark(Sequence<BoundOp> &order, Platform &plat,
                    const Benchmark::Opts &opts = Benchmark::Opts());
 
   // csv data with operations pulled from the graph (to replace data_)
   std::vector<DataRow> data_;
+
+  // a ResultFile, read in place of data_
+  std::shared_ptr<ResultFile> file_;
+  // each operation in file_, pulled from the graph
+  std::vector<std::shared_ptr<BoundOp>> fileOps_;
+
+  // rows in data_ or file_ by hashed canonical_sequence(), in file order
+  std::unordered_map<size_t, std::vector<size_t>> index_;
 };
\ No newline at end of file
@@ -1,26 +1,23 @@
 #pragma once
 
 template <typename T> class Bijection {
-  std::map<T, T> map_;
+  std::map<T, T> map_; // a -> b
+  std::map<T, T> inv_; // b -> a
 
 public:
   bool check_or_insert(const T &a, const T &b) {
 
     // STDERR("look up " << a << " -> " << b);
-    const size_t ca = map_.count(a);
-    const size_t cb = map_.count(b);
-
-    // does not contain
-    if (0 == ca && 0 == cb) {
-      //   STDERR("insert " << a << " <-> " << b);
+    auto ai = map_.find(a);
+    if (map_.end() != ai) {
+      return ai->second == b;
+    } else if (inv_.count(b)) { // something else already maps to b
+      return false;
+    } else {
+      //   STDERR("insert " << a << " -> " << b);
       map_.insert(std::make_pair(a, b));
-      map_.insert(std::make_pair(b, a));
+      inv_.insert(std::make_pair(b, a));
       return true;
-    } else if (0 != ca && 0 != cb) {
-      //   STDERR("check " << b << " <-> " << a);
-      return map_.at(b) == a && map_.at(a) == b;
-    } else {
-      return false;
     }
   }
 
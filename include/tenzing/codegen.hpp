@@ -0,0 +1,46 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Generate standalone C++ source that runs a chosen schedule
+*/
+
+#pragma once
+
+#include "tenzing/graph.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <string>
+
+namespace codegen {
+
+struct Opts {
+  std::string name; // name of the generated function, must be a C++ identifier
+
+  Opts() : name("tenzing_schedule") {}
+};
+
+/*! \brief C++ source for a header that runs `seq` with no dependence on tenzing
+
+    The header only includes <cuda_runtime.h>, and defines, for `opts.name` of `run`:
+    \code
+    cudaError_t run_init();    // create the streams and events the schedule uses
+    cudaError_t run_destroy(); // destroy them
+    template <typename Hooks> cudaError_t run(Hooks &hooks);
+    \endcode
+
+    `run` issues the operations of `seq` in order. The synchronization operations are CUDA runtime
+    calls on the statically allocated streams and events. Every other operation is a call to a
+    user-provided hook with the operation's name:
+    - `hooks.gpu(name, stream)` for a BoundGpuOp
+    - `hooks.cpu(name)` for anything else, except Start and Finish, which are left out
+
+    Every operation that is not a synchronization operation must be in `g`.
+*/
+std::string generate_cpp(const Sequence<BoundOp> &seq, const Graph<OpBase> &g,
+                         const Opts &opts = Opts());
+
+} // namespace codegen
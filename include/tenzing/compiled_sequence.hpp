@@ -0,0 +1,114 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Lower a sequence of operations into a flat array of instructions for replay
+*/
+
+#pragma once
+
+#include "tenzing/cuda/ops_cuda.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/platform.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <vector>
+
+class Trace;
+
+/*! \brief a sequence with its streams and events resolved against a platform
+
+    Running a Sequence<BoundOp> makes a virtual call per operation, and each call looks its streams
+    and events up in the platform again. compile() does the lookups once and lowers each operation
+    into an Instr, which run() dispatches with a switch:
+    - synchronization operations become CUDA runtime calls on the resolved handles
+    - a BoundGpuOp becomes a call of its GpuOp on the resolved stream
+    - Start, Finish, and NoOp do nothing, so they are dropped
+    - any other operation is kept as a call to BoundOp::run
+
+    The platform's streams and events must not change between compile() and run().
+*/
+class CompiledSequence {
+public:
+  struct Instr {
+    enum class Kind {
+      gpu,
+      event_record,
+      stream_wait_event,
+      event_sync,
+      stream_sync,
+      stream_wait,
+      host
+    };
+    Kind kind;
+    cudaStream_t stream; // the stream it is issued to, or the waitee of a stream_wait
+    cudaStream_t waiter; // stream_wait only
+    cudaEvent_t event;
+    GpuOp *gpu;  // gpu only
+    BoundOp *op; // the operation it came from
+  };
+
+  CompiledSequence() = default;
+
+  /*! \brief resolve every operation in `seq` against `plat`
+
+      throws if an operation uses a stream or event `plat` does not have
+  */
+  static CompiledSequence compile(const Sequence<BoundOp> &seq, const Platform &plat);
+
+  /*! \brief the same as running each operation of the sequence in order
+   */
+  void run(Platform &plat) const {
+    for (const Instr &in : instrs_) {
+      exec(in, plat);
+    }
+  }
+
+  /*! \brief run(), recording the time of each instruction in `trace`
+   */
+  void run(Platform &plat, Trace &trace) const;
+
+  const std::vector<Instr> &instrs() const { return instrs_; }
+
+  /// the sequence this was compiled from
+  const Sequence<BoundOp> &sequence() const { return seq_; }
+
+  /// a hash of the instructions' operations, the same for every compile of an equal sequence
+  size_t id() const { return id_; }
+
+private:
+  Sequence<BoundOp> seq_; // keeps the operations alive
+  std::vector<Instr> instrs_;
+  size_t id_ = 0;
+
+  static void exec(const Instr &in, Platform &plat) {
+    switch (in.kind) {
+    case Instr::Kind::gpu:
+      in.gpu->run(in.stream);
+      break;
+    case Instr::Kind::event_record:
+      CUDA_RUNTIME(cudaEventRecord(in.event, in.stream));
+      break;
+    case Instr::Kind::stream_wait_event:
+      CUDA_RUNTIME(cudaStreamWaitEvent(in.stream, in.event, 0 /*flags*/));
+      break;
+    case Instr::Kind::event_sync:
+      CUDA_RUNTIME(cudaEventSynchronize(in.event));
+      break;
+    case Instr::Kind::stream_sync:
+      if (UNLIKELY(cudaSuccess != cudaStreamSynchronize(in.stream))) {
+        THROW_RUNTIME("CUDA error in " << in.op->name());
+      }
+      break;
+    case Instr::Kind::stream_wait:
+      CUDA_RUNTIME(cudaEventRecord(in.event, in.stream));
+      CUDA_RUNTIME(cudaStreamWaitEvent(in.waiter, in.event, 0 /*flags*/));
+      break;
+    case Instr::Kind::host:
+      in.op->run(plat);
+      break;
+    }
+  }
+};
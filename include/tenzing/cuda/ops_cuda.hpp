@@ -34,23 +34,26 @@ public:
    this node can be inserted by the scheduler when GPU operations
    in different streams are ordered
 */
-class StreamWait : public BoundOp, public HasEvent {
+class StreamWait : public BoundOp, public HasEvent, public HasStream {
   std::string name_;
   Event event_;
   Stream waitee_, waiter_;
 
 public:
-  StreamWait(Stream waitee, Stream waiter, Event event)
-      : name_("StreamWait-anon"), event_(event), waitee_(waitee), waiter_(waiter) {}
+  StreamWait(Stream waitee, Stream waiter, Event event,
+             const std::string &name = "StreamWait-anon")
+      : name_(name), event_(event), waitee_(waitee), waiter_(waiter) {}
 
   // need a new event on copy so dtor doesn't go twice
   StreamWait(const StreamWait &other) = default;
   StreamWait(StreamWait &&other) = delete;
 
+  Event event() const { return event_; }
   Stream waiter() const { return waiter_; }
   Stream waitee() const { return waitee_; }
 
   std::string name() const override { return name_; }
+  std::string desc() const override;
   virtual nlohmann::json json() const override;
   void update_name(const std::set<std::shared_ptr<OpBase>> &preds,
                    const std::set<std::shared_ptr<OpBase>> &succs);
@@ -69,18 +72,24 @@ public:
     return event_ == rhs.event_ && waitee_ == rhs.waitee_ &&
            waiter_ == rhs.waiter_;
   }
+  size_t hash() const override {
+    return hash_combine(hash_combine(event_.id_, waitee_.id_), waiter_.id_);
+  }
 
   virtual std::vector<Event> get_events() const override { return {event_}; }
+  std::vector<Stream> get_streams() const override { return {waitee_, waiter_}; }
 };
 
-class StreamSync : public BoundOp {
+class StreamSync : public BoundOp, public HasStream {
   std::string name_;
   Stream stream_;
 
 public:
-  StreamSync(Stream stream) : name_("streamsync-anon"), stream_(stream) {}
+  StreamSync(Stream stream, const std::string &name = "streamsync-anon")
+      : name_(name), stream_(stream) {}
   Stream stream() const { return stream_; }
   std::string name() const override { return name_; }
+  std::string desc() const override;
   nlohmann::json json() const override;
   void update_name(const std::set<std::shared_ptr<OpBase>> &preds,
                    const std::set<std::shared_ptr<OpBase>> &succs);
@@ -92,6 +101,9 @@ public:
   CLONE_DEF(StreamSync);
   bool operator<(const StreamSync &rhs) const { return name() < rhs.name(); }
   bool operator==(const StreamSync &rhs) const { return stream_ == rhs.stream_; }
+  size_t hash() const override { return stream_.id_; }
+
+  std::vector<Stream> get_streams() const override { return {stream_}; }
 };
 
 class CudaEventRecord : public BoundOp, public HasEvent, public HasStream {
@@ -124,6 +136,7 @@ public:
   bool operator==(const CudaEventRecord &rhs) const {
     return event_ == rhs.event_ && stream_ == rhs.stream_;
   }
+  size_t hash() const override { return hash_combine(event_.id_, stream_.id_); }
   bool operator<(const CudaEventRecord &rhs) const { return name() < rhs.name(); }
 
   std::vector<Event> get_events() const override { return {event_}; }
@@ -157,6 +170,7 @@ public:
   bool operator==(const CudaStreamWaitEvent &rhs) const {
     return event_ == rhs.event_ && stream_ == rhs.stream_;
   }
+  size_t hash() const override { return hash_combine(event_.id_, stream_.id_); }
   bool operator<(const CudaStreamWaitEvent &rhs) const { return name() < rhs.name(); }
 
   std::vector<Event> get_events() const override { return {event_}; }
@@ -185,6 +199,7 @@ public:
   bool operator==(const CudaEventSync &rhs) const {
     return event_ == rhs.event_;
   }
+  size_t hash() const override { return event_.id_; }
 
   std::vector<Event> get_events() const override { return {event_}; }
 };
@@ -232,12 +247,25 @@ public:
   bool operator==(const BoundGpuOp &rhs) const {
     return (stream_ == rhs.stream_) && op_->eq(rhs.op_);
   }
+  // interned as the (unbound id, stream) pair
+  size_t hash() const override { return hash_combine(op_->id(), stream_.id_); }
 
   virtual std::shared_ptr<GpuOp> unbound() { return op_; }
+  id_t unbound_id() const override { return op_->id(); }
   std::vector<Stream> get_streams() const override;
+
+  /* launches into different streams are unordered on the device, so only the order in which the
+     host issues them differs. Any data dependence between them is already a graph edge
+  */
+  bool independent_of(const BoundOp &other) const override {
+    const BoundGpuOp *gpu = dynamic_cast<const BoundGpuOp *>(&other);
+    return gpu && gpu->stream_ != stream_;
+  }
 };
 
 
 void from_json(const nlohmann::json& j, std::shared_ptr<CudaEventRecord> &op);
 void from_json(const nlohmann::json& j, std::shared_ptr<CudaStreamWaitEvent> &op);
-void from_json(const nlohmann::json& j, std::shared_ptr<CudaEventSync> &op);
\ No newline at end of file
+void from_json(const nlohmann::json& j, std::shared_ptr<CudaEventSync> &op);
+void from_json(const nlohmann::json& j, std::shared_ptr<StreamWait> &op);
+void from_json(const nlohmann::json& j, std::shared_ptr<StreamSync> &op);
\ No newline at end of file
@@ -1,49 +1,41 @@
 #pragma once
 
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include "cuda/ops_cuda.hpp"
+#include "macro_at.hpp"
 #include "operation.hpp"
 #include "operation_compound.hpp"
 
-/*! \brief Represents a specific transition between states
-
-    Basically just a tagged union
-*/
-class Decision {
-public:
-  virtual ~Decision() {}
-  virtual std::string desc() const = 0;
-};
-
 /*! \brief Do `op` next
  */
-class ExecuteOp : public Decision {
+class ExecuteOp {
 public:
   ExecuteOp(const std::shared_ptr<BoundOp> &_op) : op(_op) {}
-  virtual std::string desc() const override { return "Execute " + op->desc(); }
-  bool operator==(const ExecuteOp &rhs) {return op->eq(rhs.op); }
+  std::string desc() const { return "Execute " + op->desc(); }
+  bool operator==(const ExecuteOp &rhs) const { return op->eq(rhs.op); }
   std::shared_ptr<BoundOp> op;
 };
 
 /*! \brief expands compound operation `op` in the graph using `expander`
  */
-class ExpandOp : public Decision {
+class ExpandOp {
 public:
   ExpandOp(const std::shared_ptr<CompoundOp> &_op) : op(_op) {}
-  virtual std::string desc() const override { return "Expand " + op->desc(); }
+  std::string desc() const { return "Expand " + op->desc(); }
   std::shared_ptr<CompoundOp> op;
 };
 
 /*! \brief chooses one of the options in the ChoiceOp
  */
-class ChooseOp : public Decision {
+class ChooseOp {
 public:
   ChooseOp(const std::shared_ptr<ChoiceOp> &_orig, const std::shared_ptr<OpBase> &_replacement)
       : orig(_orig), replacement(_replacement) {}
-  virtual std::string desc() const override {
-    return "choose " + replacement->desc() + " for " + orig->desc();
-  }
+  std::string desc() const { return "choose " + replacement->desc() + " for " + orig->desc(); }
 
   std::shared_ptr<ChoiceOp> orig;
   std::shared_ptr<OpBase> replacement;
@@ -51,13 +43,146 @@ public:
 
 /*! \brief expands compound operation `op` in the graph using `expander`
  */
-class AssignOpStream : public Decision {
+class AssignOpStream {
 public:
   AssignOpStream(const std::shared_ptr<GpuOp> &_op, Stream _stream) : op(_op), stream(_stream) {}
-  virtual std::string desc() const override {
-    return op->desc() + " in stream " + std::to_string(stream.id_);
+  std::string desc() const { return op->desc() + " in stream " + std::to_string(stream.id_); }
+  bool operator==(const AssignOpStream &rhs) const {
+    return op->eq(rhs.op) && stream == rhs.stream;
   }
-  bool operator==(const AssignOpStream &rhs) {return op->eq(rhs.op) && stream == rhs.stream; }
   std::shared_ptr<GpuOp> op;
   Stream stream;
 };
+
+/*! \brief Represents a specific transition between states
+
+    A tagged union of ExecuteOp, ExpandOp, ChooseOp, and AssignOpStream, held by value.
+    Each alternative converts implicitly to a Decision.
+
+    Use visit() to dispatch on the alternative, or get_if<T>() to test for one:
+    \code
+    if (const ExecuteOp *eo = decision.get_if<ExecuteOp>()) { ... }
+    \endcode
+*/
+class Decision {
+public:
+  enum class Kind { execute, expand, choose, assign };
+
+  Decision(const ExecuteOp &d) : kind_(Kind::execute) { new (&execute_) ExecuteOp(d); }
+  Decision(const ExpandOp &d) : kind_(Kind::expand) { new (&expand_) ExpandOp(d); }
+  Decision(const ChooseOp &d) : kind_(Kind::choose) { new (&choose_) ChooseOp(d); }
+  Decision(const AssignOpStream &d) : kind_(Kind::assign) { new (&assign_) AssignOpStream(d); }
+
+  Decision(const Decision &other) : kind_(other.kind_) { construct(other); }
+  // noexcept, so std::vector<Decision> moves instead of copies when it grows
+  Decision(Decision &&other) noexcept : kind_(other.kind_) { construct(std::move(other)); }
+  Decision &operator=(const Decision &rhs) {
+    if (this != &rhs) {
+      destroy();
+      kind_ = rhs.kind_;
+      construct(rhs);
+    }
+    return *this;
+  }
+  Decision &operator=(Decision &&rhs) noexcept {
+    if (this != &rhs) {
+      destroy();
+      kind_ = rhs.kind_;
+      construct(std::move(rhs));
+    }
+    return *this;
+  }
+  ~Decision() { destroy(); }
+
+  Kind kind() const { return kind_; }
+
+  /*! \brief call `v` with the alternative this decision holds
+
+      `v` must be callable with each alternative, and return the same type for all of them
+  */
+  template <typename Visitor>
+  auto visit(Visitor &&v) const -> decltype(v(std::declval<const ExecuteOp &>())) {
+    switch (kind_) {
+    case Kind::execute:
+      return v(execute_);
+    case Kind::expand:
+      return v(expand_);
+    case Kind::choose:
+      return v(choose_);
+    case Kind::assign:
+      return v(assign_);
+    }
+    THROW_RUNTIME("unexpected Decision kind");
+  }
+
+  /*! \brief pointer to the alternative if this decision holds a T, otherwise nullptr
+   */
+  template <typename T> const T *get_if() const;
+
+  std::string desc() const { return visit(Desc()); }
+
+private:
+  struct Desc {
+    template <typename D> std::string operator()(const D &d) const { return d.desc(); }
+  };
+
+  Kind kind_;
+  union {
+    ExecuteOp execute_;
+    ExpandOp expand_;
+    ChooseOp choose_;
+    AssignOpStream assign_;
+  };
+
+  // initialize the alternative for kind_ from other
+  template <typename D> void construct(D &&other) {
+    switch (kind_) {
+    case Kind::execute:
+      new (&execute_) ExecuteOp(std::forward<D>(other).execute_);
+      break;
+    case Kind::expand:
+      new (&expand_) ExpandOp(std::forward<D>(other).expand_);
+      break;
+    case Kind::choose:
+      new (&choose_) ChooseOp(std::forward<D>(other).choose_);
+      break;
+    case Kind::assign:
+      new (&assign_) AssignOpStream(std::forward<D>(other).assign_);
+      break;
+    }
+  }
+
+  void destroy() {
+    switch (kind_) {
+    case Kind::execute:
+      execute_.~ExecuteOp();
+      break;
+    case Kind::expand:
+      expand_.~ExpandOp();
+      break;
+    case Kind::choose:
+      choose_.~ChooseOp();
+      break;
+    case Kind::assign:
+      assign_.~AssignOpStream();
+      break;
+    }
+  }
+};
+
+static_assert(std::is_nothrow_move_constructible<Decision>::value &&
+                  std::is_nothrow_move_assignable<Decision>::value,
+              "Decision moves should not throw");
+
+template <> inline const ExecuteOp *Decision::get_if<ExecuteOp>() const {
+  return Kind::execute == kind_ ? &execute_ : nullptr;
+}
+template <> inline const ExpandOp *Decision::get_if<ExpandOp>() const {
+  return Kind::expand == kind_ ? &expand_ : nullptr;
+}
+template <> inline const ChooseOp *Decision::get_if<ChooseOp>() const {
+  return Kind::choose == kind_ ? &choose_ : nullptr;
+}
+template <> inline const AssignOpStream *Decision::get_if<AssignOpStream>() const {
+  return Kind::assign == kind_ ? &assign_ : nullptr;
+}
@@ -5,10 +5,12 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <iterator>
 #include <memory>
-#include <set>
+#include <sstream>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "tenzing/cast.hpp"
@@ -16,24 +18,164 @@
 #include "tenzing/macro_at.hpp"
 #include "tenzing/operation.hpp"
 
+/*! \brief a DAG of operations
+
+    Vertices are stored densely and identified by a vertex id (vid_t) that is stable for the life of
+   the graph, even when other vertices are erased. Adjacency is kept as vectors of vertex ids, so
+   walking edges does not touch the operations themselves.
+
+    Storage is persistent: vertices live in fixed-size chunks that are shared between copies of a
+   graph and only copied when one of the copies modifies them. Copying a graph is O(1), and a
+   replacement or expansion only allocates the chunks it touches.
+
+    Operations are still identified by value (their interned OpBase::id): adding an operation that
+   is equal to one already in the graph refers to the existing vertex.
+*/
 template <typename T> class Graph {
+  template <typename> friend class Graph;
+
 public:
   typedef std::shared_ptr<T> op_t;
-  typedef std::set<op_t, OpBase::compare_lt> OpSet;
-  op_t start_;
-  op_t finish_;
+  typedef size_t vid_t;
+
+  /// returned by lookups that do not find a vertex
+  static const vid_t npos = vid_t(-1);
+
+private:
+  struct Vertex {
+    op_t op; // nullptr if the vertex has been erased
+    std::vector<vid_t> succs;
+    std::vector<vid_t> preds;
+  };
+
+  // vertices are stored CHUNK_SIZE at a time, and chunks are shared between copies of the graph
+  static const size_t CHUNK_SIZE = 64;
+  typedef std::vector<Vertex> Chunk;
+  typedef std::vector<std::shared_ptr<Chunk>> Table;
+  std::shared_ptr<Table> table_;
+  size_t size_;        // number of vertex ids handed out
+  size_t numVertices_; // number of vertices that have not been erased
+
+  /* find a vertex by operation id.
+     A BoundGpuOp is keyed by its unbound operation, so binding a vertex to a stream leaves the
+     index (and any graph sharing it) untouched.
+  */
+  typedef std::unordered_map<OpBase::id_t, vid_t> Index;
+  std::shared_ptr<Index> index_;
+
+  vid_t start_;
+  vid_t finish_;
+
+  const Vertex &vertex(vid_t v) const { return (*(*table_)[v / CHUNK_SIZE])[v % CHUNK_SIZE]; }
+
+  // chunk c, after copying anything shared with another graph
+  Chunk &mut_chunk(size_t c) {
+    if (table_.use_count() > 1) {
+      table_ = std::make_shared<Table>(*table_);
+    }
+    std::shared_ptr<Chunk> &chunk = (*table_)[c];
+    if (chunk.use_count() > 1) {
+      chunk = std::make_shared<Chunk>(*chunk);
+    }
+    return *chunk;
+  }
+
+  Vertex &mut_vertex(vid_t v) { return mut_chunk(v / CHUNK_SIZE)[v % CHUNK_SIZE]; }
+
+  // the index, after copying it if it is shared with another graph
+  Index &mut_index() {
+    if (index_.use_count() > 1) {
+      index_ = std::make_shared<Index>(*index_);
+    }
+    return *index_;
+  }
 
-  /* successors and predecessors of each node */
-  typedef std::map<op_t, OpSet, OpBase::compare_lt> OpMap;
-  OpMap succs_;
-  OpMap preds_;
+public:
+  /*! \brief the operations referred to by a list of vertex ids
+   */
+  class OpRange {
+    const Graph *graph_;
+    const std::vector<vid_t> *ids_;
+
+  public:
+    class const_iterator {
+      const Graph *graph_;
+      std::vector<vid_t>::const_iterator it_;
+
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef op_t value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const op_t *pointer;
+      typedef const op_t &reference;
+
+      const_iterator(const Graph *graph, std::vector<vid_t>::const_iterator it)
+          : graph_(graph), it_(it) {}
+      const op_t &operator*() const { return graph_->op(*it_); }
+      const op_t *operator->() const { return &graph_->op(*it_); }
+      const_iterator &operator++() {
+        ++it_;
+        return *this;
+      }
+      bool operator==(const const_iterator &rhs) const { return it_ == rhs.it_; }
+      bool operator!=(const const_iterator &rhs) const { return it_ != rhs.it_; }
+      vid_t vid() const { return *it_; }
+    };
+
+    OpRange(const Graph *graph, const std::vector<vid_t> *ids) : graph_(graph), ids_(ids) {}
+    const_iterator begin() const { return const_iterator(graph_, ids_->begin()); }
+    const_iterator end() const { return const_iterator(graph_, ids_->end()); }
+    size_t size() const { return ids_->size(); }
+    bool empty() const { return ids_->empty(); }
+  };
+
+  /*! \brief the ids of all vertices in the graph
+   */
+  class VertexRange {
+    const Graph *graph_;
+
+  public:
+    class const_iterator {
+      const Graph *graph_;
+      vid_t v_;
+      void skip_erased() {
+        while (v_ < graph_->size_ && !graph_->op(v_)) {
+          ++v_;
+        }
+      }
+
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef vid_t value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const vid_t *pointer;
+      typedef const vid_t &reference;
+
+      const_iterator(const Graph *graph, vid_t v) : graph_(graph), v_(v) { skip_erased(); }
+      const vid_t &operator*() const { return v_; }
+      const_iterator &operator++() {
+        ++v_;
+        skip_erased();
+        return *this;
+      }
+      bool operator==(const const_iterator &rhs) const { return v_ == rhs.v_; }
+      bool operator!=(const const_iterator &rhs) const { return v_ != rhs.v_; }
+    };
+
+    VertexRange(const Graph *graph) : graph_(graph) {}
+    const_iterator begin() const { return const_iterator(graph_, 0); }
+    const_iterator end() const { return const_iterator(graph_, graph_->size_); }
+  };
 
 private:
   /*! \brief create a graph with (start) -> (finish)
    */
   Graph(const std::shared_ptr<Start> &start, const std::shared_ptr<Finish> &finish)
-      : start_(start), finish_(finish) {
-    then_raw(start_, finish_);
+      : table_(std::make_shared<Table>()), size_(0), numVertices_(0),
+        index_(std::make_shared<Index>()) {
+    start_ = find_or_insert(start);
+    finish_ = find_or_insert(finish);
+    insert_edge(start_, finish_);
   }
 
 public:
@@ -45,14 +187,14 @@ public:
    */
   void start_then(const op_t &a) {
     erase_edge_only(start_, finish_);
-    then_raw(start_, a);
+    then_raw(start(), a);
   }
 
   /*! \brief add a and b to the graph, if they're not present, and an edge a->b. return b
    */
   void then_finish(const op_t &a) {
     erase_edge_only(start_, finish_);
-    then_raw(a, finish_);
+    then_raw(a, finish());
   }
 
   /*! \brief add a and b to the graph, if they're not present, and an edge a->b. return b
@@ -64,25 +206,22 @@ public:
       THROW_RUNTIME("can't insert Start or Finish with then(), use start_then() or then_finish()");
     }
 
-    succs_[a].insert(b);
-    succs_[b]; // ensure b exists, but we have no info about successors
-
-    preds_[a]; // a exists, but no info about predecessors
-    preds_[b].insert(a);
-    return b;
+    return then_raw(a, b);
   }
 
-  const op_t &start() const { return start_; }
-  const op_t &finish() const { return finish_; }
+  const op_t &start() const { return vertex(start_).op; }
+  const op_t &finish() const { return vertex(finish_).op; }
+  vid_t start_id() const { return start_; }
+  vid_t finish_id() const { return finish_; }
 
   /*! \brief all vertices whos only pred is start
    */
-  const OpSet start_vertices() const {
-    OpSet ret;
-    for (const op_t &succ : succs_.at(start_)) {
-      const OpSet &preds = preds_.at(succ);
-      if (preds.size() == 1 && *preds.begin() == start_) {
-        ret.insert(succ);
+  std::vector<op_t> start_vertices() const {
+    std::vector<op_t> ret;
+    for (vid_t succ : vertex(start_).succs) {
+      const std::vector<vid_t> &preds = vertex(succ).preds;
+      if (preds.size() == 1 && preds[0] == start_) {
+        ret.push_back(vertex(succ).op);
       }
     }
     return ret;
@@ -90,470 +229,448 @@ public:
 
   /*! \brief all vertices with finish as only successor
    */
-  const OpSet finish_vertices() const {
-    OpSet ret;
-    for (const auto &kv : succs_) {
-      if (1 == kv.second.size() && *(kv.second.begin()) == finish_) {
-        ret.insert(kv.first);
+  std::vector<op_t> finish_vertices() const {
+    std::vector<op_t> ret;
+    for (vid_t u : vertices()) {
+      const std::vector<vid_t> &succs = vertex(u).succs;
+      if (1 == succs.size() && succs[0] == finish_) {
+        ret.push_back(vertex(u).op);
       }
     }
     return ret;
   }
 
-  size_t vertex_size() const { return succs_.size(); }
+  size_t vertex_size() const { return numVertices_; }
+
+  /*! \brief one past the largest vertex id, for tables indexed by vertex id
+   */
+  vid_t id_size() const { return size_; }
+
+  /*! \brief ids of all vertices. Ids of erased vertices are skipped
+   */
+  VertexRange vertices() const { return VertexRange(this); }
+
+  /*! \brief the operation at vertex \c v
+   */
+  const op_t &op(vid_t v) const { return vertex(v).op; }
 
-  void dump_helper(op_t u, op_t v) {
-    std::cerr << u->name() << " -> " << v->name() << "\n";
-    for (op_t s : succs_[v]) {
+  OpRange succs(vid_t v) const { return OpRange(this, &vertex(v).succs); }
+  OpRange preds(vid_t v) const { return OpRange(this, &vertex(v).preds); }
+  const std::vector<vid_t> &succ_ids(vid_t v) const { return vertex(v).succs; }
+  const std::vector<vid_t> &pred_ids(vid_t v) const { return vertex(v).preds; }
+
+  void dump_helper(vid_t u, vid_t v) const {
+    std::cerr << op(u)->name() << " -> " << op(v)->name() << "\n";
+    for (vid_t s : vertex(v).succs) {
       dump_helper(v, s);
     }
   }
 
-  void dump() {
-    for (op_t s : succs_[start_]) {
+  void dump() const {
+    for (vid_t s : vertex(start_).succs) {
       dump_helper(start_, s);
     }
   }
 
-  bool contains(const op_t &op) const {
-    for (const auto &kv : succs_) {
-      if (op->eq(kv.first)) {
-        return true;
-      }
+  bool contains(const op_t &op) const { return npos != find(op); }
+
+  /*! \brief id of the vertex equal to \c op, or npos
+   */
+  vid_t find(const op_t &op) const {
+    vid_t v = find_key(op->unbound_id());
+    if (npos != v && this->op(v)->id() != op->id()) {
+      return npos; // a different binding of the same operation
     }
-    return false;
+    return v;
   }
 
-  /* create a graph with clone()'ed nodes, except
-     src in this graph is replaced with dst in the result graph
-  */
-  Graph<T> clone_but_replace(op_t dst, op_t src) const {
-
-    // clone all nodes, maintain a mapping from original to new
-    std::map<op_t, op_t, OpBase::compare_lt> clones;
-    for (auto &kv : succs_) {
-      if (src == kv.first) {
-        clones[kv.first] = dst;
-      } else {
-        clones[kv.first] = kv.first->clone();
-      }
+  /*! \brief id of the vertex equal to \c key, or its unbound version, or npos
+   */
+  vid_t find_or_find_unbound(const op_t &key) const {
+    const OpBase::id_t unbound = key->unbound_id();
+    vid_t v = find_key(unbound);
+    if (npos != v && op(v)->id() != key->id() && op(v)->id() != unbound) {
+      return npos; // a different binding of the same operation
     }
+    return v;
+  }
 
-    // create edges in the new graph
-    Graph<T> ret(TENZING_MUST_CAST(Start, clones[start_]),
-                 TENZING_MUST_CAST(Finish, clones[finish_]));
-    ret.erase_edge_only(ret.start(), ret.finish());
+  /*! \brief removed: use find_or_find_unbound()
 
-    // connect the new nodes in the same way as the old nodes
-    for (auto &kv : clones) {
-      op_t o = kv.first;  // original
-      op_t c = kv.second; // clone
-      for (op_t os : succs_.at(o)) {
-        ret.then_raw(c, clones[os]);
+      This returned an iterator into the successor map, which no longer exists. Callers that
+      compared against \c succs_.end() should compare find_or_find_unbound() against npos, and
+      iterate succs(v) for the successors. It is deleted rather than kept returning a vertex id, so
+      an old caller fails to compile instead of quietly using the id as something else.
+   */
+  vid_t succs_find_or_find_unbound(const op_t &key) const = delete;
+
+  /*! \brief id of the vertex holding exactly \c tp, or npos
+
+      Goes through the index by \c tp's id, so it is constant time. A vertex holding a different
+      object that is equal to \c *tp does not match.
+   */
+  vid_t find_ptr(const T *tp) const {
+    if (!tp) {
+      return npos;
+    }
+    vid_t v = find_key(tp->unbound_id());
+    if (npos != v && op(v).get() != tp) {
+      return npos;
+    }
+    return v;
+  }
+
+  /// \brief id of v s.t. v->name() == key, or npos
+  vid_t find_name(const std::string &key) const {
+    for (vid_t v : vertices()) {
+      if (op(v)->name() == key) {
+        return v;
       }
     }
+    return npos;
+  }
 
-    // return the new graph
+  /* create a graph where src in this graph is replaced with dst.
+     All other vertices are shared with this graph, not cloned
+  */
+  Graph<T> clone_but_replace(op_t dst, op_t src) const {
+    Graph<T> ret(*this);
+    vid_t v = ret.find(src);
+    if (npos != v) {
+      ret.replace_vertex(v, dst);
+    }
     return ret;
   }
 
-  /*! \brief clone the graph with \c op replaced `graph`
+  /*! \brief a graph with \c op replaced `graph`.
+      All vertices not adjacent to \c op are shared with this graph, not cloned
    */
   Graph<T> clone_but_expand(const std::shared_ptr<T> &op, const Graph<OpBase> &graph) const {
 
-    OpSet startSuccs = graph.start_vertices(); // successors to start
-    OpSet finishPreds = graph.finish_vertices(); // predicates to finish
-
-    // clone all nodes, maintain a mapping from original to new
-    std::map<op_t, op_t, OpBase::compare_lt> clones;
-    for (auto &kv : succs_) {
-      clones[kv.first] = kv.first->clone();
+    Graph<T> ret(*this);
+    vid_t v = ret.find(op);
+    if (npos == v) {
+      THROW_RUNTIME("couldn't find " << op->desc() << " to expand");
     }
+    const std::vector<vid_t> preds = ret.vertex(v).preds;
+    const std::vector<vid_t> succs = ret.vertex(v).succs;
+    ret.erase_vertex(v);
 
-    // create edges in the new graph
-    Graph<T> ret(TENZING_MUST_CAST(Start, clones[start_]),
-                 TENZING_MUST_CAST(Finish, clones[finish_]));
-    ret.erase_edge_only(ret.start(), ret.finish());
+    /* add graph's vertices and internal edges.
+       graph's Start and Finish are equal to ours, so they land on the same vertices
+    */
+    std::vector<vid_t> ids(graph.size_, npos); // ret vertex for each graph vertex
+    for (vid_t u : graph.vertices()) {
+      ids[u] = ret.find_or_insert(graph.op(u));
+    }
+    for (vid_t u : graph.vertices()) {
+      for (vid_t w : graph.succ_ids(u)) {
+        ret.insert_edge(ids[u], ids[w]);
+      }
+    }
 
-    /* connect the clone to the new graph:
+    /* connect graph in op's place:
        all edges into op, u -> op, should instead be u -> (succs of graph.start)
        all edges out of op, op -> v, should instead be (preds of graph.finish) -> v
-       all edges not having to do with op should be continued
     */
-    for (auto &kv : clones) {
-      op_t u = kv.first;   // original
-      op_t up = kv.second; // clone
-
-      // all u -> v (up -> vp) edges old (new) graph
-      for (op_t v : succs_.at(u)) {
-        op_t vp = clones.at(v);
-
-        // op -> v should be (preds of finish) -> v
-        if (u == op) {
-          for (const op_t &pfinish : graph.finish_vertices()) {
-            ret.then_raw(pfinish, vp);
-          }
-        } else if (v == op) { // u -> op replaced with u -> (succs of start of graph)
-          for (const op_t &start : graph.start_vertices()) {
-            ret.then_raw(up, start);
-          }
-        } else {
-          ret.then_raw(up, vp);
-        }
+    for (const op_t &start : graph.start_vertices()) {
+      for (vid_t u : preds) {
+        ret.insert_edge(u, ret.find(start));
       }
     }
-
-    /* add graph's internal edges
-    */
-    for (auto &kv : graph.succs_) {
-      const op_t &u = kv.first;
-      const auto &vs = kv.second;
-
-      // all u -> v (up -> vp) edges old (new) graph
-      for (const op_t &v : vs) {
-        ret.then_raw(u, v);
+    for (const op_t &pfinish : graph.finish_vertices()) {
+      for (vid_t w : succs) {
+        ret.insert_edge(ret.find(pfinish), w);
       }
-    }   
+    }
 
     return ret;
   }
 
-  /* create a graph with clone()'ed nodes
+  /* create a graph with clone()'ed nodes that shares nothing with this graph
    */
   Graph<T> clone() const {
-    // clone all nodes, maintain a mapping from original to new
-    std::map<op_t, op_t, OpBase::compare_lt> clones;
-    for (auto &kv : succs_) {
-      clones[kv.first] = kv.first->clone();
-    }
-
-    // create edges in the new graph
-    Graph<T> ret(TENZING_MUST_CAST(Start, clones[start_]),
-                 TENZING_MUST_CAST(Finish, clones[finish_]));
-    ret.erase_edge_only(ret.start(), ret.finish());
-
-    // connect the new nodes in the same way as the old nodes
-    for (auto &kv : clones) {
-      const op_t &o = kv.first; // original
-      op_t &c = kv.second;      // clone
-      for (const op_t &os : succs_.at(o)) {
-        ret.then_raw(c, clones[os]);
+    Graph<T> ret(*this);
+    ret.table_ = std::make_shared<Table>();
+    for (const std::shared_ptr<Chunk> &chunk : *table_) {
+      ret.table_->push_back(std::make_shared<Chunk>(*chunk));
+      for (Vertex &v : *ret.table_->back()) {
+        if (v.op) {
+          v.op = v.op->clone();
+        }
       }
     }
-
+    // the clones have the same ids as the originals, so the index can be shared
     return ret;
   }
 
   /* replace src with dst in this graph
    */
   void replace(op_t src, op_t dst) {
-
-    // maybe replace start
-    if (src == start_) {
-      start_ = dst;
+    vid_t v = find(src);
+    if (npos == v) {
+      THROW_RUNTIME("couldn't find " << src->desc() << " to replace");
     }
+    replace_vertex(v, dst);
+  }
 
-    OpSet outEdges = succs_.at(src);
-    OpSet inEdges = preds_.at(src);
-
-    for (auto &n : outEdges) {
-      then(dst, n);
+  /*! \brief replace the operation at vertex \c v with \c dst, keeping all edges
+   */
+  void replace_vertex(vid_t v, const op_t &dst) {
+    const OpBase::id_t oldKey = op(v)->unbound_id();
+    const OpBase::id_t newKey = dst->unbound_id();
+    vid_t existing = find_key(newKey);
+    if (npos != existing && existing != v) {
+      THROW_RUNTIME("replacement " << dst->desc() << " is already in the graph");
     }
-    for (auto &n : inEdges) {
-      then(n, dst);
+    // binding to a stream keeps the key, so the index can stay shared
+    if (oldKey != newKey) {
+      Index &index = mut_index();
+      index.erase(oldKey);
+      index.emplace(newKey, v);
     }
-
-    // remove original node & edges
-    erase(src.get());
+    mut_vertex(v).op = dst;
   }
 
   template <typename U> Graph<U> nodes_cast() const {
     Graph<U> ret;
-    // set start node
-    {
-      auto s = std::dynamic_pointer_cast<U>(start_);
-      if (s) {
-        ret.start_ = s;
-      } else {
-        throw std::runtime_error(AT);
-      }
-    }
-
-    // recreate edges
-    for (auto &kv : succs_) {
-      auto u = kv.first;
-      for (auto v : kv.second) {
-        auto uu = std::dynamic_pointer_cast<U>(u);
-        auto vv = std::dynamic_pointer_cast<U>(v);
-        if (!uu || !vv) {
-          throw std::runtime_error(AT);
-        } else {
-          ret.then(uu, vv);
+    ret.table_ = std::make_shared<typename Graph<U>::Table>();
+    for (const std::shared_ptr<Chunk> &chunk : *table_) {
+      ret.table_->push_back(std::make_shared<typename Graph<U>::Chunk>());
+      for (const Vertex &v : *chunk) {
+        typename Graph<U>::Vertex rv;
+        if (v.op) {
+          rv.op = std::dynamic_pointer_cast<U>(v.op);
+          if (!rv.op) {
+            THROW_RUNTIME("couldn't cast " << v.op->desc());
+          }
         }
+        rv.succs = v.succs;
+        rv.preds = v.preds;
+        ret.table_->back()->push_back(rv);
       }
     }
+    ret.size_ = size_;
+    ret.numVertices_ = numVertices_;
+    ret.start_ = start_;
+    ret.finish_ = finish_;
+    ret.index_ = index_; // same operations, same keys
     return ret;
   }
 
-  OpSet &preds(T *tp) {
-    for (auto &kv : preds_) {
-      if (kv.first.get() == tp) {
-        return kv.second;
-      }
+  OpRange preds(const T *tp) const {
+    vid_t v = find_ptr(tp);
+    if (npos == v) {
+      throw std::runtime_error(AT);
     }
-    throw std::runtime_error(AT);
+    return preds(v);
   }
 
-  const OpSet &preds(T *tp) const {
-    for (auto &kv : preds_) {
-      if (kv.first.get() == tp) {
-        return kv.second;
-      }
-    }
-    throw std::runtime_error(AT);
+  std::vector<op_t> preds_vec(const T *tp) const {
+    OpRange range = preds(tp);
+    return std::vector<op_t>(range.begin(), range.end());
   }
 
-  std::vector<op_t> preds_vec(T *tp) const {
-    auto opset = preds(tp);
-    std::vector<op_t> ret;
-    for (const auto &op : opset) {
-      ret.push_back(op);
+  OpRange succs(const T *tp) const {
+    vid_t v = find_ptr(tp);
+    if (npos == v) {
+      throw std::runtime_error(AT);
     }
-    return ret;
+    return succs(v);
   }
 
-  typename OpMap::const_iterator preds_find(T *tp) const {
-    for (typename OpMap::const_iterator it = preds_.begin(); it != preds_.end(); ++it) {
-      if (it->first.get() == tp) {
-        return it;
-      }
-    }
-    return preds_.end();
+  std::vector<op_t> succs_vec(const T *tp) const {
+    OpRange range = succs(tp);
+    return std::vector<op_t>(range.begin(), range.end());
   }
 
-  typename OpMap::const_iterator preds_find_or_find_unbound(const op_t &key) const {
-    typename OpMap::const_iterator it = preds_.find(key);
-    if (preds_.end() == it) {
-      if (auto bound = std::dynamic_pointer_cast<BoundGpuOp>(key)) {
-        it = preds_.find(bound->unbound());
-      }
+  void erase(const T *tp) {
+    // can't erase start
+    if (tp == start().get()) {
+      throw std::runtime_error(AT);
     }
-    return it;
-  }
-
-  OpSet &succs(T *tp) {
-    for (auto &kv : succs_) {
-      if (kv.first.get() == tp) {
-        return kv.second;
-      }
+    vid_t v = find_ptr(tp);
+    if (npos != v) {
+      erase_vertex(v);
     }
-    throw std::runtime_error(AT);
   }
 
-  const OpSet &succs(T *tp) const {
-    for (auto &kv : succs_) {
-      if (kv.first.get() == tp) {
-        return kv.second;
-      }
+  /*! \brief erase a->b, but leave a, b even if no edges remain
+   */
+  void erase_edge_only(const op_t &a, const op_t &b) {
+    vid_t u = find(a);
+    vid_t v = find(b);
+    if (npos != u && npos != v) {
+      erase_edge_only(u, v);
     }
-    throw std::runtime_error(AT);
   }
 
-  std::vector<op_t> succs_vec(T *tp) const {
-    auto opset = succs(tp);
-    std::vector<op_t> ret;
-    for (const auto &op : opset) {
-      ret.push_back(op);
-    }
-    return ret;
+  void erase_edge_only(vid_t u, vid_t v) {
+    remove_id(mut_vertex(u).succs, v);
+    remove_id(mut_vertex(v).preds, u);
   }
 
-#if 0
-    typename OpMap::const_iterator succs_find(T* tp) const {
-        for (typename OpMap::const_iterator it = succs_.begin(); it != succs_.end(); ++it) {
-            if (it->first.get() == tp) {
-                return it;
-            }
-        }
-        return succs_.end();
-    }
-#endif
+  /*! \brief return all nodes that have all predecessors in \c visited
 
-  // finds key or key->unbound in succs
-  typename OpMap::const_iterator succs_find_or_find_unbound(const op_t &key) const {
-    typename OpMap::const_iterator it = succs_.find(key);
-    if (succs_.end() == it) {
-      if (auto bound = std::dynamic_pointer_cast<BoundGpuOp>(key)) {
-        it = succs_.find(bound->unbound());
-      }
-    }
-    return it;
-  }
+      Does not handle any nesting, e.g. the graph has a compound node and one of the choices is in
+     visited
 
-  /// \brief returns v s.t. v->name() == key->name()
-  typename OpMap::const_iterator succs_find_name(const std::string &key) const {
-    auto it = succs_.begin();
-    for (; it != succs_.end(); ++it) {
-      if (it->first->name() == key) {
-        return it;
-      }
-    }
-    return it;
-  }
+     Linear in the size of \c visited and the edges out of it. To track the frontier as
+     operations are executed one at a time, see SDP::ReadySet.
 
-  void erase(const T *tp) {
-  // can't erase start
-  if (tp == start_.get()) {
-    throw std::runtime_error(AT);
-  }
+     \param visisted the vector of visited predecessors
+     \tparam U the type of node in the \c visited vector
+  */
+  template <typename U,
+            typename std::enable_if<std::is_base_of<OpBase, U>::value, bool>::type = true>
+  std::vector<op_t> frontier(const std::vector<std::shared_ptr<U>> &visited) const {
 
-  // erase node's out-edges
-  for (auto it = succs_.begin(); it != succs_.end(); ++it) {
-    if (it->first.get() == tp) {
-      succs_.erase(it);
-      break;
-    }
-  }
-  // erase node's in-edges
-  for (auto it = preds_.begin(); it != preds_.end(); ++it) {
-    if (it->first.get() == tp) {
-      preds_.erase(it);
-      break;
+    // some nodes in the path will not be in the graph (inserted syncs)
+    // other nodes in the path are bound versions of that in the graph
+    std::vector<bool> done(size_, false);
+    for (const auto &vOp : visited) {
+      vid_t v = find_or_find_unbound(vOp);
+      if (npos != v) {
+        done[v] = true;
+      }
     }
-  }
 
-  // erase edges from other nodes to this node
-  for (auto &kv : succs_) {
-    for (auto &succ : kv.second) {
-      if (tp == succ.get()) {
-        kv.second.erase(succ);
-        break;
+    STDERR("consider ops with >= 1 pred completed...");
+    std::vector<vid_t> onePredVisited;
+    std::vector<bool> considered(size_, false);
+    for (const auto &vOp : visited) {
+      vid_t v = find_or_find_unbound(vOp);
+      if (npos != v) {
+        // all successors of a completed op have at least one pred completed
+        for (vid_t succ : vertex(v).succs) {
+          // don't add duplicates
+          if (!considered[succ]) {
+            considered[succ] = true;
+            onePredVisited.push_back(succ);
+          }
+        }
       }
     }
-  }
 
-  // erase edges from other nodes to this node
-  for (auto &kv : preds_) {
-    for (auto &pred : kv.second) {
-      if (tp == pred.get()) {
-        kv.second.erase(pred);
-        break;
+    {
+      std::stringstream ss;
+      ss << "at least one pred completed: ";
+      for (vid_t v : onePredVisited) {
+        ss << op(v)->desc() << ",";
       }
+      STDERR(ss.str());
     }
-  }
-}
 
-/*! \brief erase a->b, but leave a, b even if no edges remain
- */
-void erase_edge_only(const op_t &a, const op_t &b) {
-
-  // erase succs_[a][b] if exists
-  {
-    auto ia = succs_.find(a);
-    if (succs_.end() != ia) {
-      auto ib = ia->second.find(b);
-      if (ia->second.end() != ib) {
-        ia->second.erase(ib);
+    STDERR("reject ops already done or with incomplete preds...");
+    std::vector<op_t> result;
+    for (vid_t v : onePredVisited) {
+      const op_t &vOp = op(v);
+      // reject ops that we've already done
+      if (done[v]) {
+        STDERR(vOp->name() << " already done");
+        continue;
       }
-    }
-  }
 
-  // erase preds_[b][a] if exists
-  {
-    auto ib = preds_.find(b);
-    if (preds_.end() != ib) {
-      auto ia = ib->second.find(a);
-      if (ib->second.end() != ia) {
-        ib->second.erase(ia);
+      // reject ops that all preds are not done
+      bool allPredsCompleted = true;
+      for (vid_t pred : vertex(v).preds) {
+        if (!done[pred]) {
+          STDERR(vOp->name() << " missing pred " << op(pred)->name());
+          allPredsCompleted = false;
+          break;
+        }
       }
+      if (!allPredsCompleted) {
+        STDERR(vOp->name() << " missing a pred");
+        continue;
+      }
+      result.push_back(vOp);
     }
-  }
-}
-
-/*! \brief return all nodes that have all predecessors in \c visited
-
-    Does not handle any nesting, e.g. the graph has a compound node and one of the choices is in
-   visited
 
-   \param visisted the vector of visited predecessors
-   \tparam U the type of node in the \c visited vector
-*/
-template <typename U, typename std::enable_if<std::is_base_of<OpBase, U>::value, bool>::type = true>
-std::vector<op_t> frontier(const std::vector<std::shared_ptr<U>> &visited) const {
-
-  STDERR("consider ops with >= 1 pred completed...");
-  std::vector<std::shared_ptr<OpBase>> onePredVisited;
-  for (const auto &vOp : visited) {
-    // STDERR("...incl all succs of " << vOp->desc() << " (@" << vOp.get() << ")");
-
-    // some nodes in the path will not be in the graph (inserted syncs)
-    // other nodes in the path are bound versions of that in the graph
+    return result;
+  }
 
-    auto it = succs_find_or_find_unbound(vOp);
-    if (succs_.end() != it) {
+  void dump_graphviz(const std::string &path) const;
 
-      // all successors of a completed op have at least one pred completed
-      for (const auto &succ : it->second) {
-        // don't add duplicates
-        if (onePredVisited.end() == std::find(onePredVisited.begin(), onePredVisited.end(), succ)) {
-          onePredVisited.push_back(succ);
-        }
-      }
+private:
+  static void remove_id(std::vector<vid_t> &ids, vid_t v) {
+    typename std::vector<vid_t>::iterator it = std::find(ids.begin(), ids.end(), v);
+    if (ids.end() != it) {
+      ids.erase(it);
     }
   }
 
-  {
-    std::stringstream ss;
-    ss << "at least one pred completed: ";
-    for (const auto &op : onePredVisited) {
-      ss << op->desc() << ",";
+  vid_t find_key(OpBase::id_t key) const {
+    typename Index::const_iterator it = index_->find(key);
+    if (index_->end() == it) {
+      return npos;
     }
-    STDERR(ss.str());
+    return it->second;
   }
 
-  STDERR("reject ops already done or with incomplete preds...");
-  std::vector<std::shared_ptr<OpBase>> result;
-  for (const auto &vOp : onePredVisited) {
-    // reject ops that we've already done
-    if (unbound_contains(visited, vOp)) {
-      STDERR(vOp->name() << " already done");
-      continue;
+  // the vertex equal to op, which is added if not present
+  vid_t find_or_insert(const op_t &op) {
+    const OpBase::id_t key = op->unbound_id();
+    vid_t v = find_key(key);
+    if (npos != v) {
+      if (this->op(v)->id() != op->id()) {
+        THROW_RUNTIME("graph already has a different binding of " << op->desc());
+      }
+      return v;
     }
 
-    // reject ops that all preds are not done
-    bool allPredsCompleted = true;
-    for (const auto &pred : preds_.at(vOp)) {
-      if (!unbound_contains(visited, pred)) {
-        STDERR(vOp->name() << " missing pred " << pred->name());
-        allPredsCompleted = false;
-        break;
+    v = size_++;
+    if (0 == v % CHUNK_SIZE) {
+      if (table_.use_count() > 1) {
+        table_ = std::make_shared<Table>(*table_);
       }
+      table_->push_back(std::make_shared<Chunk>());
+      table_->back()->reserve(CHUNK_SIZE);
     }
-    if (!allPredsCompleted) {
-      STDERR(vOp->name() << " missing a pred");
-      continue;
+    Vertex vert;
+    vert.op = op;
+    mut_chunk(v / CHUNK_SIZE).push_back(vert);
+    mut_index().emplace(key, v);
+    ++numVertices_;
+    return v;
+  }
+
+  // add edge u->v if it's not present
+  void insert_edge(vid_t u, vid_t v) {
+    const std::vector<vid_t> &succs = vertex(u).succs;
+    if (succs.end() == std::find(succs.begin(), succs.end(), v)) {
+      mut_vertex(u).succs.push_back(v);
+      mut_vertex(v).preds.push_back(u);
     }
-    result.push_back(vOp);
   }
 
-  return result;
-}
+  // remove v and all its edges. v's id is not reused
+  void erase_vertex(vid_t v) {
+    Vertex &vert = mut_vertex(v);
+    for (vid_t succ : vert.succs) {
+      remove_id(mut_vertex(succ).preds, v);
+    }
+    for (vid_t pred : vert.preds) {
+      remove_id(mut_vertex(pred).succs, v);
+    }
+    vert.succs.clear();
+    vert.preds.clear();
+    mut_index().erase(vert.op->unbound_id());
+    vert.op = nullptr;
+    --numVertices_;
+  }
 
-void dump_graphviz(const std::string &path) const;
+  // add a and b to the graph, if they're not present, and an edge a->b. return b
+  const op_t &then_raw(const op_t &a, const op_t &b) {
+    vid_t u = find_or_insert(a);
+    vid_t v = find_or_insert(b);
+    insert_edge(u, v);
+    return b;
+  }
+};
 
-private:
-// add a and b to the graph, if they're not present, and an edge a->b. return b
-const op_t &then_raw(const op_t &a, const op_t &b) {
-
-  succs_[a].insert(b);
-  succs_[b]; // ensure b exists, but we have no info about successors
-
-  preds_[a]; // a exists, but no info about predecessors
-  preds_[b].insert(a);
-  return b;
-}
-}
-;
+template <typename T> const typename Graph<T>::vid_t Graph<T>::npos;
+template <typename T> const size_t Graph<T>::CHUNK_SIZE;
 
 /* turn a graph that has GpuNodes into all possible combinations that only have CpuNodes
  */
@@ -0,0 +1,125 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Track which operations of a sequence are known to have completed, with vector clocks
+*/
+
+#pragma once
+
+#include "tenzing/cuda/ops_cuda.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*! \brief the happens-before relation of a sequence of operations
+
+    The host and each stream are timelines. Each timeline has a vector clock: for every timeline,
+    the position in the sequence of the latest operation on that timeline that is known to be
+    complete before anything next issued on this timeline starts. Operations on a stream complete
+    in order, so that covers every earlier operation on the stream as well.
+
+    Appending an operation updates one clock in O(number of timelines):
+    - operations in a stream follow everything the host has done before issuing them
+    - a CudaEventRecord snapshots its stream's clock into the event
+    - a CudaStreamWaitEvent merges the event's snapshot into the waiting stream's clock
+    - a CudaEventSync merges the event's snapshot into the host clock
+    - a StreamSync merges the stream's clock into the host clock
+
+    Sync queries are then comparisons against a clock instead of scans of the sequence.
+*/
+class HappensBefore {
+public:
+  typedef int64_t position_t; // a position in the sequence, or -1 for none
+  typedef std::vector<position_t> Clock;
+
+private:
+  struct Snapshot {
+    Clock clock;
+    position_t record = -1; // position of the most recent record, -1 if never recorded
+  };
+
+public:
+  /*! \brief what undo() needs to reverse one append()
+   */
+  struct Undo {
+    size_t timeline = 0; // the timeline whose clock changed
+    Clock clock;         // its previous clock
+    bool hasEvent = false;
+    size_t event = 0;   // the event whose snapshot changed, if hasEvent
+    Snapshot snapshot;  // its previous snapshot
+    OpBase::id_t added = 0; // unbound id of an operation append() first saw, or 0
+    Event::id_t nextEvent = 0; // the previous new_unique_event()
+  };
+
+  HappensBefore() = default;
+
+  /*! \brief the relation after every operation in \c path
+   */
+  explicit HappensBefore(const Sequence<BoundOp> &path);
+
+  /*! \brief update the clocks for \c op executed next
+   */
+  Undo append(const std::shared_ptr<BoundOp> &op);
+
+  /*! \brief reverse the most recent append() that has not been undone
+   */
+  void undo(const Undo &u);
+
+  /*! \brief the first operation in the sequence with the same unbound id as \c op, or nullptr
+   */
+  std::shared_ptr<BoundOp> find_unbound(const std::shared_ptr<OpBase> &op) const;
+
+  /*! \brief true if GPU operation \c a is complete before anything issued next in \c waiter starts
+   */
+  bool stream_knows(const Stream &waiter, const std::shared_ptr<BoundGpuOp> &a) const;
+
+  /*! \brief true if GPU operation \c a is complete before anything the host does next
+   */
+  bool host_knows(const std::shared_ptr<BoundGpuOp> &a) const;
+
+  /*! \brief set \c event to an event whose most recent record covers \c a, preferring the
+      earliest record. false if there is no such event
+  */
+  bool covering_event(const std::shared_ptr<BoundGpuOp> &a, Event &event) const;
+
+  /*! \brief an event id not used by any operation so far: one more than the largest one
+   */
+  Event new_unique_event() const { return Event(nextEvent_); }
+
+  /// the number of operations appended
+  size_t size() const { return size_; }
+
+private:
+  static const size_t host = 0;
+  static size_t timeline(const Stream &stream) { return size_t(stream.id_) + 1; }
+  static position_t get(const Clock &c, size_t i) { return i < c.size() ? c[i] : -1; }
+  static void merge(Clock &dst, const Clock &src);
+
+  // the position of a in the sequence, or throw
+  position_t position(const std::shared_ptr<BoundOp> &a) const;
+
+  Clock &clock(size_t i);
+  Snapshot &snapshot(const Event &event);
+
+  // the stream timeline `s` issues an operation at position p, recording its old clock in u
+  Clock &issue(Undo &u, const Stream &s, position_t p);
+  // record the old snapshot of event in u
+  Snapshot &touch(Undo &u, const Event &event);
+
+  struct Entry {
+    position_t position;
+    std::shared_ptr<BoundOp> op;
+  };
+
+  size_t size_ = 0;
+  Event::id_t nextEvent_ = 0;
+  std::vector<Clock> clocks_;                   // by timeline
+  std::vector<Snapshot> events_;                // by event id
+  std::unordered_map<OpBase::id_t, Entry> ops_; // first position of each unbound id
+};
@@ -37,6 +37,7 @@ protected:
 public:
   Irecv(Args args, const std::string &name) : args_(args), name_(name) {}
   std::string name() const override { return name_; }
+  const Args &args() const { return args_; }
   virtual void run(Platform &plat) override;
 
   CLONE_DEF(Irecv);
@@ -69,6 +70,7 @@ protected:
 public:
   Isend(Args args, const std::string &name) : args_(args), name_(name) {}
   std::string name() const override { return name_; }
+  const Args &args() const { return args_; }
 
   virtual void run(Platform &plat) override;
 
@@ -107,6 +109,7 @@ protected:
 public:
   Ialltoallv(Args args, const std::string &name) : args_(args), name_(name) {}
   std::string name() const override { return name_; }
+  const Args &args() const { return args_; }
 
   virtual void run(Platform &plat) override;
 
@@ -135,6 +138,7 @@ protected:
 public:
   Wait(Args args, const std::string &name) : args_(args), name_(name) {}
   std::string name() const override { return name_; }
+  const Args &args() const { return args_; }
 
   virtual void run(Platform &plat) override;
 
@@ -167,6 +171,7 @@ public:
 
   void add_request(MPI_Request req) { reqs_.push_back(req); }
   std::vector<MPI_Request> &requests() { return reqs_; }
+  const std::vector<MPI_Request> &requests() const { return reqs_; }
 };
 
 /* call MPI_Wait on all operations
@@ -189,4 +194,5 @@ public:
   bool operator<(const MultiWait &rhs) const { return name() < rhs.name(); }
 
   void add_request(MPI_Request *req) { reqs_.push_back(req); }
+  const std::vector<MPI_Request *> &requests() const { return reqs_; }
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <memory>
@@ -29,6 +30,9 @@
  
    the easiest way to ensure this is to give them different names
 
+   Each operation is interned the first time its identity is needed: operations whose values
+   compare equal (the type's operator==, through EQ_DEF) share a compact integer id(), and eq, lt,
+   and hashing are answered from that id.
 */
 
 
@@ -37,26 +41,12 @@
         return std::unique_ptr<OpBase>(static_cast<OpBase *>(new TYPE(*this))); \
     }
 
-#define LT_DEF(TYPE) \
-    virtual bool lt(const std::shared_ptr<OpBase> &rhs) const { \
-        if (tag() < rhs->tag()) {\
-            return true;\
-        } else if (tag() > rhs->tag()) {\
-            return false;\
-        } else {\
-            const auto rp = std::dynamic_pointer_cast<const TYPE>(rhs);\
-            if (!rp) {\
-                std::stringstream ss;\
-                ss << "LT_DEF: " << name() << " <? " << rhs->name();\
-                throw std::runtime_error(ss.str());\
-            }\
-            return *this < *rp;\
-        }\
-    }
+// OpBase::lt orders operations by their interned id, so no per-type ordering is needed
+#define LT_DEF(TYPE) static_assert(true, "LT_DEF(" #TYPE ") is a no-op")
 
 #define EQ_DEF(TYPE) \
-    virtual bool eq(const std::shared_ptr<OpBase> &rhs) const { \
-        auto rp = std::dynamic_pointer_cast<const TYPE>(rhs);\
+    virtual bool eq_value(const OpBase &rhs) const override { \
+        auto rp = dynamic_cast<const TYPE *>(&rhs);\
         if (!rp) return false;\
         else return *this == *rp;\
     }
@@ -64,13 +54,52 @@
 class OpBase
 {
 public:
-    virtual ~OpBase(){};
+    /// identifies all operations that are equal to each other
+    typedef uint64_t id_t;
+
+    OpBase() : id_(0), class_(nullptr), prev_(nullptr), next_(nullptr) {}
+    OpBase(const OpBase &other);            // copies share the id of other
+    OpBase &operator=(const OpBase &other); // takes the id of other
+    virtual ~OpBase();
     virtual std::string name() const = 0;
     virtual std::string desc() const { return name(); }
     virtual nlohmann::json json() const;
     virtual std::unique_ptr<OpBase> clone() = 0;
-    virtual bool eq(const std::shared_ptr<OpBase> &rhs) const = 0;
-    virtual bool lt(const std::shared_ptr<OpBase> &rhs) const = 0;
+
+    /*! \brief true iff this is the same operation as rhs
+     */
+    bool eq(const std::shared_ptr<OpBase> &rhs) const { return id() == rhs->id(); }
+
+    /*! \brief a consistent order of operations
+     */
+    bool lt(const std::shared_ptr<OpBase> &rhs) const { return id() < rhs->id(); }
+
+    /*! \brief compare the values of two operations. Only called to intern a new operation.
+        Defined by EQ_DEF
+     */
+    virtual bool eq_value(const OpBase &rhs) const = 0;
+
+    /*! \brief a hash of the value, consistent with eq_value.
+
+        The default only considers the type. Operations that are created in large numbers should
+       override this, since all operations with the same hash are compared with eq_value() when
+       one is interned.
+     */
+    virtual size_t hash() const { return 0; }
+
+    /*! \brief the interned id of this operation. Operations are interned on first use
+     */
+    id_t id() const {
+        if (0 == id_) {
+            intern();
+        }
+        return id_;
+    }
+
+    /*! \brief the id of the operation this is a bound version of, or id() if not bound
+     */
+    virtual id_t unbound_id() const { return id(); }
+
     virtual int tag() const  {
         return typeid(*this).hash_code();
     }
@@ -83,6 +112,29 @@ public:
             return aLtB;
         }
     };
+
+    // for unordered_map / unordered_set
+    struct hash_id {
+        size_t operator()(const std::shared_ptr<OpBase> &a) const { return a->id(); }
+    };
+    struct compare_eq {
+        bool operator()(const std::shared_ptr<OpBase> &a, const std::shared_ptr<OpBase> &b) const {
+            return a->eq(b);
+        }
+    };
+
+private:
+    struct Class; // the live operations that share an id
+    struct Table; // all classes
+
+    static Table &table();
+    void intern() const;
+    void join(Class *c) const; // become a member of c
+    void leave() const;        // stop being a member of class_
+
+    mutable id_t id_;      // 0 if not yet interned
+    mutable Class *class_; // nullptr if not yet interned
+    mutable const OpBase *prev_, *next_; // other members of class_
 };
 
 /*! \brief not executable, represents multiple implementation choices for an operation
@@ -96,14 +148,30 @@ public:
 class BoundOp : public OpBase {
 public:
     virtual void run(Platform &/*plat*/) = 0;
+
+    /*! \brief true if executing this and `other` in either order runs the same way,
+        so a search only needs to try one of the orders. Conservatively false.
+
+        Only one of the two operations needs to declare the independence, see independent()
+    */
+    virtual bool independent_of(const BoundOp &/*other*/) const { return false; }
 };
 
+// true if either operation declares it is independent of the other
+inline bool independent(const BoundOp &a, const BoundOp &b) {
+    return a.independent_of(b) || b.independent_of(a);
+}
+
 
 class CpuOp : public BoundOp
 {};
 
 
 
+inline size_t hash_combine(size_t seed, size_t v) {
+    return seed ^ (v + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
 // keep unique entries in v
 void keep_uniques(std::vector<std::shared_ptr<BoundOp>> &v);
 
@@ -153,7 +221,10 @@ public:
     bool operator==(const NoOp &rhs) const {
         return name_ == rhs.name_;
     }
+    size_t hash() const override { return std::hash<std::string>()(name_); }
     virtual void run(Platform &/*plat*/) override {};
+    // does nothing, so can't interact with anything
+    bool independent_of(const BoundOp &/*other*/) const override { return true; }
 };
 
 
@@ -0,0 +1,76 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Approximate quantiles and histograms of a stream of values in bounded memory
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*! \brief a mergeable summary of a stream of values
+
+    A KLL sketch: values go into a buffer that, when full, is sorted and compacted by keeping
+    every other value at twice the weight in the level above. Lower levels get smaller buffers,
+    so about 3k values are kept however many are inserted, and a quantile is off by about 1/k of
+    the count in rank.
+
+    The count, minimum, maximum, and mean are exact. Until the first buffer fills (`k` values),
+    nothing is compacted and quantiles and histograms are exact too.
+*/
+class QuantileSketch {
+public:
+  explicit QuantileSketch(size_t k = 200);
+
+  void insert(double x);
+
+  /// add the values summarized by `other`
+  void merge(const QuantileSketch &other);
+
+  /// how many values have been inserted
+  uint64_t count() const { return n_; }
+  bool empty() const { return 0 == n_; }
+
+  double min() const { return min_; }
+  double max() const { return max_; }
+  double mean() const { return sum_ / n_; }
+
+  /// the value at position floor(q * count()) of the inserted values in sorted order
+  double quantile(double q) const;
+
+  /// about how many inserted values are less than x
+  uint64_t count_below(double x) const;
+
+  /*! \brief about how many values fall into each of `nBins` equal bins between lo and hi
+
+      The first bin also counts values below lo, and the last bin values at or above hi
+  */
+  std::vector<uint64_t> histogram(size_t nBins, double lo, double hi) const;
+
+  /// how many values the sketch is holding
+  size_t retained() const;
+
+private:
+  size_t capacity(size_t level) const;
+  // compact any level that is full, into the level above
+  void compress();
+  // sort the retained values and their cumulative weights into view_
+  void update_view() const;
+
+  size_t k_;
+  uint64_t n_;
+  double min_;
+  double max_;
+  double sum_;
+  std::vector<std::vector<double>> levels_; // values in level h have weight 2^h
+  bool odd_;                                // which half the next compaction keeps
+
+  mutable std::vector<std::pair<double, uint64_t>> view_; // (value, weight up to and including)
+  mutable bool stale_;
+};
@@ -0,0 +1,81 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Track which graph vertices are ready to execute as a sequence grows
+*/
+
+#pragma once
+
+#include "tenzing/graph.hpp"
+#include "tenzing/operation.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <vector>
+
+namespace SDP {
+
+/*! \brief the vertices of a graph whose predecessors have all been executed
+
+    Keeps the number of unexecuted predecessors of each vertex, so executing an operation costs
+    O(out-degree) instead of re-deriving the frontier from the whole sequence.
+
+    Vertex ids are stable across Graph::replace, so binding an operation to a stream or making a
+    choice does not change the ready set. Expanding a CompoundOp adds and removes vertices, so the
+    ready set must be rebuilt.
+
+    ready() is in no particular order: an executed vertex is replaced by the last ready vertex, so
+    removing it is constant time.
+*/
+class ReadySet {
+public:
+  typedef Graph<OpBase>::vid_t vid_t;
+
+  static const size_t NOT_READY = size_t(-1);
+
+  ReadySet() = default;
+
+  /*! \brief the ready set of \c graph after every operation in \c done has been executed
+   */
+  ReadySet(const Graph<OpBase> &graph, const Sequence<BoundOp> &done);
+
+  /*! \brief what undo() needs to reverse one execute()
+   */
+  struct Undo {
+    vid_t v;    // the executed vertex, or Graph::npos if execute() had no effect
+    size_t pos; // where v was in ready(), or NOT_READY
+  };
+
+  /*! \brief record that \c op has been executed.
+
+      Operations that are not in \c graph (e.g. inserted synchronizations) are ignored
+   */
+  Undo execute(const Graph<OpBase> &graph, const std::shared_ptr<OpBase> &op);
+
+  /*! \brief record that the operation at vertex \c v has been executed
+   */
+  Undo execute(const Graph<OpBase> &graph, vid_t v);
+
+  /*! \brief reverse the most recent execute() that has not been undone, restoring ready() to
+      exactly its previous order
+   */
+  void undo(const Graph<OpBase> &graph, const Undo &u);
+
+  /*! \brief ids of the unexecuted vertices whose predecessors have all been executed
+   */
+  const std::vector<vid_t> &ready() const { return ready_; }
+
+  bool is_done(vid_t v) const { return v < done_.size() && done_[v]; }
+
+private:
+  void push(vid_t v);
+
+  std::vector<size_t> remaining_; // number of unexecuted predecessors of each vertex
+  std::vector<bool> done_;
+  std::vector<vid_t> ready_;
+  std::vector<size_t> pos_; // where each vertex is in ready_, or NOT_READY
+};
+
+} // namespace SDP
@@ -0,0 +1,129 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief A binary file of benchmarked sequences that loads without parsing
+*/
+
+#pragma once
+
+#include "tenzing/benchmarker.hpp"
+#include "tenzing/sequence.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! \brief a memory-mapped file of benchmark results
+
+    The same information as the CSV written by the searches, laid out so it can be used in place:
+    \li the text before the rows (e.g. the search options)
+    \li each result field as a column of doubles
+    \li each sequence as an array of indices into a table of operations
+    \li the table of operations, each the JSON text of one distinct operation
+
+    Numbers are in the byte order of the machine that wrote the file.
+*/
+class ResultFile {
+public:
+  enum Column { pct01, pct10, pct50, pct90, pct99, stddev, nColumns };
+
+  // the start of every result file, with its layout
+  struct Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t nRows;
+    uint64_t nOps;
+    uint64_t nCells;  // total length of all sequences
+    uint64_t textSize;
+    uint64_t dictSize;
+    // bytes from the start of the file to each section
+    uint64_t columns;  // double[nColumns][nRows]
+    uint64_t rowStart; // uint64_t[nRows + 1], offset of each row in cells
+    uint64_t cells;    // uint32_t[nCells]
+    uint64_t opStart;  // uint64_t[nOps + 1], offset of each operation in dict
+    uint64_t dict;     // char[dictSize]
+    uint64_t text;     // char[textSize]
+  };
+
+  static const char MAGIC[8];
+  static const uint64_t VERSION = 1;
+
+  /// map the file at `path`, throws if it is not a result file
+  explicit ResultFile(const std::string &path);
+  ~ResultFile();
+  ResultFile(const ResultFile &other) = delete;
+  ResultFile &operator=(const ResultFile &rhs) = delete;
+
+  /// whether `path` starts like a result file
+  static bool is_result_file(const std::string &path);
+
+  /// number of rows
+  size_t size() const { return header_->nRows; }
+  /// number of distinct operations
+  size_t num_ops() const { return header_->nOps; }
+
+  /// the `c` field of every row
+  const double *column(Column c) const {
+    return reinterpret_cast<const double *>(base_ + header_->columns) + c * size();
+  }
+  Benchmark::Result result(size_t i) const;
+
+  /// the operations in row `i`, as indices for op()
+  const uint32_t *row_begin(size_t i) const { return cells_ + rowStart_[i]; }
+  const uint32_t *row_end(size_t i) const { return cells_ + rowStart_[i + 1]; }
+
+  /// the JSON text of operation `k`
+  std::string op(size_t k) const {
+    return std::string(dict_ + opStart_[k], opStart_[k + 1] - opStart_[k]);
+  }
+
+  /// the text before the rows
+  std::string text() const { return std::string(base_ + header_->text, header_->textSize); }
+
+private:
+  const char *base_;
+  size_t length_;
+  const Header *header_;
+  const uint64_t *rowStart_;
+  const uint32_t *cells_;
+  const uint64_t *opStart_;
+  const char *dict_;
+};
+
+/*! \brief collects rows in memory and writes them as a ResultFile
+ */
+class ResultFileWriter {
+public:
+  explicit ResultFileWriter(const std::string &text = "");
+
+  /// add a row whose operations are JSON text
+  void add(const Benchmark::Result &result, const std::vector<std::string> &ops);
+  void add(const Benchmark::Result &result, const Sequence<BoundOp> &seq);
+
+  size_t size() const { return rowStart_.size() - 1; }
+
+  void write(const std::string &path) const;
+
+private:
+  std::string text_;
+  std::vector<double> columns_[ResultFile::nColumns];
+  std::vector<uint64_t> rowStart_;
+  std::vector<uint32_t> cells_;
+  std::vector<std::string> ops_;
+  std::unordered_map<std::string, uint32_t> opIds_;
+};
+
+/*! \brief convert a '|'-delimited CSV of results into a ResultFile
+
+    Each row is an index, the result fields, and the JSON of each operation, as written by the
+    searches. A first line that does not start with an index is kept as the file's text().
+*/
+void csv_to_result_file(const std::string &csvPath, const std::string &path);
+
+/// write a ResultFile as the CSV it was converted from
+void result_file_to_csv(const std::string &path, std::ostream &os);
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <vector>
@@ -17,98 +18,177 @@
 /*! \brief Represents a sequence of operations in a program
 
      basically a std::vector<std::shared_ptr<OpType> with some extra stuff
+
+     The operations are stored as a persistent list of links to the previous operation, so a copy
+     shares its prefix with the original. Copying and push_back() are O(1) time and memory, which
+     lets a search (e.g. MCTS nodes and SDP::State) extend a sequence without copying it.
+     Iteration and indexing use a vector that is materialized from the list on first use, and
+     then kept up to date by push_back() and pop_back().
+
+     Elements may not be modified through iterators or operator[]; use erase() and push_back().
+     The materialized vector is filled in by const member functions, so a Sequence is not safe to
+     read from multiple threads at once.
 */
 template <typename OpType> class Sequence {
 public:
   typedef std::shared_ptr<OpType> value_type;
   typedef std::vector<value_type> vector_type;
-  typedef typename vector_type::iterator iterator;
+  typedef typename vector_type::const_iterator iterator;
   typedef typename vector_type::const_iterator const_iterator;
   typedef typename vector_type::size_type size_type;
-  typedef typename vector_type::reference reference;
+  typedef typename vector_type::const_reference reference;
   typedef typename vector_type::const_reference const_reference;
 
 private:
-  vector_type ops_;
+  // an operation and the sequence before it
+  struct Link {
+    value_type op;
+    std::shared_ptr<const Link> prev;
+    size_type size; // number of operations up to and including this one
+    Event::id_t nextEvent; // one more than the largest event id up to and including this one
+  };
+
+  std::shared_ptr<const Link> last_;
+  mutable vector_type ops_;        // the operations in last_, if materialized_
+  mutable bool materialized_ = true; // an empty sequence is trivially materialized
+
+  const vector_type &materialize() const {
+    if (!materialized_) {
+      ops_.resize(size());
+      for (const Link *l = last_.get(); l; l = l->prev.get()) {
+        ops_[l->size - 1] = l->op;
+      }
+      materialized_ = true;
+    }
+    return ops_;
+  }
+
+  void link(const value_type &val) {
+    Event::id_t nextEvent = last_ ? last_->nextEvent : 0;
+    if (auto he = std::dynamic_pointer_cast<HasEvent>(val)) {
+      for (const Event &event : he->get_events()) {
+        nextEvent = std::max(nextEvent, event.id_ + 1);
+      }
+    }
+    last_ = std::make_shared<const Link>(Link{val, last_, size() + 1, nextEvent});
+  }
+
+  // release links no other sequence shares one at a time, instead of recursively
+  void unlink() {
+    while (last_ && 1 == last_.use_count()) {
+      std::shared_ptr<const Link> prev = last_->prev;
+      last_ = std::move(prev);
+    }
+    last_.reset();
+  }
 
 public:
   Sequence() = default;
-  Sequence(const Sequence &other) = default;
-  Sequence(Sequence &&other) = default;
-  Sequence(std::initializer_list<value_type> il) : ops_(il) {}
+  Sequence(const Sequence &other) : last_(other.last_), materialized_(!other.last_) {}
+  Sequence(Sequence &&other)
+      : last_(std::move(other.last_)), ops_(std::move(other.ops_)),
+        materialized_(other.materialized_) {
+    other.ops_.clear();
+    other.materialized_ = true;
+  }
+  Sequence(std::initializer_list<value_type> il) {
+    for (const value_type &val : il) {
+      push_back(val);
+    }
+  }
+  ~Sequence() { unlink(); }
 
   Sequence &operator=(std::initializer_list<value_type> il) {
-    ops_ = il;
+    clear();
+    for (const value_type &val : il) {
+      push_back(val);
+    }
+    return *this;
+  }
+  Sequence &operator=(const Sequence &rhs) {
+    if (this != &rhs) {
+      std::shared_ptr<const Link> last = rhs.last_;
+      unlink();
+      last_ = std::move(last);
+      ops_.clear();
+      materialized_ = !last_;
+    }
+    return *this;
+  }
+  Sequence &operator=(Sequence &&rhs) {
+    if (this != &rhs) {
+      unlink();
+      last_ = std::move(rhs.last_);
+      ops_ = std::move(rhs.ops_);
+      materialized_ = rhs.materialized_;
+      rhs.ops_.clear();
+      rhs.materialized_ = true;
+    }
     return *this;
   }
-  Sequence &operator=(const Sequence &rhs) = default;
 
   /*! \brief true if Sequence contains e or an unbound version of e
   */
   bool contains_unbound(const std::shared_ptr<OpBase> &e) const {
-    // unbound version if bound
-    std::shared_ptr<OpBase> ue;
-    if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(e)) {
-      ue = bgo->unbound();
-    } else {
-      ue = e;
-    }
-
-    for (const auto &ve : ops_) {
-
-      // get unbound version if bound
-      std::shared_ptr<OpBase> uve;
-      if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(ve)) {
-        uve = bgo->unbound();
-      } else {
-        uve = ve;
-      }
-
-      if (uve->eq(ue)) {
-        return true;
-      }
-    }
-    return false;
+    return end() != find_unbound(e);
   }
 
   /// \brief true iff e is in unbound ops_
   const_iterator find_unbound(const std::shared_ptr<OpBase> &e) const;
 
-  Event new_unique_event() const {
-    std::set<Event> taken;
+  /*! \brief an event not used in the sequence: one more than the largest event id. O(1)
 
-    for (const auto &op : ops_) {
-      if (auto he = std::dynamic_pointer_cast<HasEvent>(op)) {
-        for (const Event &event : he->get_events()) {
-          taken.insert(event);
-        }
-      }
-    }
+      Ids are not reused, see recolor_events() to reuse them once their lifetimes are over
+  */
+  Event new_unique_event() const { return Event(last_ ? last_->nextEvent : 0); }
 
-    for (Event::id_t id = 0; true; ++id) {
-      if (0 == taken.count(Event(id))) {
-        return Event(id);
-      }
-    }
+  const vector_type &vector() const { return materialize(); }
+
+  void clear() {
+    unlink();
+    ops_.clear();
+    materialized_ = true;
   }
 
-  const vector_type &vector() const {return ops_;}
+  /*! \brief remove the operation at position. O(size()), since the links after it are rebuilt
+  */
+  iterator erase(const_iterator position) {
+    const size_type i = position - begin();
+    vector_type ops(ops_.begin() + i + 1, ops_.end());
 
-  void clear() {ops_.clear();}
-  iterator erase(const_iterator position) {return ops_.erase(position); }
+    // drop the links after and including position, then relink the rest
+    while (size() > i) {
+      last_ = last_->prev;
+    }
+    for (const value_type &op : ops) {
+      link(op);
+    }
+    ops_.erase(ops_.begin() + i);
+    return ops_.begin() + i;
+  }
+
+  void push_back(const value_type &val) {
+    link(val);
+    if (materialized_) {
+      ops_.push_back(val);
+    }
+  }
+  void pop_back() {
+    last_ = last_->prev;
+    if (materialized_) {
+      ops_.pop_back();
+    }
+  }
 
-  void push_back(const value_type &val) { ops_.push_back(val); }
-  void push_back(value_type &&val) { ops_.push_back(val); }
+  const_iterator begin() const { return materialize().begin(); }
+  const_iterator end() const { return materialize().end(); }
 
-  iterator begin() noexcept { return ops_.begin(); }
-  const_iterator begin() const noexcept { return ops_.begin(); }
-  iterator end() noexcept { return ops_.end(); }
-  const_iterator end() const noexcept { return ops_.end(); }
+  size_type size() const noexcept { return last_ ? last_->size : 0; }
 
-  size_type size() const noexcept { return ops_.size(); }
+  /// the last operation, without materializing the sequence
+  const_reference back() const { return last_->op; }
 
-  reference operator[](size_type n) {return ops_[n];}
-  const_reference operator[](size_type n) const {return ops_[n];}
+  const_reference operator[](size_type n) const { return materialize()[n]; }
 };
 
 #if 0
@@ -131,10 +211,42 @@ template <typename OP> Event new_unique_event(const Sequence<OP> &seq) {
 }
 #endif
 
+/*! \brief the same program as \c seq, with events renumbered so events whose lifetimes do not
+    overlap share an id
+
+    Each record of an event (CudaEventRecord or StreamWait) starts a lifetime that lasts until the
+    last wait or sync on the event before it is recorded again. Lifetimes are colored greedily in
+    order of their start, which uses as few events as the most lifetimes alive at once.
+    Returns \c seq if it uses an unexpected kind of operation with events.
+    The solvers do not recolor the sequences they benchmark and record, since results recorded with
+    other event ids would not match them; provision_events() shares the cudaEvent_ts instead.
+*/
+Sequence<BoundOp> recolor_events(const Sequence<BoundOp> &seq);
+
+/*! \brief for each event in \c seq, which of as few cudaEvent_ts as possible it can use
+
+    Events none of whose lifetimes (see recolor_events()) overlap share one, in order of first use.
+    Each event gets its own if \c seq uses an unexpected kind of operation with events.
+*/
+std::map<Event, size_t> share_events(const Sequence<BoundOp> &seq);
+
+/*! \brief a cudaEvent_t from \c pool (after resetting it) for each event used in \c seq, shared
+    by events whose lifetimes do not overlap, see share_events()
+ */
+ResourceMap provision_events(const Sequence<BoundOp> &seq, CudaEventPool &pool);
+
 // try to discover an equivalence between two sequences.
 // if not, return falsy
 Equivalence get_equivalence(const Sequence<BoundOp> &a, const Sequence<BoundOp> &b);
 
+/*! \brief a text form of \c seq that is the same for any relabeling of its streams and events
+
+    Each operation is its name with its streams and events renumbered in order of first
+    appearance, so sequences with the same key are the ones get_equivalence() relates. Unlike
+    SDP::Fingerprint it does not use operation ids, so it is the same in every run of the program.
+*/
+std::string canonical_sequence(const Sequence<BoundOp> &seq);
+
 /* broadcast `order` from rank 0 to the other ranks
  */
 Sequence<BoundOp> mpi_bcast(const Sequence<BoundOp> &order, const Graph<OpBase> &g, MPI_Comm comm);
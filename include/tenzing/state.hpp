@@ -1,51 +1,193 @@
 #pragma once
 
 #include "decision.hpp"
-#include "event_synchronizer.hpp"
 #include "graph.hpp"
+#include "happens_before.hpp"
 #include "platform.hpp"
+#include "ready_set.hpp"
 #include "sequence.hpp"
+#include "sync_policy.hpp"
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace SDP {
 
+/*! \brief a canonical form of a State
+
+    Two states have equal fingerprints when some relabeling of streams and events makes them the
+    same (the bijections modeled by Equivalence). Streams and events are renumbered in order of
+    first appearance, walking the sequence and then the graph vertices ordered by operation id.
+*/
+class Fingerprint {
+  std::vector<uint64_t> key_;
+  size_t hash_;
+
+public:
+  Fingerprint() : hash_(0) {}
+  explicit Fingerprint(std::vector<uint64_t> &&key);
+
+  bool operator==(const Fingerprint &rhs) const { return hash_ == rhs.hash_ && key_ == rhs.key_; }
+  bool operator!=(const Fingerprint &rhs) const { return !(*this == rhs); }
+  size_t hash() const { return hash_; }
+  size_t size() const { return key_.size(); } ///< the length of the key
+
+  struct Hash {
+    size_t operator()(const Fingerprint &f) const { return f.hash(); }
+  };
+};
+
 /*! \brief a state in the sequential decision process
  */
 class State {
   Graph<OpBase> graph_;
   Sequence<BoundOp> sequence_;
-  typedef EventSynchronizer Synchronizer;
+  ReadySet ready_; // vertices of graph_ that can be executed after sequence_
+  HappensBefore hb_; // which operations of sequence_ are known to be complete where
+  SyncPolicy sync_ = SyncPolicy::event;
+
+  // partial-order reduction: operations whose execution from here is covered by another branch
+  bool por_ = false;
+  std::vector<std::shared_ptr<BoundOp>> sleep_;
+
+  bool is_asleep(const std::shared_ptr<BoundOp> &op) const;
+
+  struct Apply; // apply() for each kind of Decision
+  friend class SearchState;
+
+  // with partial-order reduction, put to sleep the earlier decisions that commute with decisions[i]
+  void sleep_siblings(const std::vector<Decision> &decisions, size_t i);
+
+  // the streams of plat an operation may be assigned to, see get_decisions()
+  std::vector<Stream> assignable_streams(const Platform &plat) const;
 
 public:
   State(const Graph<OpBase> &graph, const Sequence<BoundOp> &sequence)
-      : graph_(graph), sequence_(sequence) {}
+      : graph_(graph), sequence_(sequence), ready_(graph_, sequence_), hb_(sequence_) {}
 
   /// \brief create a initial state for graph (start vertex in the sequence)
   State(const Graph<OpBase> &graph) : graph_(graph) {
     auto startAsBound = std::dynamic_pointer_cast<BoundOp>(graph.start());
     sequence_ = Sequence<BoundOp>({startAsBound});
+    ready_ = ReadySet(graph_, sequence_);
+    hb_ = HappensBefore(sequence_);
   }
 
   const Sequence<BoundOp> &sequence() const { return sequence_; }
   const Graph<OpBase> &graph() const { return graph_; }
+  const HappensBefore &happens_before() const { return hb_; }
+
+  /*! \brief enable or disable partial-order reduction for this state and states derived from it
+
+      When enabled, each state keeps a "sleep set" of operations that an earlier sibling already
+      executed and that are independent (BoundOp::independent_of) of everything executed since.
+      Executing a sleeping operation would only reorder a sequence that is generated elsewhere, so
+      get_decisions() omits it. Only one of each group of sequences that differ by swapping
+      adjacent independent operations is generated.
+
+      A state whose only remaining operations are asleep has no decisions but is not complete().
+   */
+  void set_partial_order_reduction(bool enable) {
+    por_ = enable;
+    sleep_.clear();
+  }
+  bool partial_order_reduction() const { return por_; }
+  const std::vector<std::shared_ptr<BoundOp>> &sleep_set() const { return sleep_; }
+
+  /*! \brief how get_decisions() synchronizes an operation with its predecessors, for this state
+      and states derived from it
+
+      With SyncPolicy::search, each way of synchronizing a dependence is a separate decision
+   */
+  void set_sync_policy(SyncPolicy policy) { sync_ = policy; }
+  SyncPolicy sync_policy() const { return sync_; }
+
+  /*! \brief true if every operation in the graph has been executed
+   */
+  bool complete() const { return ready_.ready().empty(); }
 
   /*! \brief return any required synchronization operations needed between this state and `op`
+
+      Compares the vector clocks in happens_before() instead of scanning the sequence
    */
   std::vector<std::shared_ptr<BoundOp>>
   get_syncs_before_op(const std::shared_ptr<BoundOp> &op) const;
 
   /*! \brief Get all possible decisions available from this state
+
+      Streams that are not used yet are interchangeable, so a GpuOp may only be assigned to the
+      streams already in use and the first unused stream of \c plat
    */
-  std::vector<std::shared_ptr<Decision>> get_decisions(Platform &plat, const bool quiet = true) const;
+  std::vector<Decision> get_decisions(Platform &plat, const bool quiet = true) const;
 
   /*! \brief return the state resulting applying decision to this state
    */
   State apply(const Decision &d) const;
 
   /*! \brief return the unique states resulting from all possible decisions
+
+      States with the same fingerprint() are only returned once
    */
   std::vector<State> frontier(Platform &plat, bool quiet = true);
+
+  /*! \brief a canonical form of this state, the same for equivalent states
+   */
+  Fingerprint fingerprint() const;
+
+  /*! \brief like fingerprint(), but the same for states whose sequences are reorderings of each
+      other that only swap operations that are independent() (e.g. two NoOps, or launches into two
+      different streams, executed in either order)
+   */
+  Fingerprint transposition_fingerprint() const;
+};
+
+/*! \brief a State that is modified in place, for depth-first search
+
+    apply() records how to reverse each decision, and undo() reverses the most recent one. Executing
+    an operation or binding one only records a few words, so a search path costs O(depth) memory
+    instead of a State copy per visited state. Expanding a CompoundOp renumbers the graph
+    vertices, so the previous graph (which shares its unchanged chunks with the new one) and ready
+    set are kept instead.
+*/
+class SearchState {
+public:
+  explicit SearchState(const State &initial) : state_(initial) {}
+
+  /// the current state
+  const State &state() const { return state_; }
+
+  /// the number of decisions that can be undone
+  size_t depth() const { return log_.size(); }
+
+  /*! \brief apply \c d to this state in place
+   */
+  void apply(const Decision &d);
+
+  /*! \brief apply decisions[i], where \c decisions are the get_decisions() of this state.
+
+      Like State::frontier(), updates the partial-order reduction sleep set with decisions[0..i)
+   */
+  void apply(const std::vector<Decision> &decisions, size_t i);
+
+  /*! \brief reverse the most recent apply()
+   */
+  void undo();
+
+private:
+  struct Undo {
+    Decision::Kind kind;
+    ReadySet::Undo ready;                        // execute
+    HappensBefore::Undo hb;                      // execute
+    Graph<OpBase>::vid_t v;                      // assign, choose: the replaced vertex
+    std::shared_ptr<OpBase> replaced;            // assign, choose: its operation
+    std::unique_ptr<Graph<OpBase>> graph;        // expand
+    std::unique_ptr<ReadySet> readySet;          // expand
+    std::vector<std::shared_ptr<BoundOp>> sleep; // all
+  };
+
+  State state_;
+  std::vector<Undo> log_;
 };
 
 
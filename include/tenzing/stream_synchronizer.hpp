@@ -0,0 +1,56 @@
+#pragma once
+
+#include "event_synchronizer.hpp"
+#include "synchronizer.hpp"
+
+// uses cudaStreamSynchronize for synchronization
+// the host waits for the predecessor's whole stream, and later GPU operations are issued after it
+struct StreamSyncSynchronizer : public SynchronizerBase<StreamSyncSynchronizer> {
+
+  // return a StreamSync of a's stream, or falsy if no sync is needed
+  static std::shared_ptr<BoundOp> make_sync_gpu_then_cpu(const std::shared_ptr<BoundGpuOp> &a,
+                                                         const std::shared_ptr<CpuOp> &b,
+                                                         const HappensBefore &hb) {
+    if (is_synced_gpu_then_cpu(a, b, hb)) {
+      return std::shared_ptr<BoundOp>(); // falsy
+    }
+    auto SS = std::make_shared<StreamSync>(a->stream());
+    SS->update_name({a}, {b});
+    return SS;
+  }
+
+  // return a StreamSync of a's stream, or falsy if no sync is needed
+  static std::shared_ptr<BoundOp> make_sync_gpu_then_gpu(const std::shared_ptr<BoundGpuOp> &a,
+                                                         const std::shared_ptr<BoundGpuOp> &b,
+                                                         const HappensBefore &hb) {
+    if (is_synced_gpu_then_gpu(a, b, hb)) {
+      return std::shared_ptr<BoundOp>();
+    }
+    auto SS = std::make_shared<StreamSync>(a->stream());
+    SS->update_name({a}, {b});
+    return SS;
+  }
+};
+
+// uses StreamWait (a fused cudaEventRecord and cudaStreamWaitEvent) between streams,
+// and falls back to EventSynchronizer for the host
+struct StreamWaitSynchronizer : public SynchronizerBase<StreamWaitSynchronizer> {
+
+  static std::shared_ptr<BoundOp> make_sync_gpu_then_cpu(const std::shared_ptr<BoundGpuOp> &a,
+                                                         const std::shared_ptr<CpuOp> &b,
+                                                         const HappensBefore &hb) {
+    return EventSynchronizer::make_sync_gpu_then_cpu(a, b, hb);
+  }
+
+  // return a StreamWait of b's stream on a's stream, or falsy if no sync is needed
+  static std::shared_ptr<BoundOp> make_sync_gpu_then_gpu(const std::shared_ptr<BoundGpuOp> &a,
+                                                         const std::shared_ptr<BoundGpuOp> &b,
+                                                         const HappensBefore &hb) {
+    if (is_synced_gpu_then_gpu(a, b, hb)) {
+      return std::shared_ptr<BoundOp>();
+    }
+    auto SW = std::make_shared<StreamWait>(a->stream(), b->stream(), hb.new_unique_event());
+    SW->update_name({a}, {b});
+    return SW;
+  }
+};
@@ -0,0 +1,49 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Choose how operations are synchronized with their predecessors
+*/
+
+#pragma once
+
+#include "graph.hpp"
+#include "happens_before.hpp"
+#include "operation.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+
+/*! \brief which synchronizer adds the syncs an operation is missing
+
+    The policy only changes which synchronization operations are generated. Whether an operation
+    is already synced only depends on the sequence, so it is the same for every policy.
+*/
+enum class SyncPolicy {
+  event,       ///< EventSynchronizer: CudaEventRecord then CudaStreamWaitEvent or CudaEventSync
+  stream_sync, ///< StreamSyncSynchronizer: StreamSync of the predecessor's stream on the host
+  stream_wait, ///< StreamWaitSynchronizer: StreamWait between streams, events for the host
+  search       ///< the syncs of every other policy, each one a separate decision
+};
+
+const char *to_string(SyncPolicy policy);
+void to_json(nlohmann::json &j, const SyncPolicy &policy);
+void from_json(const nlohmann::json &j, SyncPolicy &policy);
+
+/*! \brief true iff \c bo is synced with all of its predecessors in the sequence of \c hb
+ */
+bool is_synced(const std::shared_ptr<BoundOp> &bo, const Graph<OpBase> &g,
+               const HappensBefore &hb);
+
+/*! \brief the operations to add after the sequence of \c hb to help synchronize \c bo with its
+    predecessors, according to \c policy. Empty if \c bo is synced
+
+    With SyncPolicy::search, the distinct syncs from every other policy
+*/
+std::vector<std::shared_ptr<BoundOp>> make_syncs(SyncPolicy policy,
+                                                 const std::shared_ptr<BoundOp> &bo,
+                                                 const Graph<OpBase> &g, const HappensBefore &hb);
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "graph.hpp"
+#include "happens_before.hpp"
+#include "operation.hpp"
+#include "sequence.hpp"
+
+#include <sstream>
+
+/* what every synchronizer has in common
+
+   Whether an operation is synced with its predecessors only depends on the sequence, which
+   the vector clocks in a HappensBefore answer. `Policy` decides which operations to add when
+   it is not:
+
+   static std::shared_ptr<BoundOp> make_sync_gpu_then_cpu(a, b, hb);
+   static std::shared_ptr<BoundOp> make_sync_gpu_then_gpu(a, b, hb);
+
+   return the next sync missing between GPU operation a and its successor b, or falsy if none.
+   The overloads that take a Sequence build the HappensBefore for that sequence first.
+*/
+template <typename Policy> struct SynchronizerBase {
+
+  // true if a is complete before anything the host does next
+  static bool is_synced_gpu_then_cpu(const std::shared_ptr<BoundGpuOp> &a,
+                                     const std::shared_ptr<CpuOp> & /*b*/,
+                                     const HappensBefore &hb) {
+    return hb.host_knows(a);
+  }
+
+  // true if a is complete before anything next issued in b's stream
+  static bool is_synced_gpu_then_gpu(const std::shared_ptr<BoundGpuOp> &a,
+                                     const std::shared_ptr<BoundGpuOp> &b,
+                                     const HappensBefore &hb) {
+
+    STDERR("is_synced_gpu_then_gpu for " << a->desc() << " -> " << b->desc());
+
+    // implicitly synced already if in the same stream
+    if (a->stream() == b->stream()) {
+      return true;
+    }
+    // b's stream will follow anything the host knows about when b is issued
+    return hb.stream_knows(b->stream(), a) || hb.host_knows(a);
+  }
+
+  // true iff bo is in the sequence and is synced with all preds in the sequence
+  static bool is_synced(const std::shared_ptr<BoundOp> &bo, const Graph<OpBase> &g,
+                        const HappensBefore &hb) {
+
+    // graph may contain bo or the unbound version of bo
+    Graph<OpBase>::vid_t v = g.find_or_find_unbound(bo);
+    if (Graph<OpBase>::npos == v) {
+      THROW_RUNTIME("couldn't find BoundOp " << bo->name() << " in graph");
+    }
+
+    // find all ops on path that are predecessors of bo
+    for (const auto &gPred : g.preds(v)) { // predecessor in the graph
+
+      // find the predecessor in the path
+      const std::shared_ptr<BoundOp> pred = hb.find_unbound(gPred);
+      if (!pred) {
+        THROW_RUNTIME("couldn't find " << gPred->desc() << " in path (pred of " << bo->desc()
+                                       << ")");
+      }
+
+      STDERR("is_synced: is " << bo->desc() << " synced with pred " << pred->desc() << "?");
+
+      // various CPU/GPU sync combinations
+      // predicates are check in the graph, so they're not Bound
+      auto bCpu = std::dynamic_pointer_cast<CpuOp>(bo);
+      auto bGpu = std::dynamic_pointer_cast<BoundGpuOp>(bo);
+      auto pCpu = std::dynamic_pointer_cast<CpuOp>(pred);
+      auto pGpu = std::dynamic_pointer_cast<BoundGpuOp>(pred);
+      bool pS = bool(std::dynamic_pointer_cast<Start>(pred));
+
+      if (pS) {                  // pred is start node, no need to sync
+        ;                        // no need to sync with this pred
+      } else if (pCpu && bCpu) { // cpu -> cpu (nothing)
+        ;                        // no sync needed
+      } else if (pGpu && bCpu) { // gpu -> cpu (CER & CEW)
+        if (!is_synced_gpu_then_cpu(pGpu, bCpu, hb)) {
+          return false;
+        }
+      } else if (pCpu && bGpu) { // cpu -> gpu
+        ;                        // no sync needed
+      } else if (pGpu && bGpu) { // gpu -> gpu (maybe CER & CSW)
+        if (!is_synced_gpu_then_gpu(pGpu, bGpu, hb)) {
+          return false;
+        }
+      } else {
+        std::stringstream ss;
+        ss << "pc=" << bool(pCpu);
+        ss << " pg=" << bool(pGpu);
+        ss << " bc=" << bool(bCpu);
+        ss << " bg=" << bool(bGpu);
+        THROW_RUNTIME("unexpected op combination: " << pred->name() << " and " << bo->name() << ": "
+                                                    << ss.str());
+      }
+    }
+    return true;
+  }
+
+  static bool is_synced(const std::shared_ptr<BoundOp> &bo, const Graph<OpBase> &g,
+                        const Sequence<BoundOp> &path) {
+    return is_synced(bo, g, HappensBefore(path));
+  }
+
+  // return any operations to insert after the sequence that would help synchronize `bo` with its
+  // predecessors may return empty vector, in which case bo is synchronized with preds
+  static std::vector<std::shared_ptr<BoundOp>> make_syncs(const std::shared_ptr<BoundOp> &bo,
+                                                          const Graph<OpBase> &g,
+                                                          const HappensBefore &hb,
+                                                          bool quiet = true) {
+
+    // graph may contain bo or the unbound version of bo
+    Graph<OpBase>::vid_t v = g.find_or_find_unbound(bo);
+    if (Graph<OpBase>::npos == v) {
+      THROW_RUNTIME("couldn't find BoundOp " << bo->name() << " in graph");
+    }
+
+    STDERR("make syncs for " << bo->desc());
+    std::vector<std::shared_ptr<BoundOp>> syncs;
+
+    // find all ops on path that are predecessors of bo
+    for (const auto &gPred : g.preds(v)) {
+
+      if (!quiet)
+        STDERR("graph pred " << gPred->desc() << " of " << bo->desc() << "...");
+
+      // find the predecessor in the path
+      const std::shared_ptr<BoundOp> pred = hb.find_unbound(gPred);
+      if (!pred) {
+        THROW_RUNTIME("couldn't find " << gPred->desc() << " in path");
+      }
+      if (!quiet)
+        STDERR("pred " << pred->desc() << " of " << bo->desc() << "...");
+
+      // various CPU/GPU sync combinations
+      auto bCpu = std::dynamic_pointer_cast<CpuOp>(bo);
+      auto bGpu = std::dynamic_pointer_cast<BoundGpuOp>(bo);
+      auto pCpu = std::dynamic_pointer_cast<CpuOp>(pred);
+      auto pGpu = std::dynamic_pointer_cast<BoundGpuOp>(pred);
+      bool pS = bool(std::dynamic_pointer_cast<Start>(pred));
+
+      if (pS) {                  // pred is start node
+        ;                        // no sync
+      } else if (pCpu && bCpu) { // cpu -> cpu (nothing)
+        ;                        // no sync needed
+      } else if (pGpu && bCpu) { // gpu -> cpu (CER & CEW)
+        auto syncer = Policy::make_sync_gpu_then_cpu(pGpu, bCpu, hb);
+        if (syncer) {
+          STDERR("adding " << syncer->desc() << " to sync " << bCpu->desc() << " after "
+                           << pGpu->desc());
+          syncs.push_back(syncer);
+        }
+      } else if (pCpu && bGpu) { // cpu -> gpu
+        ;                        // no sync needed
+      } else if (pGpu && bGpu) { // gpu -> gpu (maybe CER & CSW)
+        auto syncer = Policy::make_sync_gpu_then_gpu(pGpu, bGpu, hb);
+        if (syncer) {
+          STDERR("adding " << syncer->desc() << " to sync " << bGpu->desc() << " after "
+                           << pGpu->desc());
+          syncs.push_back(syncer);
+        }
+      } else {
+        THROW_RUNTIME("unpected Op combination");
+      }
+    }
+
+    // FIXME: there may be duplicate syncs here, e.g. two preds in the same stream that are
+    // covered by the same event record produce the same wait
+
+    for (auto si = syncs.begin(); si < syncs.end(); ++si) {
+      for (auto sj = si + 1; sj < syncs.end(); ++sj) {
+        if ((*si)->eq(*sj)) {
+          // sj should be after si, but it is about to be incremented in the loop
+          si = sj = syncs.erase(si);
+          STDERR("erased a redundant generated sync");
+        }
+      }
+    }
+
+    return syncs;
+  }
+
+  static std::vector<std::shared_ptr<BoundOp>> make_syncs(const std::shared_ptr<BoundOp> &bo,
+                                                          const Graph<OpBase> &g,
+                                                          const Sequence<BoundOp> &path,
+                                                          bool quiet = true) {
+    return make_syncs(bo, g, HappensBefore(path), quiet);
+  }
+};
@@ -0,0 +1,56 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Operations shared by the unit tests
+*/
+
+#pragma once
+
+#include "tenzing/cuda/ops_cuda.hpp"
+#include "tenzing/operation.hpp"
+
+#include <string>
+#include <vector>
+
+namespace test_ops {
+
+/*! \brief a named GpuOp that does nothing when run
+
+    If `launches` is provided, each run records the stream it was launched in
+*/
+struct Kernel : public GpuOp {
+  std::string name_;
+  std::vector<cudaStream_t> *launches_;
+  Kernel(const std::string &name, std::vector<cudaStream_t> *launches = nullptr)
+      : name_(name), launches_(launches) {}
+  void run(cudaStream_t stream) override {
+    if (launches_) {
+      launches_->push_back(stream);
+    }
+  }
+  std::string name() const override { return name_; }
+  bool operator<(const Kernel &rhs) const { return name_ < rhs.name_; }
+  bool operator==(const Kernel &rhs) const { return name_ == rhs.name_; }
+  CLONE_DEF(Kernel);
+  LT_DEF(Kernel);
+  EQ_DEF(Kernel);
+};
+
+/*! \brief a CpuOp that counts how many times it was run
+ */
+struct Count : public CpuOp {
+  int *count_;
+  Count(int *count) : count_(count) {}
+  std::string name() const override { return "count"; }
+  bool operator<(const Count &) const { return false; }
+  bool operator==(const Count &) const { return true; }
+  void run(Platform &) override { ++*count_; }
+  CLONE_DEF(Count);
+  LT_DEF(Count);
+  EQ_DEF(Count);
+};
+
+} // namespace test_ops
@@ -0,0 +1,131 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Per-operation timings of replayed sequences, and fitting them into cost models
+*/
+
+#pragma once
+
+#include "tenzing/benchmarker.hpp"
+#include "tenzing/compiled_sequence.hpp"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/*! \brief start and end times of each operation run by CompiledSequence::run(plat, trace)
+
+    Records go into a ring buffer allocated up front, so tracing does not allocate during a replay.
+    When it is full, the oldest records are overwritten.
+
+    Host times are from a steady clock, in seconds since the trace was created.
+    With `gpuEvents`, each GPU operation is also bracketed by a pair of timing events recorded
+    in its stream, and its device time is their elapsed time.
+    Reading the events waits for them, which records() does, or recording over a slot whose
+    events have not been read yet.
+*/
+class Trace {
+public:
+  struct Record {
+    size_t seq;   // CompiledSequence::id() of the sequence it is from
+    size_t index; // of the instruction in that sequence
+    int rank;
+    double start; // when the host issued it
+    double stop;  // when the host returned from it
+    double gpu;   // seconds between the events around a GPU operation, -1 if not measured
+  };
+
+  Trace(size_t capacity, int rank = 0, bool gpuEvents = false);
+  ~Trace();
+  Trace(const Trace &other) = delete;
+  Trace &operator=(const Trace &rhs) = delete;
+
+  // the host is about to run instruction `index` of the compiled sequence `seq`
+  void begin(size_t seq, size_t index, const CompiledSequence::Instr &in) {
+    Slot &slot = slots_[next_];
+    if (slot.pending) {
+      resolve(slot);
+    }
+    slot.record.seq = seq;
+    slot.record.index = index;
+    slot.record.rank = rank_;
+    slot.record.gpu = -1;
+    if (gpuEvents_ && CompiledSequence::Instr::Kind::gpu == in.kind) {
+      CUDA_RUNTIME(cudaEventRecord(slot.start, in.stream));
+    }
+    slot.record.start = now();
+  }
+
+  // the host has finished running the instruction passed to begin()
+  void end(const CompiledSequence::Instr &in) {
+    Slot &slot = slots_[next_];
+    slot.record.stop = now();
+    if (gpuEvents_ && CompiledSequence::Instr::Kind::gpu == in.kind) {
+      CUDA_RUNTIME(cudaEventRecord(slot.stop, in.stream));
+      slot.pending = true;
+    }
+    next_ = (next_ + 1) % slots_.size();
+    ++count_;
+  }
+
+  /*! \brief the records still in the buffer, oldest first
+
+      waits for any GPU timing events that have not been read
+  */
+  std::vector<Record> records();
+
+  /// records overwritten because the buffer was full
+  size_t dropped() const { return count_ > slots_.size() ? count_ - slots_.size() : 0; }
+
+  void clear() {
+    for (Slot &slot : slots_) {
+      slot.pending = false;
+    }
+    next_ = 0;
+    count_ = 0;
+  }
+
+private:
+  struct Slot {
+    Record record;
+    cudaEvent_t start;
+    cudaEvent_t stop;
+    bool pending; // events recorded but not read
+  };
+
+  double now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_).count();
+  }
+
+  // read the elapsed time of the slot's events
+  void resolve(Slot &slot);
+
+  std::vector<Slot> slots_;
+  size_t next_;  // slot for the next record
+  size_t count_; // records ever made
+  int rank_;
+  bool gpuEvents_;
+  std::chrono::steady_clock::time_point epoch_;
+};
+
+/*! \brief the distribution of each operation's time in `records` from replays of `cs`, by name
+
+    Records from other sequences (see CompiledSequence::id()) are ignored.
+    Uses the GPU time of a record when it has one, otherwise the host time. The host time of a GPU
+    operation without a GPU time is only how long it took to launch, so it is left out, and goes
+    into the distribution at `launch` instead, if not null.
+*/
+std::map<std::string, Benchmark::Result> fit_op_times(const CompiledSequence &cs,
+                                                      const std::vector<Trace::Record> &records,
+                                                      Benchmark::Result *launch = nullptr);
+
+/*! \brief set `model.times` to the median of each fitted operation time, and `model.launch` to
+    the median of `launch` if it is not null and has any times
+ */
+void calibrate(SimulatedBenchmarker::Model &model,
+               const std::map<std::string, Benchmark::Result> &times,
+               const Benchmark::Result *launch = nullptr);
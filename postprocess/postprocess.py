@@ -22,6 +22,64 @@ from pathlib import Path
 # https://scikit-learn.org/stable/modules/tree.html#tree
 # https://scikit-learn.org/stable/modules/generated/sklearn.tree.DecisionTreeClassifier.html#sklearn.tree.DecisionTreeClassifier
 
+RESULT_FILE_MAGIC = b"TZRESULT"
+RESULT_FILE_VERSION = 1
+RESULT_FILE_COLUMNS = 6 # pct01, pct10, pct50, pct90, pct99, stddev
+
+def is_result_file(path):
+    """ whether `path` starts like a ResultFile (include/tenzing/result_file.hpp) """
+    with open(path, "rb") as f:
+        return f.read(len(RESULT_FILE_MAGIC)) == RESULT_FILE_MAGIC
+
+def read_result_file(path):
+    """
+    read a ResultFile (include/tenzing/result_file.hpp) into a dataframe with the same rows as the
+    CSV the searches write:
+    index|1st pct|10th|50th|90th|99th|stddev|sequence json
+    shorter sequences are padded with NaN, like the CSV
+
+    each section is used as an array in place, so nothing loops over the rows in python
+    numbers are in the byte order of the machine that wrote the file, assumed to be this one
+    """
+    buf = np.memmap(path, dtype=np.uint8, mode="r")
+    if buf[:len(RESULT_FILE_MAGIC)].tobytes() != RESULT_FILE_MAGIC:
+        raise ValueError(f"{path} is not a result file")
+
+    # the header after the magic
+    (version, nRows, nOps, nCells, textSize, dictSize,
+     columns, rowStart, cells, opStart, dictOff, text) = \
+        (int(x) for x in np.frombuffer(buf, dtype=np.uint64, count=12, offset=8))
+    if version != RESULT_FILE_VERSION:
+        raise ValueError(f"{path} is not a version {RESULT_FILE_VERSION} result file")
+
+    cols = np.frombuffer(buf, dtype=np.float64, count=RESULT_FILE_COLUMNS * nRows,
+                         offset=columns).reshape(RESULT_FILE_COLUMNS, nRows)
+    rowStarts = np.frombuffer(buf, dtype=np.uint64, count=nRows + 1, offset=rowStart)
+    rowStarts = rowStarts.astype(np.int64)
+    cellOps = np.frombuffer(buf, dtype=np.uint32, count=nCells, offset=cells)
+    opStarts = np.frombuffer(buf, dtype=np.uint64, count=nOps + 1, offset=opStart)
+    opStarts = opStarts.astype(np.int64) + dictOff
+
+    # each distinct operation, and NaN at index nOps for the padding
+    ops = np.empty(nOps + 1, dtype=object)
+    for k in range(nOps):
+        ops[k] = buf[opStarts[k]:opStarts[k + 1]].tobytes().decode()
+    ops[nOps] = np.nan
+
+    data = {0: np.arange(nRows)}
+    for c in range(RESULT_FILE_COLUMNS):
+        data[1 + c] = cols[c]
+
+    # the j-th operation of every row at once
+    lengths = np.diff(rowStarts)
+    width = int(lengths.max()) if nRows else 0
+    for j in range(width):
+        opIds = np.full(nRows, nOps, dtype=np.int64)
+        has = lengths > j
+        opIds[has] = cellOps[rowStarts[:-1][has] + j]
+        data[1 + RESULT_FILE_COLUMNS + j] = ops[opIds]
+    return pd.DataFrame(data)
+
 def df_peaks(df, pctl, fig_path=None):
     """
     take dataframe df assumed to be rows of index|1st pct|10th|50th|90th|99th|sequence
@@ -718,24 +776,26 @@ def evaluate_rules(df, n, peak_pctl):
 
 csvPath = sys.argv[1]
 
-# read csv in and ensure each line has the same number of delims
-# since the first line may not have the most
-with open(csvPath, "r") as f:
-    lines = f.readlines()
-
-    maxDelims = -1
-    for line in lines:
-        maxDelims = max(line.count('|'), maxDelims)
-
-    for i, _ in enumerate(lines):
-        delims = lines[i].count('|')
-        lines[i] = lines[i].strip() + '|' * (maxDelims - delims) + '\n'
-    csvStr = ''.join(lines)
-
-
-# no header row
-# index|1st pct|10th|50th|90th|99th|sequence json
-df = pd.read_csv(StringIO(csvStr), delimiter='|', header=None)
+if is_result_file(csvPath):
+    df = read_result_file(csvPath)
+else:
+    # read csv in and ensure each line has the same number of delims
+    # since the first line may not have the most
+    with open(csvPath, "r") as f:
+        lines = f.readlines()
+
+        maxDelims = -1
+        for line in lines:
+            maxDelims = max(line.count('|'), maxDelims)
+
+        for i, _ in enumerate(lines):
+            delims = lines[i].count('|')
+            lines[i] = lines[i].strip() + '|' * (maxDelims - delims) + '\n'
+        csvStr = ''.join(lines)
+
+    # no header row
+    # index|1st pct|10th|50th|90th|99th|sequence json
+    df = pd.read_csv(StringIO(csvStr), delimiter='|', header=None)
 print(df)
 
 
@@ -0,0 +1,430 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/benchmark_cache.hpp"
+
+#include "tenzing/cuda/ops_cuda.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+// FNV-1a, which unlike std::hash is the same in every build
+std::string stable_hash(const std::string &s) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+  return buf;
+}
+
+const char *to_string(Benchmark::Racing::Verdict v) {
+  switch (v) {
+  case Benchmark::Racing::Verdict::worse:
+    return "worse";
+  case Benchmark::Racing::Verdict::converged:
+    return "converged";
+  default:
+    return "more";
+  }
+}
+
+Benchmark::Racing::Verdict verdict_from_string(const std::string &s) {
+  if ("worse" == s) {
+    return Benchmark::Racing::Verdict::worse;
+  } else if ("converged" == s) {
+    return Benchmark::Racing::Verdict::converged;
+  }
+  return Benchmark::Racing::Verdict::more;
+}
+
+} // namespace
+
+std::string benchmark_signature(const Graph<OpBase> &g, const Platform &plat,
+                                const std::string &tag) {
+  // vertices and their successors by name, which do not depend on the order they were added
+  std::vector<std::string> vertices;
+  for (Graph<OpBase>::vid_t v : g.vertices()) {
+    std::vector<std::string> succs;
+    for (const auto &succ : g.succs(v)) {
+      succs.push_back(succ->name());
+    }
+    std::sort(succs.begin(), succs.end());
+    nlohmann::json jv = {g.op(v)->name(), succs};
+    vertices.push_back(jv.dump());
+  }
+  std::sort(vertices.begin(), vertices.end());
+
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  int size = 1;
+  if (initialized) {
+    MPI_Comm_size(plat.comm(), &size);
+  }
+
+  nlohmann::json j = {vertices, plat.streams_.size(), size, tag};
+  return stable_hash(j.dump());
+}
+
+BenchmarkCache::BenchmarkCache(const std::string &path, const std::string &signature)
+    : path_(path), signature_(signature) {
+  if (path_.empty()) {
+    return;
+  }
+  std::ifstream is(path_);
+  std::string line;
+  size_t skipped = 0;
+  while (std::getline(is, line)) {
+    nlohmann::json j = nlohmann::json::parse(line, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+      ++skipped; // e.g. a line cut short by an interrupted write
+      continue;
+    }
+    if (j.value("signature", "") != signature_) {
+      continue;
+    }
+    Benchmark::Result result;
+    result.pct01 = j.at("pct01");
+    result.pct10 = j.at("pct10");
+    result.pct50 = j.at("pct50");
+    result.pct90 = j.at("pct90");
+    result.pct99 = j.at("pct99");
+    result.stddev = j.at("stddev");
+    // lines from before racing was recorded have none of these
+    result.stopped = verdict_from_string(j.value("stopped", "more"));
+    result.estimate = j.value("estimate", 0.0);
+    result.best = j.value("best", 0.0);
+    const double racePct = j.value("racePct", 0.0);
+    std::map<std::string, Entry>::iterator it = entries_.find(j.at("sequence"));
+    if (entries_.end() == it) {
+      entries_[j.at("sequence")] = Entry{result, j.at("nIters"), racePct};
+    } else {
+      merge(it->second, result, j.at("nIters"), racePct);
+    }
+  }
+  if (skipped) {
+    STDERR("skipped " << skipped << " unreadable lines in " << path_);
+  }
+}
+
+const BenchmarkCache::Entry *BenchmarkCache::find(const std::string &key) const {
+  std::map<std::string, Entry>::const_iterator it = entries_.find(key);
+  return entries_.end() == it ? nullptr : &it->second;
+}
+
+const BenchmarkCache::Entry &BenchmarkCache::insert(const std::string &key,
+                                                    const Benchmark::Result &result,
+                                                    size_t nIters, double racePct) {
+  if (!path_.empty()) {
+    nlohmann::json j;
+    j["signature"] = signature_;
+    j["sequence"] = key;
+    j["nIters"] = nIters;
+    j["pct01"] = result.pct01;
+    j["pct10"] = result.pct10;
+    j["pct50"] = result.pct50;
+    j["pct90"] = result.pct90;
+    j["pct99"] = result.pct99;
+    j["stddev"] = result.stddev;
+    if (racePct > 0) {
+      j["racePct"] = racePct;
+      j["stopped"] = to_string(result.stopped);
+      j["estimate"] = result.estimate;
+      if (Benchmark::Racing::Verdict::worse == result.stopped) {
+        j["best"] = result.best; // otherwise it may be infinite, which JSON can't hold
+      }
+    }
+    // a torn last line from an interrupted write would swallow this one, so end it first
+    bool torn = false;
+    {
+      std::ifstream is(path_, std::ios::binary | std::ios::ate);
+      if (is && is.tellg() > 0) {
+        is.seekg(-1, std::ios::end);
+        torn = '\n' != is.get();
+      }
+    }
+    std::ofstream os(path_, std::ios::app);
+    if (torn) {
+      os << '\n';
+    }
+    os << j.dump() << std::endl;
+    if (!os) {
+      THROW_RUNTIME("couldn't append to " << path_);
+    }
+  }
+
+  std::map<std::string, Entry>::iterator it = entries_.find(key);
+  if (entries_.end() == it) {
+    return entries_[key] = Entry{result, nIters, racePct};
+  }
+  merge(it->second, result, nIters, racePct);
+  return it->second;
+}
+
+void BenchmarkCache::merge(Entry &dst, const Benchmark::Result &result, size_t nIters,
+                           double racePct) {
+  dst.result.stopped = result.stopped;
+  dst.result.estimate = result.estimate;
+  dst.result.best = result.best;
+  dst.racePct = racePct;
+
+  const double a = double(dst.nIters), b = double(nIters);
+  if (0 == a + b) {
+    return;
+  }
+  auto avg = [&](double x, double y) { return (a * x + b * y) / (a + b); };
+
+  // pool the variances around the merged median, which stands in for the mean
+  const double m = avg(dst.result.pct50, result.pct50);
+  const double da = dst.result.pct50 - m, db = result.pct50 - m;
+  const double var = avg(dst.result.stddev * dst.result.stddev + da * da,
+                         result.stddev * result.stddev + db * db);
+
+  dst.result.pct01 = avg(dst.result.pct01, result.pct01);
+  dst.result.pct10 = avg(dst.result.pct10, result.pct10);
+  dst.result.pct50 = m;
+  dst.result.pct90 = avg(dst.result.pct90, result.pct90);
+  dst.result.pct99 = avg(dst.result.pct99, result.pct99);
+  dst.result.stddev = std::sqrt(var);
+  dst.nIters += nIters;
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/test_ops.hpp"
+
+#include <unistd.h>
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "benchmark cache") {
+  // counts how many times it was asked
+  struct Counting {
+    size_t calls = 0;
+    size_t nIters = 0; // measurements each result reports
+    Benchmark::Result benchmark(Sequence<BoundOp> &order, Platform &, const Benchmark::Opts &) {
+      ++calls;
+      Benchmark::Result r;
+      r.pct01 = r.pct10 = r.pct50 = r.pct90 = r.pct99 = double(order.size() * calls);
+      r.stddev = 0;
+      r.nIters = nIters;
+      return r;
+    }
+  };
+
+  auto a = std::make_shared<Kernel>("a");
+  auto b = std::make_shared<Kernel>("b");
+  Graph<OpBase> graph;
+  graph.start_then(a);
+  graph.then(a, b);
+  graph.then_finish(b);
+
+  Platform plat(MPI_COMM_WORLD);
+  plat.streams_.push_back(Stream(0));
+  plat.streams_.push_back(Stream(1));
+
+  auto sync = [&](Stream sa, Stream sb, Event e) {
+    return Sequence<BoundOp>({std::make_shared<BoundGpuOp>(a, sa),
+                              std::make_shared<CudaEventRecord>(e, sa),
+                              std::make_shared<CudaStreamWaitEvent>(sb, e),
+                              std::make_shared<BoundGpuOp>(b, sb)});
+  };
+
+  SUBCASE("canonical sequence") {
+    const std::string s = canonical_sequence(sync(Stream(0), Stream(1), Event(0)));
+    CHECK(s == canonical_sequence(sync(Stream(1), Stream(0), Event(5))));
+    CHECK(s != canonical_sequence(sync(Stream(0), Stream(0), Event(0))));
+  }
+
+  SUBCASE("signature") {
+    const std::string sig = benchmark_signature(graph, plat);
+    CHECK(sig == benchmark_signature(graph, plat));
+    CHECK(sig != benchmark_signature(graph, plat, "other machine"));
+    plat.streams_.push_back(Stream(2));
+    CHECK(sig != benchmark_signature(graph, plat));
+  }
+
+  SUBCASE("persist and merge") {
+    char path[] = "/tmp/tenzing-cache-XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    Counting inner;
+    Benchmark::Opts opts;
+    opts.nIters = 10;
+    Sequence<BoundOp> s1 = sync(Stream(0), Stream(1), Event(0));
+    Sequence<BoundOp> s2 = sync(Stream(1), Stream(0), Event(3)); // the same as s1
+    {
+      CachingBenchmarker<Counting> cb(inner, path, "sig");
+      CHECK(cb.benchmark(s1, plat, opts).pct50 == 4);
+      CHECK(cb.benchmark(s2, plat, opts).pct50 == 4);
+      CHECK(inner.calls == 1);
+      CHECK(cb.hits() == 1);
+    }
+
+    // a later run loads the file
+    {
+      CachingBenchmarker<Counting> cb(inner, path, "sig");
+      CHECK(cb.cache().size() == 1);
+      CHECK(cb.benchmark(s2, plat, opts).pct50 == 4);
+      CHECK(inner.calls == 1);
+
+      // more iterations than cached: measure again and merge
+      opts.nIters = 20;
+      const Benchmark::Result r = cb.benchmark(s1, plat, opts);
+      CHECK(inner.calls == 2);
+      const double m = (10 * 4 + 20 * 8) / 30.0;
+      CHECK(r.pct50 == doctest::Approx(m));
+      CHECK(r.stddev ==
+            doctest::Approx(std::sqrt((10 * (4 - m) * (4 - m) + 20 * (8 - m) * (8 - m)) / 30)));
+      CHECK(cb.cache().find(canonical_sequence(s1))->nIters == 30);
+    }
+
+    // other signatures don't see these results, and a torn line is skipped
+    {
+      std::ofstream os(path, std::ios::app);
+      os << "{\"signature\": \"si";
+    }
+    CHECK(BenchmarkCache(path, "other").size() == 0);
+    BenchmarkCache reloaded(path, "sig");
+    REQUIRE(reloaded.size() == 1);
+    CHECK(reloaded.find(canonical_sequence(s1))->nIters == 30);
+
+    // appending after the torn line still makes a readable line
+    Benchmark::Result r;
+    r.pct50 = 5;
+    reloaded.insert("appended", r, 7);
+    BenchmarkCache appended(path, "sig");
+    REQUIRE(appended.size() == 2);
+    REQUIRE(appended.find("appended"));
+    CHECK(appended.find("appended")->nIters == 7);
+    CHECK(appended.find("appended")->result.pct50 == 5);
+    CHECK(appended.find(canonical_sequence(s1))->nIters == 30);
+
+    std::remove(path);
+  }
+
+  SUBCASE("stopped early") {
+    Counting inner;
+    inner.nIters = 3; // e.g. racing stopped it
+    Benchmark::Opts opts;
+    opts.nIters = 10;
+    Sequence<BoundOp> s1 = sync(Stream(0), Stream(1), Event(0));
+    CachingBenchmarker<Counting> cb(inner, "", "sig");
+    CHECK(cb.benchmark(s1, plat, opts).nIters == 3);
+    CHECK(cb.cache().find(canonical_sequence(s1))->nIters == 3);
+
+    // too few measurements to reuse
+    CHECK(cb.benchmark(s1, plat, opts).nIters == 6);
+    CHECK(inner.calls == 2);
+
+    inner.nIters = 10;
+    CHECK(cb.benchmark(s1, plat, opts).nIters == 16);
+    CHECK(cb.benchmark(s1, plat, opts).nIters == 16);
+    CHECK(inner.calls == 3);
+  }
+
+  SUBCASE("stopped by racing") {
+    // reports racing verdicts, and keeps a best like EmpiricalBenchmarker
+    struct Racer {
+      size_t calls = 0;
+      double best_ = std::numeric_limits<double>::infinity();
+      Benchmark::Racing::Verdict stopped = Benchmark::Racing::Verdict::converged;
+      double estimate = 2;
+      Benchmark::Result benchmark(Sequence<BoundOp> &, Platform &, const Benchmark::Opts &) {
+        ++calls;
+        Benchmark::Result r;
+        r.nIters = 3;
+        r.stopped = stopped;
+        r.estimate = estimate;
+        r.best = best_;
+        if (Benchmark::Racing::Verdict::worse != stopped) {
+          best_ = std::min(best_, estimate);
+        }
+        return r;
+      }
+      double best() const { return best_; }
+      void observe(double t) { best_ = std::min(best_, t); }
+    };
+
+    char path[] = "/tmp/tenzing-cache-XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    Benchmark::Opts opts;
+    opts.nIters = 10;
+    opts.racing.pct = 10;
+    Sequence<BoundOp> s1 = sync(Stream(0), Stream(1), Event(0));
+    Sequence<BoundOp> s2 = sync(Stream(0), Stream(0), Event(0));
+    {
+      Racer inner;
+      CachingBenchmarker<Racer> cb(inner, path, "sig");
+      CHECK(cb.benchmark(s1, plat, opts).stopped == Benchmark::Racing::Verdict::converged);
+      inner.stopped = Benchmark::Racing::Verdict::worse;
+      inner.estimate = 5;
+      CHECK(cb.benchmark(s2, plat, opts).best == 2);
+
+      // both are final, though they have fewer than nIters measurements
+      CHECK(cb.benchmark(s1, plat, opts).nIters == 3);
+      CHECK(cb.benchmark(s2, plat, opts).nIters == 3);
+      CHECK(inner.calls == 2);
+
+      // racing another percentile is not the same race
+      opts.racing.pct = 50;
+      CHECK(cb.benchmark(s1, plat, opts).nIters == 6);
+      CHECK(inner.calls == 3);
+      opts.racing.pct = 10;
+    }
+
+    // a later run
+    {
+      Racer inner;
+      CachingBenchmarker<Racer> cb(inner, path, "sig");
+
+      // s1 was last raced on 50, so it runs again
+      CHECK(cb.benchmark(s1, plat, opts).nIters == 9);
+      CHECK(inner.calls == 1);
+      CHECK(inner.best() == 2);
+
+      // s2 lost to a best of 2, which this run has matched
+      CHECK(cb.benchmark(s2, plat, opts).nIters == 3);
+      CHECK(inner.calls == 1);
+    }
+
+    // a cache hit sets the best, so s2 is final
+    {
+      Racer inner;
+      CachingBenchmarker<Racer> cb(inner, path, "sig");
+      CHECK(cb.benchmark(s1, plat, opts).nIters == 9);
+      CHECK(inner.best() == 2);
+      CHECK(cb.benchmark(s2, plat, opts).nIters == 3);
+      CHECK(inner.calls == 0);
+    }
+
+    // without it, s2 could still win
+    {
+      Racer inner;
+      CachingBenchmarker<Racer> cb(inner, path, "sig");
+      CHECK(cb.benchmark(s2, plat, opts).nIters == 6);
+      CHECK(inner.calls == 1);
+    }
+
+    std::remove(path);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
@@ -5,19 +5,74 @@
 
 #include "tenzing/benchmarker.hpp"
 
+#include "tenzing/compiled_sequence.hpp"
+#include "tenzing/mpi/ops_mpi.hpp"
 #include "tenzing/numeric.hpp"
 #include "tenzing/operation_serdes.hpp"
 #include "tenzing/randomness.hpp"
+#include "tenzing/result_file.hpp"
+#include "tenzing/trace.hpp"
 
 #include <vincentlaucsb/csv-parser/csv.hpp>
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
 #include <numeric>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
 
 using Result = Benchmark::Result;
 using Opts = Benchmark::Opts;
 
+Result Benchmark::summarize(std::vector<double> &times) {
+  std::sort(times.begin(), times.end());
+  Result result;
+  result.pct01 = times[times.size() * 01 / 100];
+  result.pct10 = times[times.size() * 10 / 100];
+  result.pct50 = times[times.size() * 50 / 100];
+  result.pct90 = times[times.size() * 90 / 100];
+  result.pct99 = times[times.size() * 99 / 100];
+  result.stddev = stddev(times);
+  result.nIters = times.size();
+  return result;
+}
+
+double Benchmark::Racing::interval(const std::vector<double> &sorted, double pct, double z,
+                                  double *lo, double *hi) {
+  // the number of samples below the percentile is binomial, approximate it as normal
+  const double n = sorted.size(), k = n * pct / 100;
+  const double half = z * std::sqrt(k * (1 - pct / 100));
+  auto at = [&](double i) { return sorted[size_t(std::min(std::max(i, 0.0), n - 1))]; };
+  *lo = at(std::floor(k - half));
+  *hi = at(std::ceil(k + half));
+  return at(k); // the same sample as summarize()
+}
+
+Benchmark::Racing::Verdict Benchmark::Racing::verdict(const std::vector<double> &sorted,
+                                                      double best) const {
+  if (0 == pct || sorted.size() < std::max(minIters, size_t(1))) {
+    return Verdict::more;
+  }
+  double lo, hi;
+  const double est = interval(sorted, pct, z, &lo, &hi);
+  if (lo > best) {
+    return Verdict::worse;
+  } else if (hi - lo <= relWidth * est) {
+    return Verdict::converged;
+  }
+  return Verdict::more;
+}
+
+void Benchmark::Racing::insert(std::vector<double> &sorted, double t) {
+  sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), t), t);
+}
+
+EmpiricalBenchmarker::EmpiricalBenchmarker()
+    : best_(std::numeric_limits<double>::infinity()), measurements_(0), stopped_(0) {}
+
 std::vector<Result> EmpiricalBenchmarker::benchmark(std::vector<Schedule> &schedules,
                                                     Platform &plat, const Opts &opts) {
 
@@ -32,6 +87,12 @@ std::vector<Result> EmpiricalBenchmarker::benchmark(std::vector<Schedule> &sched
   // each iteration's time for each schedule
   std::vector<std::vector<double>> times(schedules.size());
 
+  // resolve streams and events once instead of on every run
+  std::vector<CompiledSequence> compiled;
+  for (const Schedule &schedule : schedules) {
+    compiled.push_back(CompiledSequence::compile(schedule.order, plat));
+  }
+
   // each iteration, do schedules in a random order
   for (size_t i = 0; i < opts.nIters; ++i) {
     if (0 == rank) {
@@ -44,7 +105,7 @@ std::vector<Result> EmpiricalBenchmarker::benchmark(std::vector<Schedule> &sched
     for (int si : perm) {
       MPI_Barrier(MPI_COMM_WORLD);
       double rstart = MPI_Wtime();
-      schedules[si].run(plat);
+      compiled[si].run(plat);
       double elapsed = MPI_Wtime() - rstart;
       times[si].push_back(elapsed);
     }
@@ -62,26 +123,18 @@ std::vector<Result> EmpiricalBenchmarker::benchmark(std::vector<Schedule> &sched
 
   std::vector<Result> ret;
   for (auto &st : times) {
-    std::sort(st.begin(), st.end());
-    Result result;
-    result.pct01 = st[st.size() * 01 / 100];
-    result.pct10 = st[st.size() * 10 / 100];
-    result.pct50 = st[st.size() * 50 / 100];
-    result.pct90 = st[st.size() * 90 / 100];
-    result.pct99 = st[st.size() * 99 / 100];
-    result.stddev = stddev(st);
-    ret.push_back(result);
+    ret.push_back(summarize(st));
   }
   return ret;
 }
 
 struct Measurement {
   size_t nSamples; // how many samples make up the measurement
-  double time;     // estimated operation time
+  double time;     // estimated operation time, the max over all ranks
 };
 
-Measurement measure(Sequence<BoundOp> &order, Platform &plat, double nSamplesHint,
-                    double targetSecs = 0.01 // target measurement time in seconds
+Measurement measure(const CompiledSequence &order, Platform &plat, double nSamplesHint,
+                    Trace *trace, double targetSecs = 0.01 // target measurement time in seconds
 ) {
   Measurement result;
   result.nSamples = nSamplesHint;
@@ -90,9 +143,13 @@ Measurement measure(Sequence<BoundOp> &order, Platform &plat, double nSamplesHin
     MPI_Barrier(plat.comm());
     
     double start = MPI_Wtime();
-    for (size_t i = 0; i < result.nSamples; ++i) {
-      for (auto &op : order) {
-        op->run(plat);
+    if (trace) {
+      for (size_t i = 0; i < result.nSamples; ++i) {
+        order.run(plat, *trace);
+      }
+    } else {
+      for (size_t i = 0; i < result.nSamples; ++i) {
+        order.run(plat);
       }
     }
     double elapsed = MPI_Wtime() - start;
@@ -124,25 +181,42 @@ Result EmpiricalBenchmarker::benchmark(Sequence<BoundOp> &order, Platform &plat,
   MPI_Comm_rank(plat.comm(), &rank);
   MPI_Comm_size(plat.comm(), &size);
 
-  std::vector<double> times;
+  std::vector<double> times;  // in the order they were measured
+  std::vector<double> sorted; // the same times in order, for racing
+  const CompiledSequence compiled = CompiledSequence::compile(order, plat);
+  Racing::Verdict verdict = Racing::Verdict::more;
 
   for (size_t retries = opts.maxRetries; opts.maxRetries == 0 || retries > 0; --retries) {
 
     // determine the number of samples needed for a measurement
-    Measurement mmt = measure(order, plat, 1);
+    Measurement mmt = measure(compiled, plat, 1, opts.trace);
     size_t nSamplesHint = mmt.nSamples;
 
-    // get the requested number of measurements
+    // get the requested number of measurements, or fewer if racing decides
     times.clear();
-    for (size_t i = 0; i < opts.nIters; ++i) {
-      mmt = measure(order, plat, nSamplesHint);
+    sorted.clear();
+    verdict = Racing::Verdict::more;
+    for (size_t i = 0; i < opts.nIters && Racing::Verdict::more == verdict; ++i) {
+      mmt = measure(compiled, plat, nSamplesHint, opts.trace);
       nSamplesHint = std::max(
           mmt.nSamples, nSamplesHint); // update the hint with the max number of samples ever needed
+
+      // measure() already reduced the time to the max over ranks, so it is the same on all
       times.push_back(mmt.time);
+      ++measurements_;
+
+      if (opts.racing.pct > 0) {
+        // every rank decides from the same reduced times (and best_), so all stop together
+        Racing::insert(sorted, mmt.time);
+        verdict = opts.racing.verdict(sorted, best_);
+      }
     }
 
-    // each iteration's time is the maximum observed across all ranks
-    MPI_Allreduce(MPI_IN_PLACE, times.data(), times.size(), MPI_DOUBLE, MPI_MAX, plat.comm());
+    // a sequence that lost the race is not worth measuring again
+    if (Racing::Verdict::worse == verdict) {
+      ++stopped_;
+      break;
+    }
 
     if (randomness::compound_test(times)) {
       if (0 == rank) {
@@ -154,28 +228,308 @@ Result EmpiricalBenchmarker::benchmark(Sequence<BoundOp> &order, Platform &plat,
     }
   }
 
-  std::sort(times.begin(), times.end());
-  Result ret;
-  ret.pct01 = times[times.size() * 01 / 100];
-  ret.pct10 = times[times.size() * 10 / 100];
-  ret.pct50 = times[times.size() * 50 / 100];
-  ret.pct90 = times[times.size() * 90 / 100];
-  ret.pct99 = times[times.size() * 99 / 100];
-  ret.stddev = stddev(times);
+  Result result = summarize(times);
+  if (opts.racing.pct > 0 && !sorted.empty()) {
+    double lo, hi;
+    result.stopped = verdict;
+    result.estimate = Racing::interval(sorted, opts.racing.pct, 0, &lo, &hi);
+    result.best = best_;
+    if (Racing::Verdict::worse != verdict) {
+      best_ = std::min(best_, result.estimate);
+    }
+  }
+  return result;
+}
 
-  return ret;
+// bytes in `count` elements of `datatype`, or `count` if MPI is not initialized to ask
+static size_t message_bytes(int count, MPI_Datatype datatype) {
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  int size = 1;
+  if (initialized) {
+    MPI_Type_size(datatype, &size);
+  }
+  return size_t(count) * size_t(size);
+}
+
+double SimulatedBenchmarker::simulate(const Sequence<BoundOp> &order) {
+  std::normal_distribution<double> factor(1, model_.noise);
+  auto scaled = [&](double t) -> double {
+    return model_.noise > 0 ? std::max(0.0, t * factor(rng_)) : t;
+  };
+  auto duration = [&](const std::shared_ptr<BoundOp> &op, double otherwise) -> double {
+    std::map<std::string, double>::const_iterator it = model_.times.find(op->name());
+    return scaled(model_.times.end() == it ? otherwise : it->second);
+  };
+
+  /* MPI messages between this rank and each peer, posted by this rank and symmetrically by the
+     peer. The n-th Isend to a peer with a tag and communicator is received by the peer's n-th
+     Irecv from this rank with the same tag and communicator, which the peer posts when this rank
+     posts its own n-th Irecv from the peer
+  */
+  struct Message {
+    bool hasSend = false, hasRecv = false; // whether the sequence has them at all
+    double send = -1, recv = -1;           // when they were posted, -1 if not yet
+    size_t bytes = 0;
+  };
+  typedef std::tuple<int, int, MPI_Comm> Channel; // peer, tag, communicator
+  struct Messages {
+    std::vector<Message> fifo; // in the order they are matched
+    size_t sends = 0, recvs = 0; // how many of each have been seen
+  };
+  std::map<Channel, Messages> channels;
+  for (const std::shared_ptr<BoundOp> &op : order) {
+    if (auto isend = std::dynamic_pointer_cast<Isend>(op)) {
+      const Isend::Args &args = isend->args();
+      Messages &ms = channels[Channel(args.dest, args.tag, args.comm)];
+      if (ms.fifo.size() == ms.sends) {
+        ms.fifo.push_back(Message());
+      }
+      Message &m = ms.fifo[ms.sends++];
+      m.hasSend = true;
+      m.bytes = message_bytes(args.count, args.datatype);
+    } else if (auto irecv = std::dynamic_pointer_cast<Irecv>(op)) {
+      const Irecv::Args &args = irecv->args();
+      Messages &ms = channels[Channel(args.source, args.tag, args.comm)];
+      if (ms.fifo.size() == ms.recvs) {
+        ms.fifo.push_back(Message());
+      }
+      Message &m = ms.fifo[ms.recvs++];
+      if (!m.hasSend) {
+        m.bytes = message_bytes(args.count, args.datatype);
+      }
+      m.hasRecv = true;
+    }
+  }
+  for (auto &kv : channels) {
+    kv.second.sends = 0;
+    kv.second.recvs = 0;
+  }
+
+  // an outstanding MPI request: a message, or something that is done at a fixed time
+  struct Request {
+    Message *message; // null if done at a fixed time
+    int tag;
+    double done;
+  };
+  std::map<const MPI_Request *, Request> requests;
+
+  double host = 0;
+  std::map<Stream, double> streams; // when each stream finishes the work issued to it so far
+  std::map<Event, double> events;   // when the most recent record of each event completes
+  std::priority_queue<double, std::vector<double>, std::greater<double>> slots; // busy until
+
+  // block the host until `req` is complete
+  auto wait = [&](const MPI_Request *req) {
+    std::map<const MPI_Request *, Request>::iterator it = requests.find(req);
+    if (requests.end() == it) {
+      return; // never started, like MPI_REQUEST_NULL
+    }
+    double done = it->second.done;
+    if (it->second.message) {
+      const Message &m = *it->second.message;
+      if ((m.hasSend && m.send < 0) || (m.hasRecv && m.recv < 0)) {
+        THROW_RUNTIME("simulated deadlock: wait for tag " << it->second.tag
+                                                          << " before it is posted");
+      }
+      done = std::max(m.send, m.recv) + scaled(model_.mpiLatency) +
+             double(m.bytes) / model_.mpiBandwidth;
+    }
+    host = std::max(host, done);
+    requests.erase(it);
+  };
+
+  for (const std::shared_ptr<BoundOp> &op : order) {
+    if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(op)) {
+      host += scaled(model_.launch);
+      double start = std::max(host, streams[gpu->stream()]);
+      if (model_.slots > 0 && slots.size() == model_.slots) {
+        start = std::max(start, slots.top());
+        slots.pop();
+      }
+      streams[gpu->stream()] = start + duration(op, model_.gpu);
+      if (model_.slots > 0) {
+        slots.push(streams[gpu->stream()]);
+      }
+    } else if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+      host += scaled(model_.launch);
+      events[cer->event()] = std::max(host, streams[cer->stream()]);
+    } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+      host += scaled(model_.launch);
+      streams[cswe->stream()] = std::max(streams[cswe->stream()], events[cswe->event()]);
+    } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(op)) {
+      host += scaled(model_.launch) + scaled(model_.launch); // a record and a wait
+      events[sw->event()] = std::max(host, streams[sw->waitee()]);
+      streams[sw->waiter()] = std::max(streams[sw->waiter()], events[sw->event()]);
+    } else if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(op)) {
+      host = std::max(host, events[ces->event()]) + scaled(model_.sync);
+    } else if (auto ss = std::dynamic_pointer_cast<StreamSync>(op)) {
+      host = std::max(host, streams[ss->stream()]) + scaled(model_.sync);
+    } else if (auto isend = std::dynamic_pointer_cast<Isend>(op)) {
+      const Isend::Args &args = isend->args();
+      Messages &ms = channels[Channel(args.dest, args.tag, args.comm)];
+      Message &m = ms.fifo[ms.sends++];
+      host += duration(op, model_.cpu);
+      m.send = host;
+      requests[args.request] = Request{&m, args.tag, 0};
+    } else if (auto irecv = std::dynamic_pointer_cast<Irecv>(op)) {
+      const Irecv::Args &args = irecv->args();
+      Messages &ms = channels[Channel(args.source, args.tag, args.comm)];
+      Message &m = ms.fifo[ms.recvs++];
+      host += duration(op, model_.cpu);
+      m.recv = host;
+      requests[args.request] = Request{&m, args.tag, 0};
+    } else if (auto alltoallv = std::dynamic_pointer_cast<Ialltoallv>(op)) {
+      host += duration(op, model_.cpu);
+      requests[alltoallv->args().request] =
+          Request{nullptr, 0, host + scaled(model_.mpiLatency)};
+    } else if (auto w = std::dynamic_pointer_cast<Wait>(op)) {
+      wait(w->args().request);
+      host += scaled(model_.sync);
+    } else if (auto mw = std::dynamic_pointer_cast<MultiWait>(op)) {
+      for (const MPI_Request *req : mw->requests()) {
+        wait(req);
+      }
+      host += scaled(model_.sync);
+    } else if (auto wa = std::dynamic_pointer_cast<OwningWaitall>(op)) {
+      for (const MPI_Request &req : wa->requests()) {
+        wait(&req);
+      }
+      host += scaled(model_.sync);
+    } else if (std::dynamic_pointer_cast<Start>(op) || std::dynamic_pointer_cast<Finish>(op) ||
+               std::dynamic_pointer_cast<NoOp>(op)) {
+      // takes no time
+    } else {
+      host += duration(op, model_.cpu);
+    }
+  }
+
+  double end = host;
+  for (const auto &kv : streams) {
+    end = std::max(end, kv.second);
+  }
+  return end;
+}
+
+Result SimulatedBenchmarker::benchmark(Sequence<BoundOp> &order, Platform & /*plat*/,
+                                       const Opts &opts) {
+  // without noise, every run takes the same time
+  const size_t nIters = model_.noise > 0 ? std::max(opts.nIters, size_t(1)) : 1;
+  std::vector<double> times;
+  for (size_t i = 0; i < nIters; ++i) {
+    times.push_back(simulate(order));
+  }
+  Result result = summarize(times);
+  result.nIters = std::max(opts.nIters, size_t(1)); // one noiseless run stands for all of them
+  return result;
+}
+
+namespace {
+
+// what canonical_sequence() looks at in an operation
+struct OpShape {
+  size_t name; // hashed
+  std::vector<Stream> streams;
+  std::vector<Event> events;
+};
+
+OpShape shape_of(const std::shared_ptr<BoundOp> &op) {
+  OpShape shape;
+  shape.name = std::hash<std::string>()(op->name());
+  if (auto hs = std::dynamic_pointer_cast<HasStream>(op)) {
+    shape.streams = hs->get_streams();
+  }
+  if (auto he = std::dynamic_pointer_cast<HasEvent>(op)) {
+    shape.events = he->get_events();
+  }
+  return shape;
+}
+
+/* a hash of canonical_sequence(), built up one operation at a time without any JSON
+
+   Like canonical_sequence(), streams and events are relabeled in order of first use, so the key
+   is the same for any relabeling of them.
+*/
+class SequenceKey {
+public:
+  SequenceKey() : key_(0) {}
+
+  void add(const OpShape &op) {
+    key_ = hash_combine(key_, op.name);
+    key_ = hash_combine(key_, op.streams.size());
+    for (const Stream &stream : op.streams) {
+      key_ = hash_combine(key_, label(streams_, stream));
+    }
+    key_ = hash_combine(key_, op.events.size());
+    for (const Event &event : op.events) {
+      key_ = hash_combine(key_, label(events_, event));
+    }
+  }
+
+  size_t value() const { return key_; }
+
+private:
+  // a sequence only uses a few streams and events, so a search is cheaper than a map
+  template <typename T> static size_t label(std::vector<T> &seen, const T &t) {
+    auto it = std::find(seen.begin(), seen.end(), t);
+    if (seen.end() != it) {
+      return it - seen.begin();
+    }
+    seen.push_back(t);
+    return seen.size() - 1;
+  }
+
+  size_t key_;
+  std::vector<Stream> streams_;
+  std::vector<Event> events_;
+};
+
+size_t sequence_key(const Sequence<BoundOp> &seq) {
+  SequenceKey key;
+  for (const std::shared_ptr<BoundOp> &op : seq) {
+    key.add(shape_of(op));
+  }
+  return key.value();
 }
 
+} // namespace
+
 CsvBenchmarker::CsvBenchmarker(const std::string &path, const Graph<OpBase> &g) {
 
   STDERR("open " << path);
 
+  if (ResultFile::is_result_file(path)) {
+    // the rows stay in the mapped file, and are indexed from their cells
+    file_ = std::make_shared<ResultFile>(path);
+
+    fileOps_.resize(file_->num_ops());
+    std::vector<OpShape> shapes;
+    for (size_t k = 0; k < fileOps_.size(); ++k) {
+      from_json(nlohmann::json::parse(file_->op(k)), g, fileOps_[k]);
+      shapes.push_back(shape_of(fileOps_[k]));
+    }
+
+    for (size_t i = 0; i < file_->size(); ++i) {
+      SequenceKey key;
+      for (const uint32_t *k = file_->row_begin(i); k < file_->row_end(i); ++k) {
+        key.add(shapes[*k]);
+      }
+      index_[key.value()].push_back(i);
+    }
+    STDERR("got " << file_->size() << " records");
+    return;
+  }
+
   using namespace csv;
 
   CSVFormat format;
-  format.delimiter('|').header_row(0);
+  // rows are as long as their sequences
+  format.delimiter('|').header_row(0).variable_columns(VariableColumnPolicy::KEEP);
   CSVReader reader(path, format);
 
+  // most cells are the same few operations, so only deserialize each distinct one once
+  std::unordered_map<std::string, std::shared_ptr<BoundOp>> ops;
+
   for (CSVRow &row : reader) {
     Benchmark::Result result;
     Sequence<BoundOp> seq;
@@ -197,12 +551,15 @@ CsvBenchmarker::CsvBenchmarker(const std::string &path, const Graph<OpBase> &g)
         result.stddev = row[i].get<double>();
       else {
         auto s = row[i].get<std::string>();
-        std::shared_ptr<BoundOp> bo;
-        from_json(nlohmann::json::parse(s), g, bo);
+        std::shared_ptr<BoundOp> &bo = ops[s];
+        if (!bo) {
+          from_json(nlohmann::json::parse(s), g, bo);
+        }
         seq.push_back(bo);
       }
     }
 
+    index_[sequence_key(seq)].push_back(data_.size());
     data_.push_back(DataRow(result, seq));
   }
 
@@ -211,13 +568,389 @@ CsvBenchmarker::CsvBenchmarker(const std::string &path, const Graph<OpBase> &g)
 
 Result CsvBenchmarker::benchmark(Sequence<BoundOp> &sequence, Platform & /*plat*/, const Opts &) {
 
-  // convert the csv sequence into a sequence of BoundOp
-  for (const DataRow &dr : data_) {
-    Equivalence eqv = get_equivalence(sequence, dr.seq);
-    if (eqv) {
-      return dr.res;
+  // only rows with the same key can be equivalent, but the key is a hash, so confirm
+  auto it = index_.find(sequence_key(sequence));
+  if (index_.end() != it) {
+    for (size_t i : it->second) {
+      if (file_) {
+        Sequence<BoundOp> row;
+        for (const uint32_t *k = file_->row_begin(i); k < file_->row_end(i); ++k) {
+          row.push_back(fileOps_[*k]);
+        }
+        if (get_equivalence(sequence, row)) {
+          return file_->result(i);
+        }
+      } else if (get_equivalence(sequence, data_[i].seq)) {
+        return data_[i].res;
+      }
     }
   }
 
   THROW_RUNTIME("no equivalent CSV data for sequence");
-}
\ No newline at end of file
+}
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/state.hpp"
+#include "tenzing/test_ops.hpp"
+
+#include <fstream>
+
+#include <unistd.h>
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "simulated benchmarker") {
+
+  Platform plat(MPI_COMM_WORLD);
+  SimulatedBenchmarker::Model model;
+  model.launch = 1;
+  model.gpu = 10;
+  model.cpu = 1;
+  model.sync = 0;
+
+  auto a0 = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("a"), Stream(0));
+  auto b0 = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("b"), Stream(0));
+  auto b1 = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("b"), Stream(1));
+  auto ss0 = std::make_shared<StreamSync>(Stream(0));
+  auto ss1 = std::make_shared<StreamSync>(Stream(1));
+
+  SUBCASE("streams") {
+    SimulatedBenchmarker sim(model);
+    Sequence<BoundOp> serial({a0, b0, ss0});
+    Sequence<BoundOp> parallel({a0, b1, ss0, ss1});
+    CHECK(sim.benchmark(serial, plat).pct50 == 21);
+    Result res = sim.benchmark(parallel, plat);
+    CHECK(res.pct01 == 12);
+    CHECK(res.pct99 == 12);
+    CHECK(res.stddev == 0);
+
+    // what if the device could only run one at a time
+    model.slots = 1;
+    CHECK(SimulatedBenchmarker(model).benchmark(parallel, plat).pct50 == 21);
+  }
+
+  SUBCASE("events") {
+    SimulatedBenchmarker sim(model);
+    Sequence<BoundOp> seq({a0, std::make_shared<CudaEventRecord>(Event(0), Stream(0)),
+                           std::make_shared<CudaStreamWaitEvent>(Stream(1), Event(0)), b1, ss1});
+    CHECK(sim.benchmark(seq, plat).pct50 == 21);
+
+    // the host only waits for a, but the run is not over until b is
+    Sequence<BoundOp> ces({a0, std::make_shared<CudaEventRecord>(Event(0), Stream(0)), b0,
+                           std::make_shared<CudaEventSync>(Event(0))});
+    CHECK(sim.simulate(ces) == 21); // b still runs
+  }
+
+  SUBCASE("times by name") {
+    model.times["a"] = 100;
+    SimulatedBenchmarker sim(model);
+    Sequence<BoundOp> seq({a0, b1, ss0, ss1});
+    CHECK(sim.benchmark(seq, plat).pct50 == 101);
+  }
+
+  SUBCASE("mpi") {
+    model.mpiLatency = 2;
+    model.mpiBandwidth = 100; // MPI is not initialized, so MPI_BYTE is one byte
+    SimulatedBenchmarker sim(model);
+
+    char buf[100];
+    MPI_Request sreq, rreq;
+    auto irecv = std::make_shared<Irecv>(
+        Irecv::Args{buf, 100, MPI_BYTE, 0, 7, MPI_COMM_WORLD, &rreq}, "irecv");
+    auto isend = std::make_shared<Isend>(
+        Isend::Args{buf, 100, MPI_BYTE, 0, 7, MPI_COMM_WORLD, &sreq}, "isend");
+    auto waitRecv = std::make_shared<Wait>(Wait::Args{&rreq, MPI_STATUS_IGNORE}, "wait-recv");
+    auto waitSend = std::make_shared<Wait>(Wait::Args{&sreq, MPI_STATUS_IGNORE}, "wait-send");
+
+    // posted at 1 and 2, then latency and 100 bytes
+    CHECK(sim.simulate(Sequence<BoundOp>({irecv, isend, waitRecv, waitSend})) == 5);
+
+    // the peer does not post its receive until after this rank waits for its send
+    CHECK_THROWS(sim.simulate(Sequence<BoundOp>({isend, waitSend, irecv, waitRecv})));
+  }
+
+  SUBCASE("mpi messages with the same tag") {
+    model.mpiLatency = 2;
+    model.mpiBandwidth = 100;
+    SimulatedBenchmarker sim(model);
+
+    char buf[100];
+    MPI_Request sreq1, rreq1, sreq2, rreq2;
+    auto irecv1 = std::make_shared<Irecv>(
+        Irecv::Args{buf, 100, MPI_BYTE, 1, 0, MPI_COMM_WORLD, &rreq1}, "irecv1");
+    auto isend1 = std::make_shared<Isend>(
+        Isend::Args{buf, 100, MPI_BYTE, 1, 0, MPI_COMM_WORLD, &sreq1}, "isend1");
+    auto irecv2 = std::make_shared<Irecv>(
+        Irecv::Args{buf, 100, MPI_BYTE, 1, 0, MPI_COMM_WORLD, &rreq2}, "irecv2");
+    auto isend2 = std::make_shared<Isend>(
+        Isend::Args{buf, 100, MPI_BYTE, 1, 0, MPI_COMM_WORLD, &sreq2}, "isend2");
+    auto waitRecv1 = std::make_shared<Wait>(Wait::Args{&rreq1, MPI_STATUS_IGNORE}, "wait-recv1");
+    auto waitSend1 = std::make_shared<Wait>(Wait::Args{&sreq1, MPI_STATUS_IGNORE}, "wait-send1");
+
+    // the first messages are matched first: posted at 1 and 2, done at 5
+    CHECK(sim.simulate(
+              Sequence<BoundOp>({irecv1, isend1, irecv2, isend2, waitRecv1, waitSend1})) == 5);
+
+    // a receive from another peer does not match the send, so it completes on its own at 4
+    auto irecvOther = std::make_shared<Irecv>(
+        Irecv::Args{buf, 100, MPI_BYTE, 2, 0, MPI_COMM_WORLD, &rreq1}, "irecv-other");
+    CHECK(sim.simulate(Sequence<BoundOp>({isend1, irecvOther, waitSend1})) == 4);
+  }
+
+  SUBCASE("noise") {
+    model.noise = 0.1;
+    Benchmark::Opts opts;
+    opts.nIters = 200;
+    SimulatedBenchmarker sim1(model, 1), sim2(model, 1);
+    Sequence<BoundOp> seq({a0, b1, ss0, ss1});
+    Result r1 = sim1.benchmark(seq, plat, opts);
+    Result r2 = sim2.benchmark(seq, plat, opts);
+    CHECK(r1.pct01 < r1.pct50);
+    CHECK(r1.pct50 < r1.pct99);
+    CHECK(r1.stddev > 0);
+    CHECK(r1.pct50 == r2.pct50); // same seed
+    CHECK(r1.nIters == 200);
+  }
+}
+
+TEST_CASE("[cpu]" " " "csv benchmarker") {
+
+  auto a = std::make_shared<Kernel>("a");
+  auto b = std::make_shared<Kernel>("b");
+  Graph<OpBase> graph;
+  graph.start_then(a);
+  graph.then(a, b);
+  graph.then_finish(b);
+
+  auto sync = [&](Stream sa, Stream sb, Event e) {
+    return Sequence<BoundOp>({std::make_shared<BoundGpuOp>(a, sa),
+                              std::make_shared<CudaEventRecord>(e, sa),
+                              std::make_shared<CudaStreamWaitEvent>(sb, e),
+                              std::make_shared<BoundGpuOp>(b, sb)});
+  };
+
+  // the rows are written the way the searches write their results
+  char path[] = "/tmp/tenzing-csv-XXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  close(fd);
+  {
+    std::ofstream os(path);
+    os << "i|pct01|pct10|pct50|pct90|pct99|stddev|op0|op1|op2|op3\n";
+    std::vector<Sequence<BoundOp>> rows{sync(Stream(0), Stream(0), Event(0)),
+                                        sync(Stream(0), Stream(1), Event(0)),
+                                        sync(Stream(1), Stream(0), Event(1))};
+    for (size_t i = 0; i < rows.size(); ++i) {
+      os << i;
+      for (int p = 0; p < 6; ++p) {
+        os << "|" << i + 1;
+      }
+      for (const auto &op : rows[i]) {
+        os << "|" << op->json();
+      }
+      os << "\n";
+    }
+  }
+
+  CsvBenchmarker bench(path, graph);
+  {
+    // the same rows from a result file
+    const std::string binPath = std::string(path) + ".tzr";
+    csv_to_result_file(path, binPath);
+    CsvBenchmarker binBench(binPath, graph);
+    std::remove(binPath.c_str());
+    CHECK(binBench.data_.empty()); // rows are read from the file
+    REQUIRE(binBench.file_);
+    CHECK(binBench.file_->size() == 3);
+    CHECK(binBench.index_ == bench.index_);
+    CHECK(binBench.fileOps_.size() == 9); // each distinct operation, not each of the 12 cells
+
+    Platform plat(MPI_COMM_WORLD);
+    for (size_t i = 0; i < 3; ++i) {
+      CHECK(binBench.benchmark(bench.data_[i].seq, plat).pct50 ==
+            bench.benchmark(bench.data_[i].seq, plat).pct50);
+    }
+    Sequence<BoundOp> seq = sync(Stream(1), Stream(2), Event(4));
+    CHECK(binBench.benchmark(seq, plat).pct50 == 2);
+    seq = Sequence<BoundOp>({std::make_shared<BoundGpuOp>(a, Stream(0))});
+    CHECK_THROWS(binBench.benchmark(seq, plat));
+  }
+  std::remove(path);
+  REQUIRE(bench.data_.size() == 3);
+  CHECK(bench.index_.size() == 2); // the last two rows are the same up to relabeling
+  CHECK(bench.data_[0].seq[0] == bench.data_[1].seq[0]); // a in stream 0 parsed once
+
+  Platform plat(MPI_COMM_WORLD);
+  Sequence<BoundOp> seq = sync(Stream(3), Stream(3), Event(2));
+  CHECK(bench.benchmark(seq, plat).pct50 == 1);
+  seq = sync(Stream(1), Stream(2), Event(4));
+  CHECK(bench.benchmark(seq, plat).pct50 == 2); // the first equivalent row
+  seq = Sequence<BoundOp>({std::make_shared<BoundGpuOp>(a, Stream(0))});
+  CHECK_THROWS(bench.benchmark(seq, plat));
+}
+
+TEST_CASE("[cpu]" " " "csv benchmarker replays results recorded before events were shared") {
+  auto a = std::make_shared<Kernel>("a");
+  auto b = std::make_shared<Kernel>("b");
+  auto c = std::make_shared<Kernel>("c");
+  Graph<OpBase> graph;
+  graph.start_then(a);
+  graph.then(a, b);
+  graph.then(b, c);
+  graph.then_finish(c);
+
+  // every sequence of the graph on two streams, as the searches recorded them, one event per sync
+  const char *rows[] = {
+      R"({"name":"Start"}|{"name":"a","stream":0}|{"name":"b","stream":0}|)"
+      R"({"name":"c","stream":0}|)"
+      R"({"event":0,"kind":"CudaEventRecord","name":"CER-after-c","stream":0}|)"
+      R"({"event":0,"kind":"CudaEventSync","name":"CES-b4-Finish"}|{"name":"Finish"})",
+      R"({"name":"Start"}|{"name":"a","stream":0}|{"name":"b","stream":0}|)"
+      R"({"event":0,"kind":"CudaEventRecord","name":"CER-b4-c","stream":0}|)"
+      R"({"event":0,"kind":"CudaStreamWaitEvent","name":"CSWE-after-b","stream":1}|)"
+      R"({"name":"c","stream":1}|)"
+      R"({"event":1,"kind":"CudaEventRecord","name":"CER-after-c","stream":1}|)"
+      R"({"event":1,"kind":"CudaEventSync","name":"CES-b4-Finish"}|{"name":"Finish"})",
+      R"({"name":"Start"}|{"name":"a","stream":0}|)"
+      R"({"event":0,"kind":"CudaEventRecord","name":"CER-b4-b","stream":0}|)"
+      R"({"event":0,"kind":"CudaStreamWaitEvent","name":"CSWE-after-a","stream":1}|)"
+      R"({"name":"b","stream":1}|)"
+      R"({"event":1,"kind":"CudaEventRecord","name":"CER-b4-c","stream":1}|)"
+      R"({"event":1,"kind":"CudaStreamWaitEvent","name":"CSWE-after-b","stream":0}|)"
+      R"({"name":"c","stream":0}|)"
+      R"({"event":2,"kind":"CudaEventRecord","name":"CER-after-c","stream":0}|)"
+      R"({"event":2,"kind":"CudaEventSync","name":"CES-b4-Finish"}|{"name":"Finish"})",
+      R"({"name":"Start"}|{"name":"a","stream":0}|)"
+      R"({"event":0,"kind":"CudaEventRecord","name":"CER-b4-b","stream":0}|)"
+      R"({"event":0,"kind":"CudaStreamWaitEvent","name":"CSWE-after-a","stream":1}|)"
+      R"({"name":"b","stream":1}|{"name":"c","stream":1}|)"
+      R"({"event":1,"kind":"CudaEventRecord","name":"CER-after-c","stream":1}|)"
+      R"({"event":1,"kind":"CudaEventSync","name":"CES-b4-Finish"}|{"name":"Finish"})"};
+  char path[] = "/tmp/tenzing-csv-XXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  close(fd);
+  {
+    std::ofstream os(path);
+    os << "i|pct01|pct10|pct50|pct90|pct99|stddev";
+    for (int i = 0; i < 11; ++i) {
+      os << "|op" << i;
+    }
+    os << "\n";
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); ++i) {
+      os << i << "|" << i << "|" << i << "|" << i << "|" << i << "|" << i << "|0|" << rows[i]
+         << "\n";
+    }
+  }
+  CsvBenchmarker bench(path, graph);
+  std::remove(path);
+  REQUIRE(bench.data_.size() == 4);
+
+  // search the way the solvers do, and look up every sequence they would benchmark
+  Platform plat(MPI_COMM_WORLD);
+  plat.streams_.push_back(Stream(0));
+  plat.streams_.push_back(Stream(1));
+  SDP::SearchState state(SDP::State(graph, {std::make_shared<Start>()}));
+  std::vector<Sequence<BoundOp>> seqs;
+  std::function<void()> visit = [&]() {
+    std::vector<Decision> decisions = state.state().get_decisions(plat);
+    if (decisions.empty()) {
+      seqs.push_back(state.state().sequence());
+    }
+    for (size_t i = 0; i < decisions.size(); ++i) {
+      state.apply(decisions, i);
+      visit();
+      state.undo();
+    }
+  };
+  visit();
+  REQUIRE(seqs.size() == 4);
+
+  std::set<double> found;
+  size_t renumbered = 0;
+  for (Sequence<BoundOp> &seq : seqs) {
+    Result r;
+    REQUIRE_NOTHROW(r = bench.benchmark(seq, plat));
+    found.insert(r.pct50);
+
+    // they would not match with their events renumbered
+    Sequence<BoundOp> recolored = recolor_events(seq);
+    if (recolored.vector() != seq.vector()) {
+      ++renumbered;
+      CHECK_THROWS(bench.benchmark(recolored, plat));
+    }
+  }
+  CHECK(found.size() == 4);
+  CHECK(renumbered == 3); // all but the one with a single event
+
+  // a -> b -> c across streams uses three events, which can share one cudaEvent_t
+  const std::map<Event, size_t> shared = share_events(bench.data_[2].seq);
+  CHECK(shared == std::map<Event, size_t>({{Event(0), 0}, {Event(1), 0}, {Event(2), 0}}));
+}
+
+TEST_CASE("[cpu]" " " "racing") {
+  typedef Benchmark::Racing::Verdict Verdict;
+
+  SUBCASE("interval") {
+    std::vector<double> sorted;
+    for (int i = 1; i <= 100; ++i) {
+      sorted.push_back(i);
+    }
+    double lo, hi;
+    CHECK(Benchmark::Racing::interval(sorted, 10, 1.96, &lo, &hi) == 11);
+    CHECK(lo == 5);
+    CHECK(hi == 17);
+    const double pct10 = Benchmark::summarize(sorted).pct10;
+    CHECK(Benchmark::Racing::interval(sorted, 10, 0, &lo, &hi) == pct10);
+    CHECK(lo == hi);
+    Benchmark::Racing::interval(sorted, 99, 1.96, &lo, &hi);
+    CHECK(hi == 100); // clamped to the largest sample
+  }
+
+  // how many of at most nIters normally-distributed times it takes to reach a verdict
+  std::mt19937 rng(0);
+  auto race = [&](const Benchmark::Racing &racing, double mean, double best, size_t nIters,
+                  Verdict *verdict) -> size_t {
+    std::normal_distribution<double> dist(mean, 0.05 * mean);
+    std::vector<double> sorted;
+    *verdict = Verdict::more;
+    while (sorted.size() < nIters && Verdict::more == *verdict) {
+      Benchmark::Racing::insert(sorted, dist(rng));
+      *verdict = racing.verdict(sorted, best);
+    }
+    CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+    return sorted.size();
+  };
+
+  Benchmark::Racing racing;
+  Verdict verdict;
+
+  SUBCASE("disabled") {
+    CHECK(race(racing, 2, 1, 100, &verdict) == 100);
+    CHECK(verdict == Verdict::more);
+  }
+
+  racing.pct = 10;
+
+  SUBCASE("clearly worse") {
+    CHECK(race(racing, 1.5, 1, 1000, &verdict) == racing.minIters);
+    CHECK(verdict == Verdict::worse);
+  }
+
+  SUBCASE("no best yet") {
+    racing.relWidth = 0.05;
+    const size_t n = race(racing, 1.5, std::numeric_limits<double>::infinity(), 1000, &verdict);
+    CHECK(verdict == Verdict::converged);
+    CHECK(n > racing.minIters);
+    CHECK(n < 1000);
+  }
+
+  SUBCASE("as fast as the best") {
+    racing.relWidth = 0;
+    CHECK(race(racing, 1, 1, 200, &verdict) == 200);
+    CHECK(verdict == Verdict::more);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
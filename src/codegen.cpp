@@ -0,0 +1,354 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/codegen.hpp"
+
+#include "tenzing/cuda/ops_cuda.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace codegen {
+
+namespace {
+
+bool is_identifier(const std::string &s) {
+  if (s.empty() || std::isdigit(static_cast<unsigned char>(s[0]))) {
+    return false;
+  }
+  for (char c : s) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && '_' != c) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// a C++ string literal for s
+std::string quoted(const std::string &s) {
+  std::stringstream ss;
+  ss << '"';
+  for (char c : s) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    if ('"' == c || '\\' == c || '?' == c) { // \? so ?? can't start a trigraph
+      ss << '\\' << c;
+    } else if ('\n' == c) {
+      ss << "\\n";
+    } else if ('\r' == c) {
+      ss << "\\r";
+    } else if ('\t' == c) {
+      ss << "\\t";
+    } else if (std::iscntrl(u)) {
+      // always three octal digits, so a following digit isn't read as part of the escape
+      ss << '\\' << std::oct << std::setw(3) << std::setfill('0') << int(u) << std::dec;
+    } else {
+      ss << c;
+    }
+  }
+  ss << '"';
+  return ss.str();
+}
+
+// s as the text of a // comment, which must stay on its line
+std::string comment(std::string s) {
+  for (char &c : s) {
+    if (std::iscntrl(static_cast<unsigned char>(c))) {
+      c = ' ';
+    }
+  }
+  // a line ending in \ (or its trigraph) would continue the comment onto the next line
+  for (;;) {
+    const size_t n = s.size();
+    if (n > 0 && (' ' == s[n - 1] || '\\' == s[n - 1])) {
+      s.resize(n - 1);
+    } else if (n > 2 && '/' == s[n - 1] && '?' == s[n - 2] && '?' == s[n - 3]) {
+      s.resize(n - 3);
+    } else {
+      return s;
+    }
+  }
+}
+
+// dense indices for stream and event ids, in order of first use
+template <typename T> class Slots {
+  std::map<T, size_t> slots_;
+
+public:
+  size_t operator()(const T &t) { return slots_.emplace(t, slots_.size()).first->second; }
+  size_t size() const { return slots_.size(); }
+};
+
+} // namespace
+
+std::string generate_cpp(const Sequence<BoundOp> &seq, const Graph<OpBase> &g, const Opts &opts) {
+  if (!is_identifier(opts.name)) {
+    THROW_RUNTIME("\"" << opts.name << "\" is not a C++ identifier");
+  }
+  const std::string &fn = opts.name;
+
+  Slots<Stream> streams;
+  Slots<Event> events;
+  std::stringstream body;
+
+  // each CUDA call returns on failure
+  auto call = [&](const std::string &expr, const std::string &desc) {
+    body << "  err = " << expr << "; // " << comment(desc) << "\n";
+    body << "  if (cudaSuccess != err) return err;\n";
+  };
+  auto stream = [&](const Stream &s) {
+    return fn + "_streams()[" + std::to_string(streams(s)) + "]";
+  };
+  auto event = [&](const Event &e) {
+    return fn + "_events()[" + std::to_string(events(e)) + "]";
+  };
+
+  for (const std::shared_ptr<BoundOp> &op : seq) {
+    if (std::dynamic_pointer_cast<Start>(op) || std::dynamic_pointer_cast<Finish>(op)) {
+      continue;
+    } else if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+      call("cudaEventRecord(" + event(cer->event()) + ", " + stream(cer->stream()) + ")",
+           op->desc());
+    } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+      call("cudaStreamWaitEvent(" + stream(cswe->stream()) + ", " + event(cswe->event()) + ", 0)",
+           op->desc());
+    } else if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(op)) {
+      call("cudaEventSynchronize(" + event(ces->event()) + ")", op->desc());
+    } else if (auto ss = std::dynamic_pointer_cast<StreamSync>(op)) {
+      call("cudaStreamSynchronize(" + stream(ss->stream()) + ")", op->desc());
+    } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(op)) {
+      call("cudaEventRecord(" + event(sw->event()) + ", " + stream(sw->waitee()) + ")",
+           op->desc());
+      call("cudaStreamWaitEvent(" + stream(sw->waiter()) + ", " + event(sw->event()) + ", 0)",
+           op->desc());
+    } else {
+      if (Graph<OpBase>::npos == g.find_or_find_unbound(op)) {
+        THROW_RUNTIME("operation " << op->desc() << " is not in the graph");
+      }
+      if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(op)) {
+        body << "  hooks.gpu(" << quoted(op->name()) << ", " << stream(gpu->stream()) << ");\n";
+      } else {
+        body << "  hooks.cpu(" << quoted(op->name()) << ");\n";
+      }
+    }
+  }
+
+  // arrays of size 0 are not allowed
+  const size_t nStreams = std::max(streams.size(), size_t(1));
+  const size_t nEvents = std::max(events.size(), size_t(1));
+
+  std::stringstream ss;
+  ss << "// generated by tenzing: " << seq.size() << " operations, " << streams.size()
+     << " streams, " << events.size() << " events\n";
+  ss << "#pragma once\n\n";
+  ss << "#include <cuda_runtime.h>\n\n";
+
+  ss << "inline cudaStream_t *" << fn << "_streams() {\n";
+  ss << "  static cudaStream_t streams[" << nStreams << "];\n";
+  ss << "  return streams;\n";
+  ss << "}\n\n";
+  ss << "inline cudaEvent_t *" << fn << "_events() {\n";
+  ss << "  static cudaEvent_t events[" << nEvents << "];\n";
+  ss << "  return events;\n";
+  ss << "}\n\n";
+
+  ss << "inline cudaError_t " << fn << "_init() {\n";
+  ss << "  cudaError_t err = cudaSuccess;\n";
+  ss << "  for (int i = 0; i < " << streams.size() << "; ++i) {\n";
+  ss << "    err = cudaStreamCreate(&" << fn << "_streams()[i]);\n";
+  ss << "    if (cudaSuccess != err) return err;\n";
+  ss << "  }\n";
+  ss << "  for (int i = 0; i < " << events.size() << "; ++i) {\n";
+  ss << "    err = cudaEventCreateWithFlags(&" << fn << "_events()[i], cudaEventDisableTiming);\n";
+  ss << "    if (cudaSuccess != err) return err;\n";
+  ss << "  }\n";
+  ss << "  return err;\n";
+  ss << "}\n\n";
+
+  ss << "inline cudaError_t " << fn << "_destroy() {\n";
+  ss << "  cudaError_t err = cudaSuccess;\n";
+  ss << "  for (int i = 0; i < " << streams.size() << "; ++i) {\n";
+  ss << "    err = cudaStreamDestroy(" << fn << "_streams()[i]);\n";
+  ss << "    if (cudaSuccess != err) return err;\n";
+  ss << "  }\n";
+  ss << "  for (int i = 0; i < " << events.size() << "; ++i) {\n";
+  ss << "    err = cudaEventDestroy(" << fn << "_events()[i]);\n";
+  ss << "    if (cudaSuccess != err) return err;\n";
+  ss << "  }\n";
+  ss << "  return err;\n";
+  ss << "}\n\n";
+
+  ss << "template <typename Hooks> cudaError_t " << fn << "(Hooks &hooks) {\n";
+  ss << "  cudaError_t err = cudaSuccess;\n";
+  ss << "  (void)hooks;\n";
+  ss << body.str();
+  ss << "  return err;\n";
+  ss << "}\n";
+  return ss.str();
+}
+
+} // namespace codegen
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+
+#include <unistd.h>
+
+// check that generated code compiles, with the compiler the tests were built with if it's here
+void check_compiles(const std::string &src, const std::string &fn = "tenzing_schedule") {
+#ifdef TENZING_TEST_CXX_COMPILER
+  const std::string cxx = TENZING_TEST_CXX_COMPILER;
+  if (0 != std::system((cxx + " --version > /dev/null 2>&1").c_str())) {
+    MESSAGE("skipping compile of generated code: " << cxx << " is not available");
+    return;
+  }
+
+  char dir[] = "/tmp/tenzing-codegen-XXXXXX";
+  REQUIRE(mkdtemp(dir));
+  const std::string hpp = std::string(dir) + "/schedule.hpp";
+  const std::string cpp = std::string(dir) + "/use.cpp";
+  {
+    std::ofstream os(hpp);
+    os << src;
+  }
+  {
+    // instantiate the schedule, so its body is checked too
+    std::ofstream os(cpp);
+    os << "#include \"schedule.hpp\"\n"
+       << "struct Hooks {\n"
+       << "  void cpu(const char *) {}\n"
+       << "  void gpu(const char *, cudaStream_t) {}\n"
+       << "};\n"
+       << "cudaError_t use() {\n"
+       << "  Hooks hooks;\n"
+       << "  return " << fn << "(hooks);\n"
+       << "}\n";
+  }
+  const std::string cmd = cxx + " -std=c++11 -fsyntax-only -Wall -Wextra -Werror " +
+                          TENZING_TEST_CXX_FLAGS + " " + cpp;
+  CHECK_MESSAGE(0 == std::system(cmd.c_str()), cmd);
+  std::remove(cpp.c_str());
+  std::remove(hpp.c_str());
+  rmdir(dir);
+#else
+  (void)src;
+  (void)fn;
+#endif
+}
+
+TEST_CASE("[cpu]" " " "codegen") {
+
+  // each run appends its name to a trace
+  struct Traced : public CpuOp {
+    std::string name_;
+    std::vector<std::string> *trace_;
+    Traced(const std::string &name, std::vector<std::string> *trace)
+        : name_(name), trace_(trace) {}
+    void run(Platform &) override { trace_->push_back(name_); }
+    std::string name() const override { return name_; }
+    bool operator<(const Traced &rhs) const { return name_ < rhs.name_; }
+    bool operator==(const Traced &rhs) const { return name_ == rhs.name_; }
+    CLONE_DEF(Traced);
+    LT_DEF(Traced);
+    EQ_DEF(Traced);
+  };
+
+  // start -> a -> b -> "c \"quoted\"" -> finish
+  //               -> noop ->
+  std::vector<std::string> trace;
+  auto a = std::make_shared<Traced>("a", &trace);
+  auto b = std::make_shared<Traced>("b", &trace);
+  auto c = std::make_shared<Traced>("c \"quoted\"", &trace);
+  auto noop = std::make_shared<NoOp>("noop");
+  Graph<OpBase> graph;
+  graph.start_then(a);
+  graph.then(a, b);
+  graph.then(a, noop);
+  graph.then(b, c);
+  graph.then(noop, c);
+  graph.then_finish(c);
+
+  auto start = std::dynamic_pointer_cast<BoundOp>(graph.start());
+  auto finish = std::dynamic_pointer_cast<BoundOp>(graph.finish());
+  Sequence<BoundOp> seq({start, a, noop, b, c, finish});
+
+  // the hook calls in the generated code
+  const std::string src = codegen::generate_cpp(seq, graph);
+  std::vector<std::string> generated;
+  std::regex cpuHook("hooks\\.cpu\\(\"((?:[^\"\\\\]|\\\\.)*)\"\\);");
+  for (std::sregex_iterator it(src.begin(), src.end(), cpuHook), end; it != end; ++it) {
+    generated.push_back(std::regex_replace((*it)[1].str(), std::regex("\\\\(.)"), "$1"));
+  }
+
+  Platform plat(MPI_COMM_WORLD);
+  for (const auto &op : seq) {
+    op->run(plat);
+  }
+
+  // NoOp leaves no trace when run by tenzing, but still gets a hook
+  REQUIRE(generated.size() == 4);
+  CHECK(generated[1] == "noop");
+  generated.erase(generated.begin() + 1);
+  CHECK(generated == trace);
+
+  CHECK(src.find("template <typename Hooks> cudaError_t tenzing_schedule(Hooks &hooks)") !=
+        std::string::npos);
+  CHECK(src.find("Start") == std::string::npos);
+  check_compiles(src);
+
+  SUBCASE("synchronization") {
+    Sequence<BoundOp> sync({a, std::make_shared<CudaEventRecord>(Event(7), Stream(3)),
+                            std::make_shared<CudaStreamWaitEvent>(Stream(5), Event(7)),
+                            std::make_shared<CudaEventSync>(Event(7)),
+                            std::make_shared<StreamSync>(Stream(5))});
+    codegen::Opts opts;
+    opts.name = "sched";
+    const std::string s = codegen::generate_cpp(sync, graph, opts);
+    // streams and events are numbered in order of first use
+    CHECK(s.find("cudaEventRecord(sched_events()[0], sched_streams()[0])") != std::string::npos);
+    CHECK(s.find("cudaStreamWaitEvent(sched_streams()[1], sched_events()[0], 0)") !=
+          std::string::npos);
+    CHECK(s.find("cudaEventSynchronize(sched_events()[0])") != std::string::npos);
+    CHECK(s.find("cudaStreamSynchronize(sched_streams()[1])") != std::string::npos);
+    CHECK(s.find("static cudaStream_t streams[2]") != std::string::npos);
+    check_compiles(s, "sched");
+  }
+
+  SUBCASE("escaping") {
+    // a name with control characters, and a description that ends in a line continuation
+    auto d = std::make_shared<Traced>("d\r\t\x01?\\", &trace);
+    struct Odd : public CudaEventRecord {
+      Odd() : CudaEventRecord(Event(0), Stream(0)) {}
+      std::string desc() const override { return "line\rbreak\\ \\"; }
+    };
+    Graph<OpBase> escaped;
+    escaped.start_then(d);
+    escaped.then_finish(d);
+    const std::string s =
+        codegen::generate_cpp(Sequence<BoundOp>({d, std::make_shared<Odd>()}), escaped);
+    CHECK(s.find("hooks.cpu(\"d\\r\\t\\001\\?\\\\\");\n") != std::string::npos);
+    CHECK(s.find("; // line break\n") != std::string::npos);
+    CHECK(s.find('\r') == std::string::npos);
+    CHECK(s.find("\\\n") == std::string::npos); // no line is continued
+    check_compiles(s);
+  }
+
+  SUBCASE("errors") {
+    codegen::Opts opts;
+    opts.name = "not an identifier";
+    CHECK_THROWS(codegen::generate_cpp(seq, graph, opts));
+    Sequence<BoundOp> other({std::make_shared<NoOp>("not in graph")});
+    CHECK_THROWS(codegen::generate_cpp(other, graph));
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
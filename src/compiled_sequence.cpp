@@ -0,0 +1,113 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/compiled_sequence.hpp"
+
+#include "tenzing/trace.hpp"
+
+#include <functional>
+#include <typeinfo>
+
+CompiledSequence CompiledSequence::compile(const Sequence<BoundOp> &seq, const Platform &plat) {
+  typedef Instr::Kind Kind;
+
+  CompiledSequence ret;
+  ret.seq_ = seq;
+  ret.instrs_.reserve(seq.size());
+
+  for (const std::shared_ptr<BoundOp> &op : seq) {
+    // exactly these types, a derived class may do something in run()
+    const std::type_info &ti = typeid(*op);
+    if (typeid(Start) == ti || typeid(Finish) == ti || typeid(NoOp) == ti) {
+      continue;
+    }
+
+    Instr in{};
+    in.op = op.get();
+    if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(op)) {
+      in.kind = Kind::gpu;
+      in.stream = plat.cuda_stream(gpu->stream());
+      in.gpu = gpu->unbound().get();
+    } else if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+      in.kind = Kind::event_record;
+      in.stream = plat.cuda_stream(cer->stream());
+      in.event = plat.cuda_event(cer->event());
+    } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+      in.kind = Kind::stream_wait_event;
+      in.stream = plat.cuda_stream(cswe->stream());
+      in.event = plat.cuda_event(cswe->event());
+    } else if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(op)) {
+      in.kind = Kind::event_sync;
+      in.event = plat.cuda_event(ces->event());
+    } else if (auto ss = std::dynamic_pointer_cast<StreamSync>(op)) {
+      in.kind = Kind::stream_sync;
+      in.stream = plat.cuda_stream(ss->stream());
+    } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(op)) {
+      in.kind = Kind::stream_wait;
+      in.stream = plat.cuda_stream(sw->waitee());
+      in.waiter = plat.cuda_stream(sw->waiter());
+      in.event = plat.cuda_event(sw->event());
+    } else {
+      in.kind = Kind::host;
+    }
+    ret.instrs_.push_back(in);
+    ret.id_ ^= std::hash<std::string>()(op->desc()) + 0x9e3779b9 + (ret.id_ << 6) + (ret.id_ >> 2);
+  }
+  return ret;
+}
+
+void CompiledSequence::run(Platform &plat, Trace &trace) const {
+  for (size_t i = 0; i < instrs_.size(); ++i) {
+    trace.begin(id_, i, instrs_[i]);
+    exec(instrs_[i], plat);
+    trace.end(instrs_[i]);
+  }
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/test_ops.hpp"
+
+using test_ops::Count;
+
+// the stream and event instructions are tested in test/test_gpu_compiled_sequence.cu
+TEST_CASE("[cpu]" " " "compiled sequence") {
+
+  typedef CompiledSequence::Instr::Kind Kind;
+
+  Platform plat(MPI_COMM_WORLD);
+
+  int count = 0;
+  auto c = std::make_shared<Count>(&count);
+  Sequence<BoundOp> seq({std::make_shared<Start>(), c, std::make_shared<NoOp>("noop"), c,
+                         std::make_shared<Finish>()});
+
+  CompiledSequence cs = CompiledSequence::compile(seq, plat);
+  CHECK(cs.sequence().size() == seq.size());
+
+  // Start, NoOp, and Finish are dropped
+  const std::vector<CompiledSequence::Instr> &instrs = cs.instrs();
+  REQUIRE(instrs.size() == 2);
+  CHECK(instrs[0].kind == Kind::host);
+  CHECK(instrs[1].kind == Kind::host);
+
+  cs.run(plat);
+  cs.run(plat);
+  CHECK(count == 4);
+
+  // the id depends on the operations and their order
+  CHECK(cs.id() == CompiledSequence::compile(seq, plat).id());
+  auto noop = std::make_shared<NoOp>("noop");
+  CHECK(cs.id() != CompiledSequence::compile(Sequence<BoundOp>({c}), plat).id());
+  CHECK(cs.id() == CompiledSequence::compile(Sequence<BoundOp>({c, noop, c}), plat).id());
+
+  SUBCASE("missing event") {
+    Sequence<BoundOp> bad({std::make_shared<CudaEventSync>(Event(2))});
+    CHECK_THROWS(CompiledSequence::compile(bad, plat));
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
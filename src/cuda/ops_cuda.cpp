@@ -129,11 +129,18 @@ void CudaEventSync::run(Platform &plat) {
   CUDA_RUNTIME(cudaEventSynchronize(plat.cuda_event(event_)));
 }
 
+std::string StreamWait::desc() const {
+  std::stringstream ss;
+  ss << "{" << name() << ", s:" << waitee_ << "->" << waiter_ << ", e:" << event_ << "}";
+  return ss.str();
+}
+
 nlohmann::json StreamWait::json() const {
   nlohmann::json j;
   j["name"] = name();
   j["waiter"] = waiter();
   j["waitee"] = waitee();
+  j["event"] = event();
   j["kind"] = "StreamWait";
   return j;
 }
@@ -167,6 +174,12 @@ void StreamSync::run(Platform &plat) {
   CUDA_RUNTIME(err);
 }
 
+std::string StreamSync::desc() const {
+  std::stringstream ss;
+  ss << "{" << name() << ", s:" << stream_ << "}";
+  return ss.str();
+}
+
 nlohmann::json StreamSync::json() const {
   nlohmann::json j;
   j["name"] = name();
@@ -232,4 +245,23 @@ void from_json(const nlohmann::json& j, std::shared_ptr<CudaEventSync> &op) {
     j.at("event").get_to(event);
     j.at("name").get_to(name);
     op = std::make_shared<CudaEventSync>(event, name);
-}
\ No newline at end of file
+}
+
+void from_json(const nlohmann::json& j, std::shared_ptr<StreamWait> &op) {
+    Event event;
+    Stream waitee, waiter;
+    std::string name;
+    j.at("event").get_to(event);
+    j.at("waitee").get_to(waitee);
+    j.at("waiter").get_to(waiter);
+    j.at("name").get_to(name);
+    op = std::make_shared<StreamWait>(waitee, waiter, event, name);
+}
+
+void from_json(const nlohmann::json& j, std::shared_ptr<StreamSync> &op) {
+    Stream stream;
+    std::string name;
+    j.at("stream").get_to(stream);
+    j.at("name").get_to(name);
+    op = std::make_shared<StreamSync>(stream, name);
+}
@@ -17,11 +17,11 @@ template <> void Graph<OpBase>::dump_graphviz(const std::string &path) const {
   os << "digraph D {";
 
   // dump nodes
-  for (const auto &kv : succs_) {
-    os << "op_" << kv.first.get() << " [label=\"";
-    os << kv.first->name();
+  for (vid_t u : vertices()) {
+    os << "op_" << op(u).get() << " [label=\"";
+    os << op(u)->name();
 
-    if (auto ss = std::dynamic_pointer_cast<BoundGpuOp>(kv.first)) {
+    if (auto ss = std::dynamic_pointer_cast<BoundGpuOp>(op(u))) {
       os << "\nstream " << ss->stream();
     }
 
@@ -29,9 +29,9 @@ template <> void Graph<OpBase>::dump_graphviz(const std::string &path) const {
   }
 
   // dump edges
-  for (const auto &kv : succs_) {
-    for (const auto &succ : kv.second) {
-      os << "op_" << kv.first.get() << " -> "
+  for (vid_t u : vertices()) {
+    for (const auto &succ : succs(u)) {
+      os << "op_" << op(u).get() << " -> "
          << "op_" << succ.get() << "\n";
     }
   }
@@ -59,8 +59,8 @@ std::vector<Graph<OpBase>> use_streams(const Graph<OpBase> &orig,
 
     // find a GpuNode in the graph
     bool hasGpuNode = false;
-    for (auto &kv : g.succs_) {
-      op_t n = kv.first;
+    for (Graph<OpBase>::vid_t v : g.vertices()) {
+      op_t n = g.op(v);
       if (gpu_t gpu = std::dynamic_pointer_cast<GpuOp>(n)) {
 
         // create a copy of that graph, with the GPU node replaced by a StreamedNode for each stream
@@ -144,9 +144,8 @@ Then the possible stream operations are
 
 In short to generate all the unique assignments:
 * 0th operation can be assiged to 1st resource
-* 1st operation can be assigned to 1st,2nd resource
-* 2nd operation can be assigned to 1st,2nd,3rd resource
-* 3rd operation ... 1st...4th resource
+* each later operation can be assigned to any resource used by an earlier operation, or the first
+  unused resource (a restricted growth string). e.g. S0 S0 S2 is the same as S0 S0 S1
 
 Of course, then you need to have cartesian product of resource type assignments as well
 
@@ -165,8 +164,8 @@ std::vector<Graph<OpBase>> use_streams2(const Graph<OpBase> &orig,
   // extract all GPU operations
   std::vector<gpu_t> gpuOps;
 
-  for (auto &kv : orig.succs_) {
-    op_t n = kv.first;
+  for (Graph<OpBase>::vid_t v : orig.vertices()) {
+    op_t n = orig.op(v);
     if (gpu_t gpu = std::dynamic_pointer_cast<GpuOp>(n)) {
       gpuOps.push_back(gpu);
     }
@@ -175,30 +174,47 @@ std::vector<Graph<OpBase>> use_streams2(const Graph<OpBase> &orig,
   // each assignment is a vector of which resource each gpuOp is assigned to
   std::vector<std::vector<int>> assignments;
 
-  size_t numAssignments = 1;
-  for (size_t i = 0; i < gpuOps.size(); ++i) {
-    numAssignments *= std::min(i + 1, streams.size());
-  }
-
-  std::cerr << "creating " << numAssignments << " assignments for " << gpuOps.size()
-            << " operations in " << streams.size() << " streams\n";
-
-  for (size_t ai = 0; ai < numAssignments; ++ai) {
-
-    std::vector<int> assignment;
-    int div = numAssignments;
-    for (size_t gi = 0; gi < gpuOps.size(); ++gi) {
-      int numOptions = std::min(gi + 1, streams.size());
-      div /= numOptions;
-
-      // std::cerr << "ass " << ai << ": idx=" << gi << " div=" << div << " mod=" << numOptions <<
-      // "\n";
+  /* enumerate restricted growth strings: each operation may use any stream used by an earlier
+     operation, or the next unused one. Odometer over the strings in lexicographic order
+  */
+  if (!streams.empty()) {
+    std::vector<int> assignment(gpuOps.size(), 0);
+    std::vector<int> maxBefore(gpuOps.size(), 0); // largest stream used before each operation
+    if (!maxBefore.empty()) {
+      maxBefore[0] = -1;
+    }
+    while (true) {
+      assignments.push_back(assignment);
+
+      // find the last operation that can move to another stream
+      size_t gi = gpuOps.size();
+      while (gi > 0) {
+        --gi;
+        const int limit = std::min(maxBefore[gi] + 1, int(streams.size()) - 1);
+        if (assignment[gi] < limit) {
+          break;
+        }
+        if (0 == gi) {
+          gi = gpuOps.size();
+          break;
+        }
+      }
+      if (gi == gpuOps.size()) {
+        break;
+      }
 
-      assignment.push_back((ai / div) % numOptions);
+      // advance it and reset all later operations to the first stream
+      ++assignment[gi];
+      for (size_t gj = gi + 1; gj < gpuOps.size(); ++gj) {
+        maxBefore[gj] = std::max(maxBefore[gj - 1], assignment[gj - 1]);
+        assignment[gj] = 0;
+      }
     }
-    assignments.push_back(assignment);
   }
 
+  std::cerr << "creating " << assignments.size() << " assignments for " << gpuOps.size()
+            << " operations in " << streams.size() << " streams\n";
+
   std::vector<Graph<OpBase>> ret;
 
   for (const auto &assignment : assignments) {
@@ -257,70 +273,47 @@ bool is_equivalent_stream_mapping(const Graph<OpBase> &a, const Graph<OpBase> &b
   };
 
   // same number of operations in the two graphs
-  if (a.preds_.size() != b.preds_.size()) {
+  if (a.vertex_size() != b.vertex_size()) {
     return false;
   }
 
-#if 0
-    if ( 0 == rank ) {
-        std::cerr <<  "a\tb:\n";
-        auto ai = a.succs_.begin();
-        auto bi = b.succs_.begin();
-        for(;ai != a.succs_.end() && bi != b.succs_.end(); ++ai, ++bi) {
-
-            std::cerr << ai->first->name() << "\t" << bi->first->name() << "\n";
-
-        }
-        std::cerr <<  "\n";
-    }
-#endif
+  // graphs derived from the same graph keep the same vertex ids
+  auto ai = a.vertices().begin();
+  auto bi = b.vertices().begin();
+  for (; ai != a.vertices().end() && bi != b.vertices().end(); ++ai, ++bi) {
 
-  // we're guaranteed consistent operation sorting
-  auto ai = a.succs_.begin();
-  auto bi = b.succs_.begin();
-  for (; ai != a.succs_.end() && bi != b.succs_.end(); ++ai, ++bi) {
+    const auto &u_a = a.op(*ai);
+    const auto &u_b = b.op(*bi);
 
-    const auto u_a = ai->first;
-    const auto u_b = bi->first;
-
-#if 0
-        if (0 == rank) std::cerr << "compare " << u_a->name() << " vs. " << u_b->name() << "\n";
-#endif
     if (!u_a->eq(u_b)) { // not same operation
-      // if (0 == rank) std::cerr << "FALSE: unequal operations: " << u_a->name() << " vs. " <<
-      // u_b->name() << "\n";
       return false;
     }
 
     // check if operations are equivalent under stream bijection
     if (!check_or_update_bijection(u_a, u_b)) {
-      // if (0 == rank) std::cerr << "FALSE: failed bijection\n";
       return false;
     }
 
     // same number of successors
-    if (a.succs_.at(u_a).size() != b.succs_.at(u_b).size()) {
-      // if (0 == rank) std::cerr << "FALSE: different number of successors\n";
+    if (a.succs(*ai).size() != b.succs(*bi).size()) {
       return false;
     }
     // same number of predecessors
-    if (a.preds_.at(u_a).size() != b.preds_.at(u_b).size()) {
-      // if (0 == rank) std::cerr << "FALSE: different number of predecessors\n";
+    if (a.preds(*ai).size() != b.preds(*bi).size()) {
       return false;
     }
 
     // all succs must be equal. no need to check bijection since we
     // check each node's equality under bijection later
     {
-      const auto &as = a.succs_.at(u_a);
-      const auto &bs = b.succs_.at(u_b);
+      const auto as = a.succs(*ai);
+      const auto bs = b.succs(*bi);
 
       auto asi = as.begin();
       auto bsi = bs.begin();
 
       for (; asi != as.end() && bsi != bs.end(); ++asi, ++bsi) {
         if (!((*asi)->eq(*bsi))) {
-          // if (0 == rank) std::cerr << "FALSE: succ mismatch\n";
           return false;
         }
       }
@@ -328,15 +321,14 @@ bool is_equivalent_stream_mapping(const Graph<OpBase> &a, const Graph<OpBase> &b
 
     // all preds must be equal
     {
-      const auto &as = a.preds_.at(u_a);
-      const auto &bs = b.preds_.at(u_b);
+      const auto as = a.preds(*ai);
+      const auto bs = b.preds(*bi);
 
       auto asi = as.begin();
       auto bsi = bs.begin();
 
       for (; asi != as.end() && bsi != bs.end(); ++asi, ++bsi) {
         if (!((*asi)->eq(*bsi))) {
-          // if (0 == rank) std::cerr << "FALSE: pred mismatch\n";
           return false;
         }
       }
@@ -353,20 +345,20 @@ Equivalence get_equivalence(const Graph<OpBase> &a, const Graph<OpBase> &b) {
   Equivalence eq;
 
   // for each vertex in a
-  for (const auto &akv : a.succs_) {
+  for (Graph<OpBase>::vid_t av : a.vertices()) {
 
-    const auto &au = akv.first;
+    const auto &au = a.op(av);
 
     // find the equivalent vertex in bu
     // FIXME: better way to do this than name?
-    const auto &bui = b.succs_find_name(au->name());
+    const Graph<OpBase>::vid_t bv = b.find_name(au->name());
 
-    if (b.succs_.end() == bui) {
+    if (Graph<OpBase>::npos == bv) {
       STDERR("no " << au->desc() << " in b");
       return Equivalence::falsy();
     }
 
-    const auto &bu = bui->first;
+    const auto &bu = b.op(bv);
 
     STDERR(au->desc() << " vs " << bu->desc());
 
@@ -422,6 +414,8 @@ Equivalence get_equivalence(const Graph<OpBase> &a, const Graph<OpBase> &b) {
 #if TENZING_ENABLE_TESTS == 1
 #include <doctest/doctest.hpp>
 
+#include <type_traits>
+#include <utility>
 
 TEST_CASE("[cpu]" " " "empty graph") {
   Graph<OpBase> graph;
@@ -498,4 +492,126 @@ TEST_CASE("[cpu]" " " "graph clone") {
 
 }
 
+// whether G has a callable succs_find_or_find_unbound
+template <typename G, typename = void> struct HasSuccsFind : std::false_type {};
+template <typename G>
+struct HasSuccsFind<G, decltype((void)std::declval<const G &>().succs_find_or_find_unbound(
+                           std::declval<typename G::op_t>()))> : std::true_type {};
+
+TEST_CASE("[cpu]" " " "graph vertex ids") {
+  Graph<OpBase> graph;
+  auto noop1 = std::make_shared<NoOp>("noop1");
+  auto noop2 = std::make_shared<NoOp>("noop2");
+  auto noop3 = std::make_shared<NoOp>("noop3");
+  graph.start_then(noop1);
+  graph.then(noop1, noop2);
+  graph.then_finish(noop2);
+
+  const Graph<OpBase>::vid_t v1 = graph.find(noop1);
+  const Graph<OpBase>::vid_t v2 = graph.find(noop2);
+  REQUIRE(v1 != Graph<OpBase>::npos);
+  REQUIRE(v2 != Graph<OpBase>::npos);
+  CHECK(graph.find(noop3) == Graph<OpBase>::npos);
+  CHECK(graph.find(std::make_shared<NoOp>("noop1")) == v1); // found by value
+  CHECK(graph.find_or_find_unbound(noop1) == v1);
+  CHECK(graph.find_or_find_unbound(noop3) == Graph<OpBase>::npos);
+  CHECK(!HasSuccsFind<Graph<OpBase>>::value); // callers of the removed lookup don't compile
+
+  SUBCASE("replace keeps id and edges") {
+    graph.replace(noop1, noop3);
+    CHECK(graph.find(noop3) == v1);
+    CHECK(graph.find(noop1) == Graph<OpBase>::npos);
+    CHECK(graph.succs(v1).size() == 1);
+    CHECK(*graph.succs(v1).begin() == noop2);
+    CHECK(graph.vertex_size() == 4);
+  }
+
+  SUBCASE("erase keeps other ids") {
+    graph.erase(noop1.get());
+    CHECK(graph.vertex_size() == 3);
+    CHECK(graph.find(noop2) == v2);
+    CHECK(graph.preds(v2).size() == 0);
+    CHECK(graph.succs(graph.start_id()).size() == 0);
+  }
+}
+
+TEST_CASE("[cpu]" " " "graph sharing") {
+  Graph<OpBase> graph;
+  std::vector<std::shared_ptr<OpBase>> ops;
+  for (int i = 0; i < 200; ++i) { // a few chunks worth
+    ops.push_back(std::make_shared<NoOp>("noop" + std::to_string(i)));
+    if (0 == i) {
+      graph.start_then(ops[i]);
+    } else {
+      graph.then(ops[i - 1], ops[i]);
+    }
+  }
+  graph.then_finish(ops.back());
+
+  auto replacement = std::make_shared<NoOp>("replacement");
+  Graph<OpBase> g2 = graph.clone_but_replace(replacement, ops[100]);
+
+  // the original is unchanged
+  CHECK(graph.contains(ops[100]));
+  CHECK(!graph.contains(replacement));
+  CHECK(graph.vertex_size() == 202);
+
+  // the new graph has the replacement, and shares the untouched operations
+  CHECK(!g2.contains(ops[100]));
+  CHECK(g2.vertex_size() == 202);
+  const Graph<OpBase>::vid_t v = g2.find(replacement);
+  REQUIRE(v != Graph<OpBase>::npos);
+  CHECK(g2.op(v) == replacement);
+  CHECK(*g2.preds(v).begin() == ops[99]);
+  CHECK(*g2.succs(v).begin() == ops[101]);
+  CHECK(g2.op(g2.find(ops[0])) == ops[0]);
+  CHECK(g2.op(g2.find(ops[199])) == ops[199]);
+
+  // modifying the copy does not modify the original
+  g2.erase(ops[0].get());
+  CHECK(g2.vertex_size() == 201);
+  CHECK(graph.vertex_size() == 202);
+  CHECK(graph.succs(graph.start_id()).size() == 1);
+}
+
+TEST_CASE("[cpu]" " " "graph pointer lookups") {
+  // large enough that a linear scan per lookup would be noticeably slow
+  const int n = 10000;
+  Graph<OpBase> graph;
+  std::vector<std::shared_ptr<OpBase>> ops;
+  for (int i = 0; i < n; ++i) {
+    ops.push_back(std::make_shared<NoOp>("noop" + std::to_string(i)));
+    if (0 == i) {
+      graph.start_then(ops[i]);
+    } else {
+      graph.then(ops[i - 1], ops[i]);
+    }
+  }
+  graph.then_finish(ops.back());
+
+  size_t edges = 0;
+  for (int i = 0; i < n; ++i) {
+    edges += graph.preds(ops[i].get()).size() + graph.succs(ops[i].get()).size();
+  }
+  CHECK(edges == size_t(2 * n));
+  CHECK(*graph.preds(ops[1].get()).begin() == ops[0]);
+  CHECK(*graph.succs(ops[1].get()).begin() == ops[2]);
+
+  // an equal operation that is not the same object is not found by pointer
+  auto copy = std::make_shared<NoOp>("noop0");
+  CHECK(graph.find_ptr(copy.get()) == Graph<OpBase>::npos);
+  CHECK(graph.find(copy) == graph.find_ptr(ops[0].get()));
+
+  for (int i = 0; i < n; i += 2) {
+    graph.erase(ops[i].get());
+  }
+  CHECK(graph.vertex_size() == size_t(n / 2 + 2));
+  edges = 0;
+  for (int i = 1; i < n; i += 2) {
+    edges += graph.preds(ops[i].get()).size();
+  }
+  CHECK(edges == 0);
+  CHECK_THROWS(graph.preds(ops[0].get())); // no longer in the graph
+}
+
 #endif // TENZING_ENABLE_TESTS == 1
\ No newline at end of file
@@ -0,0 +1,254 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/happens_before.hpp"
+
+#include <algorithm>
+
+const size_t HappensBefore::host;
+
+HappensBefore::HappensBefore(const Sequence<BoundOp> &path) {
+  for (const auto &op : path) {
+    append(op);
+  }
+}
+
+void HappensBefore::merge(Clock &dst, const Clock &src) {
+  if (dst.size() < src.size()) {
+    dst.resize(src.size(), -1);
+  }
+  for (size_t i = 0; i < src.size(); ++i) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
+
+HappensBefore::Clock &HappensBefore::clock(size_t i) {
+  if (i >= clocks_.size()) {
+    clocks_.resize(i + 1);
+  }
+  return clocks_[i];
+}
+
+HappensBefore::Snapshot &HappensBefore::snapshot(const Event &event) {
+  if (event.id_ >= events_.size()) {
+    events_.resize(event.id_ + 1);
+  }
+  return events_[event.id_];
+}
+
+HappensBefore::Clock &HappensBefore::issue(Undo &u, const Stream &s, position_t p) {
+  u.timeline = timeline(s);
+  Clock &c = clock(u.timeline);
+  u.clock = c;
+  merge(c, clock(host)); // the host issued everything it knows about before this
+  if (c.size() <= u.timeline) {
+    c.resize(u.timeline + 1, -1);
+  }
+  c[u.timeline] = p;
+  return c;
+}
+
+HappensBefore::Snapshot &HappensBefore::touch(Undo &u, const Event &event) {
+  Snapshot &snap = snapshot(event);
+  u.hasEvent = true;
+  u.event = event.id_;
+  u.snapshot = snap;
+  nextEvent_ = std::max(nextEvent_, event.id_ + 1);
+  return snap;
+}
+
+HappensBefore::Undo HappensBefore::append(const std::shared_ptr<BoundOp> &op) {
+  const position_t p = size_++;
+  Undo u;
+  u.nextEvent = nextEvent_;
+
+  if (ops_.emplace(op->unbound_id(), Entry{p, op}).second) {
+    u.added = op->unbound_id();
+  }
+
+  if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(op)) {
+    issue(u, gpu->stream(), p);
+  } else if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+    const Clock &c = issue(u, cer->stream(), p);
+    Snapshot &snap = touch(u, cer->event());
+    snap.clock = c;
+    snap.record = p;
+  } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+    Snapshot &snap = touch(u, cswe->event());
+    merge(issue(u, cswe->stream(), p), snap.clock);
+  } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(op)) {
+    // record in the waitee, without changing what the waitee knows
+    Clock recorded = clock(timeline(sw->waitee()));
+    merge(recorded, clock(host));
+    if (recorded.size() <= timeline(sw->waitee())) {
+      recorded.resize(timeline(sw->waitee()) + 1, -1);
+    }
+    recorded[timeline(sw->waitee())] = p;
+    for (const Event &event : sw->get_events()) {
+      Snapshot &snap = touch(u, event);
+      snap.clock = recorded;
+      snap.record = p;
+    }
+    merge(issue(u, sw->waiter(), p), recorded);
+  } else {
+    // everything else runs on the host
+    auto ss = std::dynamic_pointer_cast<StreamSync>(op);
+    if (ss) {
+      clock(timeline(ss->stream())); // so it exists before taking a reference to the host clock
+    }
+    u.timeline = host;
+    Clock &c = clock(host);
+    u.clock = c;
+    if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(op)) {
+      merge(c, touch(u, ces->event()).clock);
+    } else if (ss) {
+      merge(c, clocks_[timeline(ss->stream())]);
+    }
+    if (c.empty()) {
+      c.resize(1, -1);
+    }
+    c[host] = p;
+  }
+  return u;
+}
+
+void HappensBefore::undo(const Undo &u) {
+  if (0 == size_) {
+    THROW_RUNTIME("nothing to undo");
+  }
+  --size_;
+  nextEvent_ = u.nextEvent;
+  clocks_[u.timeline] = u.clock;
+  if (u.hasEvent) {
+    events_[u.event] = u.snapshot;
+  }
+  if (u.added) {
+    ops_.erase(u.added);
+  }
+}
+
+std::shared_ptr<BoundOp> HappensBefore::find_unbound(const std::shared_ptr<OpBase> &op) const {
+  std::unordered_map<OpBase::id_t, Entry>::const_iterator it = ops_.find(op->unbound_id());
+  return ops_.end() == it ? nullptr : it->second.op;
+}
+
+HappensBefore::position_t HappensBefore::position(const std::shared_ptr<BoundOp> &a) const {
+  std::unordered_map<OpBase::id_t, Entry>::const_iterator it = ops_.find(a->unbound_id());
+  if (ops_.end() == it) {
+    THROW_RUNTIME("couldn't find " << a->name() << " in path");
+  }
+  return it->second.position;
+}
+
+bool HappensBefore::stream_knows(const Stream &waiter, const std::shared_ptr<BoundGpuOp> &a) const {
+  const size_t w = timeline(waiter);
+  return w < clocks_.size() && get(clocks_[w], timeline(a->stream())) >= position(a);
+}
+
+bool HappensBefore::host_knows(const std::shared_ptr<BoundGpuOp> &a) const {
+  return !clocks_.empty() && get(clocks_[host], timeline(a->stream())) >= position(a);
+}
+
+bool HappensBefore::covering_event(const std::shared_ptr<BoundGpuOp> &a, Event &event) const {
+  const position_t pa = position(a);
+  const size_t s = timeline(a->stream());
+  position_t earliest = -1;
+  for (size_t e = 0; e < events_.size(); ++e) {
+    const Snapshot &snap = events_[e];
+    if (snap.record >= 0 && get(snap.clock, s) >= pa && (earliest < 0 || snap.record < earliest)) {
+      earliest = snap.record;
+      event = Event(e);
+    }
+  }
+  return earliest >= 0;
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/test_ops.hpp"
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "happens before") {
+
+  auto a = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("a"), Stream(0));
+  auto b = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("b"), Stream(0));
+  auto start = std::make_shared<Start>();
+
+  HappensBefore hb;
+  hb.append(start);
+  hb.append(a);
+  CHECK(hb.find_unbound(a) == a);
+  CHECK(!hb.find_unbound(b));
+  CHECK(hb.stream_knows(Stream(0), a)); // in order in its own stream
+  CHECK(!hb.stream_knows(Stream(1), a));
+  CHECK(!hb.host_knows(a));
+  Event e;
+  CHECK(!hb.covering_event(a, e));
+
+  SUBCASE("record and wait") {
+    CHECK(hb.new_unique_event() == Event(0));
+    hb.append(std::make_shared<CudaEventRecord>(Event(0), Stream(0)));
+    CHECK(hb.new_unique_event() == Event(1));
+    REQUIRE(hb.covering_event(a, e));
+    CHECK(e == Event(0));
+    CHECK(!hb.stream_knows(Stream(1), a));
+    hb.append(std::make_shared<CudaStreamWaitEvent>(Stream(1), Event(0)));
+    CHECK(hb.stream_knows(Stream(1), a));
+    CHECK(!hb.host_knows(a));
+
+    // b is after the record
+    hb.append(b);
+    CHECK(!hb.stream_knows(Stream(1), b));
+    CHECK(!hb.covering_event(b, e));
+  }
+
+  SUBCASE("transitive") {
+    // a's stream -> stream 2 -> stream 1, through two events
+    hb.append(std::make_shared<CudaEventRecord>(Event(0), Stream(0)));
+    hb.append(std::make_shared<CudaStreamWaitEvent>(Stream(2), Event(0)));
+    CHECK(!hb.stream_knows(Stream(1), a));
+    hb.append(std::make_shared<CudaEventRecord>(Event(1), Stream(2)));
+    hb.append(std::make_shared<CudaStreamWaitEvent>(Stream(1), Event(1)));
+    CHECK(hb.stream_knows(Stream(1), a));
+  }
+
+  SUBCASE("host") {
+    hb.append(std::make_shared<CudaEventRecord>(Event(0), Stream(0)));
+    hb.append(std::make_shared<CudaEventSync>(Event(0)));
+    CHECK(hb.host_knows(a));
+    CHECK(!hb.stream_knows(Stream(1), a));
+
+    // streams follow what the host knew when they were issued to
+    auto c = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("c"), Stream(1));
+    hb.append(c);
+    CHECK(hb.stream_knows(Stream(1), a));
+  }
+
+  SUBCASE("stream sync") {
+    CHECK(!hb.host_knows(a));
+    hb.append(std::make_shared<StreamSync>(Stream(0)));
+    CHECK(hb.host_knows(a));
+  }
+
+  SUBCASE("undo") {
+    HappensBefore::Undo ur = hb.append(std::make_shared<CudaEventRecord>(Event(0), Stream(0)));
+    HappensBefore::Undo uw = hb.append(std::make_shared<CudaStreamWaitEvent>(Stream(1), Event(0)));
+    HappensBefore::Undo ub = hb.append(b);
+    REQUIRE(hb.stream_knows(Stream(1), a));
+    hb.undo(ub);
+    CHECK(!hb.find_unbound(b));
+    hb.undo(uw);
+    CHECK(!hb.stream_knows(Stream(1), a));
+    CHECK(hb.covering_event(a, e));
+    hb.undo(ur);
+    CHECK(!hb.covering_event(a, e));
+    CHECK(hb.new_unique_event() == Event(0));
+    CHECK(hb.size() == 2);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
@@ -7,7 +7,108 @@
 #include "tenzing/cuda/ops_cuda.hpp"
 #include "tenzing/macro_at.hpp"
 
+#include <algorithm>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+/* Interning
+
+   Every operation that has been asked for its id() belongs to exactly one Class: the live
+   operations whose values are equal. Members are linked through OpBase::prev_ / next_, so copies
+   and destruction are O(1). Classes are found by a key from the operation's type and hash(), and
+   then compared with eq_value(). A Class is freed when its last member is destroyed, so a value that
+   is created again later gets a new id.
+*/
+struct OpBase::Class {
+  OpBase::id_t id;
+  size_t key;         // where this class is in the table
+  const OpBase *head; // any member of the class
+};
+
+struct OpBase::Table {
+  std::unordered_map<size_t, std::vector<Class *>> classes;
+  OpBase::id_t nextId = 1; // 0 means "not interned"
+};
+
+OpBase::Table &OpBase::table() {
+  // never destroyed, so operations that outlive static destruction can still leave their class
+  static Table *table = new Table;
+  return *table;
+}
+
+OpBase::OpBase(const OpBase &other) : id_(0), class_(nullptr), prev_(nullptr), next_(nullptr) {
+  if (other.class_) {
+    join(other.class_);
+  }
+}
+
+OpBase &OpBase::operator=(const OpBase &other) {
+  if (class_ != other.class_) {
+    leave();
+    if (other.class_) {
+      join(other.class_);
+    }
+  }
+  return *this;
+}
+
+OpBase::~OpBase() { leave(); }
+
+void OpBase::intern() const {
+  const size_t key = hash_combine(size_t(tag()), hash());
+  std::vector<Class *> &bucket = table().classes[key];
+  for (Class *c : bucket) {
+    if (c->head->eq_value(*this)) {
+      join(c);
+      return;
+    }
+  }
+  Class *c = new Class{table().nextId++, key, nullptr};
+  bucket.push_back(c);
+  join(c);
+}
+
+void OpBase::join(Class *c) const {
+  class_ = c;
+  id_ = c->id;
+  prev_ = nullptr;
+  next_ = c->head;
+  if (c->head) {
+    c->head->prev_ = this;
+  }
+  c->head = this;
+}
+
+void OpBase::leave() const {
+  if (!class_) {
+    return;
+  }
+  if (prev_) {
+    prev_->next_ = next_;
+  } else {
+    class_->head = next_;
+  }
+  if (next_) {
+    next_->prev_ = prev_;
+  }
+
+  // last member, drop the class
+  if (!class_->head) {
+    auto it = table().classes.find(class_->key);
+    std::vector<Class *> &bucket = it->second;
+    bucket.erase(std::find(bucket.begin(), bucket.end(), class_));
+    if (bucket.empty()) {
+      table().classes.erase(it);
+    }
+    delete class_;
+  }
+
+  id_ = 0;
+  class_ = nullptr;
+  prev_ = nullptr;
+  next_ = nullptr;
+}
 
 nlohmann::json OpBase::json() const {
   nlohmann::json j;
@@ -23,14 +124,11 @@ nlohmann::json NoOp::json() const {
 }
 
 void keep_uniques(std::vector<std::shared_ptr<BoundOp>> &v) {
-  for (size_t i = 0; i < v.size(); ++i) {
-    for (size_t j = i + 1; j < v.size(); ++j) {
-      if (v[i]->eq(v[j])) {
-        v.erase(v.begin() + j);
-        --j;
-      }
-    }
-  }
+  std::unordered_set<OpBase::id_t> seen;
+  auto last = std::remove_if(v.begin(), v.end(), [&](const std::shared_ptr<BoundOp> &op) {
+    return !seen.insert(op->id()).second;
+  });
+  v.erase(last, v.end());
 }
 
 std::vector<std::shared_ptr<BoundOp>> make_platform_variations(const Platform &plat,
@@ -51,26 +149,9 @@ std::vector<std::shared_ptr<BoundOp>> make_platform_variations(const Platform &p
 // true iff unbound version of e in unbound versions of v
 bool unbound_contains(const std::vector<std::shared_ptr<BoundOp>> &v,
                       const std::shared_ptr<OpBase> &e) {
-
-  // unbound version if bound
-  std::shared_ptr<OpBase> ue;
-  if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(e)) {
-    ue = bgo->unbound();
-  } else {
-    ue = e;
-  }
-
+  const OpBase::id_t ue = e->unbound_id();
   for (const auto &ve : v) {
-
-    // get unbound version if bound
-    std::shared_ptr<OpBase> uve;
-    if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(ve)) {
-      uve = bgo->unbound();
-    } else {
-      uve = ve;
-    }
-
-    if (uve->eq(ue)) {
+    if (ve->unbound_id() == ue) {
       return true;
     }
   }
@@ -98,4 +179,39 @@ TEST_CASE("[cpu]" " " "op eq") {
   CHECK(op0->eq(op2));
   CHECK(!op1->eq(op2));
 }
+
+TEST_CASE("[cpu]" " " "op interning") {
+  std::shared_ptr<NoOp> op0 = std::make_shared<NoOp>("op0");
+  std::shared_ptr<NoOp> op1 = std::make_shared<NoOp>("op1");
+  std::shared_ptr<NoOp> op2 = std::make_shared<NoOp>("op0");
+
+  CHECK(op0->id() != 0);
+  CHECK(op0->id() == op2->id());
+  CHECK(op0->id() != op1->id());
+  CHECK(op0->lt(op1) != op1->lt(op0));
+
+  SUBCASE("clones share the id") {
+    std::shared_ptr<OpBase> c = op1->clone();
+    CHECK(c->id() == op1->id());
+    op1.reset(); // the class lives on in the clone
+    CHECK(c->eq(std::make_shared<NoOp>("op1")));
+  }
+
+  SUBCASE("same name, different types") {
+    auto start = std::make_shared<Start>();
+    auto noop = std::make_shared<NoOp>("Start");
+    CHECK(!start->eq(noop));
+  }
+
+  SUBCASE("a dropped value gets a new id") {
+    OpBase::id_t id;
+    {
+      auto tmp = std::make_shared<NoOp>("tmp");
+      id = tmp->id();
+    }
+    auto tmp = std::make_shared<NoOp>("tmp");
+    CHECK(tmp->id() != 0);
+    CHECK(tmp->id() != id);
+  }
+}
 #endif // TENZING_ENABLE_TESTS == 1
\ No newline at end of file
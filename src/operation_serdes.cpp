@@ -46,6 +46,14 @@ std::shared_ptr<BoundOp> recurse(const nlohmann::json &j, const std::shared_ptr<
       std::shared_ptr<CudaStreamWaitEvent> bop;
       from_json(j, bop);
       return bop;
+    } else if ("StreamWait" == kind) {
+      std::shared_ptr<StreamWait> bop;
+      from_json(j, bop);
+      return bop;
+    } else if ("StreamSync" == kind) {
+      std::shared_ptr<StreamSync> bop;
+      from_json(j, bop);
+      return bop;
     } else {
       THROW_RUNTIME("unexpected operation kind '" << kind << "' for operation missing from graph "
                                                   << j.dump());
@@ -57,8 +65,8 @@ std::shared_ptr<BoundOp> recurse(const nlohmann::json &j, const std::shared_ptr<
 
 std::shared_ptr<BoundOp> recurse(const nlohmann::json &j, const Graph<OpBase> &g) {
 
-  for (const auto &kv : g.succs_) {
-    auto found = recurse(j, kv.first);
+  for (Graph<OpBase>::vid_t v : g.vertices()) {
+    auto found = recurse(j, g.op(v));
     if (found) {
       return found;
     }
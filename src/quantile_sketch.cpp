@@ -0,0 +1,223 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/quantile_sketch.hpp"
+
+#include "tenzing/macro_at.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QuantileSketch::QuantileSketch(size_t k)
+    : k_(k), n_(0), min_(std::numeric_limits<double>::infinity()),
+      max_(-std::numeric_limits<double>::infinity()), sum_(0), levels_(1), odd_(false),
+      stale_(true) {
+  if (k_ < 2) {
+    THROW_RUNTIME("sketch needs k of at least 2, got " << k_);
+  }
+}
+
+size_t QuantileSketch::capacity(size_t level) const {
+  // each level down from the top gets 2/3 the room of the one above
+  const size_t depth = levels_.size() - 1 - level;
+  return std::max(size_t(2), size_t(std::ceil(k_ * std::pow(2.0 / 3.0, depth))));
+}
+
+void QuantileSketch::insert(double x) {
+  levels_[0].push_back(x);
+  ++n_;
+  min_ = std::min(min_, x);
+  max_ = std::max(max_, x);
+  sum_ += x;
+  stale_ = true;
+  if (levels_[0].size() >= capacity(0)) {
+    compress();
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+  if (other.levels_.size() > levels_.size()) {
+    levels_.resize(other.levels_.size());
+  }
+  for (size_t h = 0; h < other.levels_.size(); ++h) {
+    levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+  }
+  n_ += other.n_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  stale_ = true;
+  compress();
+}
+
+void QuantileSketch::compress() {
+  // levels_ may grow as this goes
+  for (size_t h = 0; h < levels_.size(); ++h) {
+    if (levels_[h].size() < capacity(h)) {
+      continue;
+    }
+    if (levels_.size() == h + 1) {
+      levels_.push_back(std::vector<double>());
+    }
+    std::vector<double> &level = levels_[h];
+    std::vector<double> &above = levels_[h + 1];
+    std::sort(level.begin(), level.end());
+
+    // an odd value out stays behind, so the total weight does not change
+    const size_t end = level.size() / 2 * 2;
+    for (size_t i = odd_ ? 1 : 0; i < end; i += 2) {
+      above.push_back(level[i]);
+    }
+    odd_ = !odd_;
+    level.erase(level.begin(), level.begin() + end);
+  }
+}
+
+size_t QuantileSketch::retained() const {
+  size_t ret = 0;
+  for (const std::vector<double> &level : levels_) {
+    ret += level.size();
+  }
+  return ret;
+}
+
+void QuantileSketch::update_view() const {
+  if (!stale_) {
+    return;
+  }
+  view_.clear();
+  for (size_t h = 0; h < levels_.size(); ++h) {
+    for (double x : levels_[h]) {
+      view_.push_back(std::make_pair(x, uint64_t(1) << h));
+    }
+  }
+  std::sort(view_.begin(), view_.end());
+  for (size_t i = 1; i < view_.size(); ++i) {
+    view_[i].second += view_[i - 1].second;
+  }
+  stale_ = false;
+}
+
+double QuantileSketch::quantile(double q) const {
+  if (empty()) {
+    THROW_RUNTIME("quantile of an empty sketch");
+  }
+  update_view();
+  // the first value with more than floor(q * count) values at or before it
+  const uint64_t pos = uint64_t(std::max(0.0, std::floor(q * n_)));
+  auto it = std::upper_bound(
+      view_.begin(), view_.end(), pos,
+      [](uint64_t p, const std::pair<double, uint64_t> &e) { return p < e.second; });
+  return view_.end() == it ? max_ : it->first;
+}
+
+uint64_t QuantileSketch::count_below(double x) const {
+  update_view();
+  auto it = std::lower_bound(
+      view_.begin(), view_.end(), x,
+      [](const std::pair<double, uint64_t> &e, double v) { return e.first < v; });
+  return view_.begin() == it ? 0 : (it - 1)->second;
+}
+
+std::vector<uint64_t> QuantileSketch::histogram(size_t nBins, double lo, double hi) const {
+  std::vector<uint64_t> hist(nBins, 0);
+  uint64_t below = 0;
+  for (size_t i = 0; i + 1 < nBins; ++i) {
+    const uint64_t b = count_below(lo + (hi - lo) * (i + 1) / nBins);
+    hist[i] = b - below;
+    below = b;
+  }
+  if (nBins > 0) {
+    hist[nBins - 1] = n_ - below;
+  }
+  return hist;
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include <random>
+
+TEST_CASE("[cpu]" " " "quantile sketch") {
+
+  SUBCASE("exact while small") {
+    QuantileSketch s(16);
+    std::vector<double> v;
+    for (int i = 0; i < 10; ++i) {
+      v.push_back((i * 7) % 10); // 0..9, shuffled
+      s.insert(v.back());
+    }
+    std::sort(v.begin(), v.end());
+    CHECK(s.count() == 10);
+    CHECK(s.retained() == 10);
+    CHECK(s.min() == 0);
+    CHECK(s.max() == 9);
+    CHECK(s.mean() == 4.5);
+    for (int pct : {0, 1, 10, 50, 90, 99}) {
+      CHECK(s.quantile(pct / 100.0) == v[v.size() * pct / 100]);
+    }
+    CHECK(s.quantile(1) == 9);
+    CHECK(s.count_below(0) == 0);
+    CHECK(s.count_below(4) == 4);
+    CHECK(s.count_below(100) == 10);
+
+    // bins [0,3) [3,6) [6,9]
+    CHECK(s.histogram(3, 0, 9) == std::vector<uint64_t>({3, 3, 4}));
+    // out of range values go in the end bins
+    CHECK(s.histogram(2, 2, 4) == std::vector<uint64_t>({3, 7}));
+  }
+
+  SUBCASE("bounded and accurate") {
+    const size_t k = 200;
+    QuantileSketch s(k);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> dist(0, 1);
+    const size_t n = 100000;
+    for (size_t i = 0; i < n; ++i) {
+      s.insert(dist(rng));
+    }
+    CHECK(s.count() == n);
+    CHECK(s.retained() < 4 * k);
+    for (double q : {0.01, 0.1, 0.5, 0.9, 0.99}) {
+      CHECK(s.quantile(q) == doctest::Approx(q).epsilon(0.02));
+    }
+    // each bin edge is off by about 1% of n in rank
+    std::vector<uint64_t> hist = s.histogram(10, 0, 1);
+    uint64_t total = 0;
+    for (uint64_t c : hist) {
+      CHECK(std::abs(double(c) - n / 10) < 0.02 * n);
+      total += c;
+    }
+    CHECK(total == n);
+  }
+
+  SUBCASE("merge") {
+    QuantileSketch a(50), b(50), both(50);
+    for (int i = 0; i < 1000; ++i) {
+      a.insert(i);
+      b.insert(1000 + i);
+      both.insert(i);
+      both.insert(1000 + i);
+    }
+    a.merge(b);
+    CHECK(a.count() == 2000);
+    CHECK(a.min() == 0);
+    CHECK(a.max() == 1999);
+    CHECK(a.mean() == both.mean());
+    CHECK(a.quantile(0.5) == doctest::Approx(1000).epsilon(0.05));
+    CHECK(a.count_below(1000) == doctest::Approx(1000).epsilon(0.05));
+  }
+
+  SUBCASE("empty") {
+    QuantileSketch s;
+    CHECK(s.empty());
+    CHECK_THROWS(s.quantile(0.5));
+    CHECK(s.histogram(2, 0, 1) == std::vector<uint64_t>({0, 0}));
+    CHECK_THROWS(QuantileSketch(1));
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
@@ -0,0 +1,191 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/ready_set.hpp"
+
+#include <algorithm>
+
+namespace SDP {
+
+const size_t ReadySet::NOT_READY;
+
+ReadySet::ReadySet(const Graph<OpBase> &graph, const Sequence<BoundOp> &done)
+    : remaining_(graph.id_size(), 0), done_(graph.id_size(), false),
+      pos_(graph.id_size(), NOT_READY) {
+  for (vid_t v : graph.vertices()) {
+    remaining_[v] = graph.pred_ids(v).size();
+    if (0 == remaining_[v]) {
+      push(v);
+    }
+  }
+  for (const auto &op : done) {
+    execute(graph, op);
+  }
+}
+
+ReadySet::Undo ReadySet::execute(const Graph<OpBase> &graph, const std::shared_ptr<OpBase> &op) {
+  // the sequence may have the bound version of the op in the graph
+  vid_t v = graph.find_or_find_unbound(op);
+  if (Graph<OpBase>::npos != v) {
+    return execute(graph, v);
+  }
+  return Undo{Graph<OpBase>::npos, 0};
+}
+
+ReadySet::Undo ReadySet::execute(const Graph<OpBase> &graph, vid_t v) {
+  if (v >= done_.size()) {
+    THROW_RUNTIME("vertex " << v << " is not in the tracked graph");
+  }
+  if (done_[v]) {
+    return Undo{Graph<OpBase>::npos, 0};
+  }
+  done_[v] = true;
+
+  // move the last ready vertex into v's place
+  const Undo u{v, pos_[v]};
+  if (NOT_READY != u.pos) {
+    const vid_t last = ready_.back();
+    ready_[u.pos] = last;
+    pos_[last] = u.pos;
+    ready_.pop_back();
+    pos_[v] = NOT_READY;
+  }
+
+  for (vid_t succ : graph.succ_ids(v)) {
+    if (0 == --remaining_[succ] && !done_[succ]) {
+      push(succ);
+    }
+  }
+  return u;
+}
+
+void ReadySet::undo(const Graph<OpBase> &graph, const Undo &u) {
+  if (Graph<OpBase>::npos == u.v) {
+    return;
+  }
+
+  // successors that execute() made ready were appended in order
+  const std::vector<vid_t> &succs = graph.succ_ids(u.v);
+  for (std::vector<vid_t>::const_reverse_iterator it = succs.rbegin(); it != succs.rend(); ++it) {
+    if (0 == remaining_[*it]++ && !done_[*it]) {
+      pos_[ready_.back()] = NOT_READY;
+      ready_.pop_back();
+    }
+  }
+
+  done_[u.v] = false;
+  if (NOT_READY != u.pos) {
+    // the vertex that took v's place goes back to the end
+    if (u.pos < ready_.size()) {
+      const vid_t moved = ready_[u.pos];
+      pos_[moved] = ready_.size();
+      ready_.push_back(moved);
+      ready_[u.pos] = u.v;
+      pos_[u.v] = u.pos;
+    } else {
+      push(u.v);
+    }
+  }
+}
+
+void ReadySet::push(vid_t v) {
+  pos_[v] = ready_.size();
+  ready_.push_back(v);
+}
+
+} // namespace SDP
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+TEST_CASE("[cpu]" " " "ready set") {
+  using SDP::ReadySet;
+
+  // start -> a -> c -> finish
+  //       -> b ->
+  Graph<OpBase> graph;
+  auto a = std::make_shared<NoOp>("a");
+  auto b = std::make_shared<NoOp>("b");
+  auto c = std::make_shared<NoOp>("c");
+  graph.start_then(a);
+  graph.start_then(b);
+  graph.then(a, c);
+  graph.then(b, c);
+  graph.then_finish(c);
+
+  auto start = std::dynamic_pointer_cast<BoundOp>(graph.start());
+  REQUIRE(start);
+
+  SUBCASE("initial") {
+    ReadySet rs(graph, Sequence<BoundOp>({start}));
+    REQUIRE(rs.ready().size() == 2);
+    CHECK(graph.op(rs.ready()[0]) == a);
+    CHECK(graph.op(rs.ready()[1]) == b);
+    CHECK(rs.is_done(graph.start_id()));
+    CHECK(!rs.is_done(graph.find(a)));
+  }
+
+  SUBCASE("incremental") {
+    ReadySet rs(graph, Sequence<BoundOp>({start}));
+    rs.execute(graph, a);
+    REQUIRE(rs.ready().size() == 1);
+    CHECK(graph.op(rs.ready()[0]) == b);
+    rs.execute(graph, std::make_shared<NoOp>("unrelated")); // not in the graph
+    rs.execute(graph, b);
+    REQUIRE(rs.ready().size() == 1);
+    CHECK(graph.op(rs.ready()[0]) == c);
+    rs.execute(graph, b); // executing twice has no effect
+    REQUIRE(rs.ready().size() == 1);
+    rs.execute(graph, c);
+    REQUIRE(rs.ready().size() == 1);
+    CHECK(graph.op(rs.ready()[0]) == graph.finish());
+  }
+
+  SUBCASE("matches frontier") {
+    Sequence<BoundOp> seq({start, a});
+    ReadySet rs(graph, seq);
+    std::vector<std::shared_ptr<OpBase>> frontier = graph.frontier(seq.vector());
+    REQUIRE(frontier.size() == rs.ready().size());
+    for (ReadySet::vid_t v : rs.ready()) {
+      CHECK(frontier.end() != std::find(frontier.begin(), frontier.end(), graph.op(v)));
+    }
+  }
+
+  SUBCASE("undo") {
+    ReadySet rs(graph, Sequence<BoundOp>({start}));
+    const std::vector<ReadySet::vid_t> initial = rs.ready();
+    ReadySet::Undo ua = rs.execute(graph, a);
+    const std::vector<ReadySet::vid_t> afterA = rs.ready();
+    ReadySet::Undo ub = rs.execute(graph, b);
+    REQUIRE(rs.ready().size() == 1);
+    rs.undo(graph, ub);
+    CHECK(rs.ready() == afterA);
+    CHECK(!rs.is_done(graph.find(b)));
+    rs.undo(graph, ua);
+    CHECK(rs.ready() == initial);
+
+    // b first puts it back in the middle of ready()
+    ub = rs.execute(graph, b);
+    rs.undo(graph, ub);
+    CHECK(rs.ready() == initial);
+
+    // executing twice is undone as nothing
+    ub = rs.execute(graph, b);
+    ReadySet::Undo again = rs.execute(graph, b);
+    rs.undo(graph, again);
+    rs.undo(graph, ub);
+    CHECK(rs.ready() == initial);
+  }
+
+  SUBCASE("replace keeps readiness") {
+    ReadySet rs(graph, Sequence<BoundOp>({start, a}));
+    auto d = std::make_shared<NoOp>("d");
+    graph.replace(b, d);
+    REQUIRE(rs.ready().size() == 1);
+    CHECK(graph.op(rs.ready()[0]) == d);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
@@ -0,0 +1,382 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/result_file.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char ResultFile::MAGIC[8] = {'T', 'Z', 'R', 'E', 'S', 'U', 'L', 'T'};
+const uint64_t ResultFile::VERSION;
+
+namespace {
+
+// sections start on 8-byte boundaries so the arrays can be used in place
+uint64_t align8(uint64_t n) { return (n + 7) / 8 * 8; }
+
+// whether n elements of `size` bytes at offset fit in length bytes, without overflowing
+bool in_bounds(uint64_t offset, uint64_t n, uint64_t size, uint64_t length) {
+  return offset <= length && n <= (length - offset) / size;
+}
+
+// n + 1 elements, for the arrays of starts
+bool in_bounds_plus1(uint64_t offset, uint64_t n, uint64_t size, uint64_t length) {
+  return n < std::numeric_limits<uint64_t>::max() && in_bounds(offset, n + 1, size, length);
+}
+
+std::vector<std::string> split(const std::string &line, char delim) {
+  std::vector<std::string> ret;
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, delim)) {
+    ret.push_back(field);
+  }
+  return ret;
+}
+
+bool is_index(const std::string &s) {
+  char *end;
+  std::strtoull(s.c_str(), &end, 10);
+  return !s.empty() && '\0' == *end;
+}
+
+} // namespace
+
+ResultFile::ResultFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    THROW_RUNTIME("couldn't open " << path);
+  }
+  struct stat st;
+  if (fstat(fd, &st)) {
+    close(fd);
+    THROW_RUNTIME("couldn't stat " << path);
+  }
+  length_ = st.st_size;
+  if (length_ < sizeof(Header)) {
+    close(fd);
+    THROW_RUNTIME(path << " is too short to be a result file");
+  }
+  void *p = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == p) {
+    THROW_RUNTIME("couldn't map " << path);
+  }
+  base_ = static_cast<const char *>(p);
+  header_ = reinterpret_cast<const Header *>(base_);
+
+  const Header &h = *header_;
+  // the arrays are used in place, so their sections must be aligned as they were written
+  const bool aligned = 0 == (h.columns | h.rowStart | h.cells | h.opStart) % 8;
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) || VERSION != h.version || !aligned ||
+      !in_bounds(h.columns, h.nRows, nColumns * sizeof(double), length_) ||
+      !in_bounds_plus1(h.rowStart, h.nRows, sizeof(uint64_t), length_) ||
+      !in_bounds(h.cells, h.nCells, sizeof(uint32_t), length_) ||
+      !in_bounds_plus1(h.opStart, h.nOps, sizeof(uint64_t), length_) ||
+      !in_bounds(h.dict, h.dictSize, 1, length_) || !in_bounds(h.text, h.textSize, 1, length_)) {
+    munmap(p, length_);
+    THROW_RUNTIME(path << " is not a version " << VERSION << " result file");
+  }
+  rowStart_ = reinterpret_cast<const uint64_t *>(base_ + h.rowStart);
+  cells_ = reinterpret_cast<const uint32_t *>(base_ + h.cells);
+  opStart_ = reinterpret_cast<const uint64_t *>(base_ + h.opStart);
+  dict_ = base_ + h.dict;
+
+  // every row and operation is inside its section, and every cell is an operation
+  bool ok = 0 == rowStart_[0] && rowStart_[h.nRows] == h.nCells && 0 == opStart_[0] &&
+            opStart_[h.nOps] == h.dictSize;
+  for (uint64_t i = 0; ok && i < h.nRows; ++i) {
+    ok = rowStart_[i] <= rowStart_[i + 1];
+  }
+  for (uint64_t k = 0; ok && k < h.nOps; ++k) {
+    ok = opStart_[k] <= opStart_[k + 1];
+  }
+  for (uint64_t c = 0; ok && c < h.nCells; ++c) {
+    ok = cells_[c] < h.nOps;
+  }
+  if (!ok) {
+    munmap(p, length_);
+    THROW_RUNTIME(path << " is truncated or corrupt");
+  }
+}
+
+ResultFile::~ResultFile() { munmap(const_cast<char *>(base_), length_); }
+
+bool ResultFile::is_result_file(const std::string &path) {
+  char magic[sizeof(MAGIC)];
+  std::ifstream is(path, std::ios::binary);
+  return is.read(magic, sizeof(magic)) && 0 == std::memcmp(magic, MAGIC, sizeof(MAGIC));
+}
+
+Benchmark::Result ResultFile::result(size_t i) const {
+  Benchmark::Result ret;
+  ret.pct01 = column(pct01)[i];
+  ret.pct10 = column(pct10)[i];
+  ret.pct50 = column(pct50)[i];
+  ret.pct90 = column(pct90)[i];
+  ret.pct99 = column(pct99)[i];
+  ret.stddev = column(stddev)[i];
+  return ret;
+}
+
+ResultFileWriter::ResultFileWriter(const std::string &text) : text_(text), rowStart_(1, 0) {}
+
+void ResultFileWriter::add(const Benchmark::Result &result, const std::vector<std::string> &ops) {
+  columns_[ResultFile::pct01].push_back(result.pct01);
+  columns_[ResultFile::pct10].push_back(result.pct10);
+  columns_[ResultFile::pct50].push_back(result.pct50);
+  columns_[ResultFile::pct90].push_back(result.pct90);
+  columns_[ResultFile::pct99].push_back(result.pct99);
+  columns_[ResultFile::stddev].push_back(result.stddev);
+  for (const std::string &op : ops) {
+    auto it = opIds_.find(op);
+    if (opIds_.end() == it) {
+      it = opIds_.insert(std::make_pair(op, uint32_t(ops_.size()))).first;
+      ops_.push_back(op);
+    }
+    cells_.push_back(it->second);
+  }
+  rowStart_.push_back(cells_.size());
+}
+
+void ResultFileWriter::add(const Benchmark::Result &result, const Sequence<BoundOp> &seq) {
+  std::vector<std::string> ops;
+  for (const std::shared_ptr<BoundOp> &op : seq) {
+    ops.push_back(op->json().dump());
+  }
+  add(result, ops);
+}
+
+void ResultFileWriter::write(const std::string &path) const {
+  std::vector<uint64_t> opStart(1, 0);
+  for (const std::string &op : ops_) {
+    opStart.push_back(opStart.back() + op.size());
+  }
+
+  ResultFile::Header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, ResultFile::MAGIC, sizeof(h.magic));
+  h.version = ResultFile::VERSION;
+  h.nRows = size();
+  h.nOps = ops_.size();
+  h.nCells = cells_.size();
+  h.textSize = text_.size();
+  h.dictSize = opStart.back();
+  h.columns = align8(sizeof(h));
+  h.rowStart = align8(h.columns + ResultFile::nColumns * h.nRows * sizeof(double));
+  h.cells = align8(h.rowStart + rowStart_.size() * sizeof(uint64_t));
+  h.opStart = align8(h.cells + h.nCells * sizeof(uint32_t));
+  h.dict = align8(h.opStart + opStart.size() * sizeof(uint64_t));
+  h.text = h.dict + h.dictSize;
+
+  std::ofstream os(path, std::ios::binary | std::ios::trunc);
+  auto put = [&](const void *p, size_t n) { os.write(static_cast<const char *>(p), n); };
+  auto pad = [&](uint64_t offset) {
+    while (uint64_t(os.tellp()) < offset) {
+      os.put(0);
+    }
+  };
+
+  put(&h, sizeof(h));
+  pad(h.columns);
+  for (const std::vector<double> &col : columns_) {
+    put(col.data(), col.size() * sizeof(double));
+  }
+  pad(h.rowStart);
+  put(rowStart_.data(), rowStart_.size() * sizeof(uint64_t));
+  pad(h.cells);
+  put(cells_.data(), cells_.size() * sizeof(uint32_t));
+  pad(h.opStart);
+  put(opStart.data(), opStart.size() * sizeof(uint64_t));
+  pad(h.dict);
+  for (const std::string &op : ops_) {
+    put(op.data(), op.size());
+  }
+  put(text_.data(), text_.size());
+  if (!os) {
+    THROW_RUNTIME("couldn't write " << path);
+  }
+}
+
+void csv_to_result_file(const std::string &csvPath, const std::string &path) {
+  std::ifstream is(csvPath);
+  if (!is) {
+    THROW_RUNTIME("couldn't open " << csvPath);
+  }
+
+  std::string line;
+  size_t lineNo = 0;
+  std::unique_ptr<ResultFileWriter> writer;
+  while (std::getline(is, line)) {
+    ++lineNo;
+    if (line.empty()) {
+      continue;
+    }
+    std::vector<std::string> fields = split(line, '|');
+    if (!writer) {
+      if (!is_index(fields[0])) { // e.g. the options of the search
+        writer.reset(new ResultFileWriter(line));
+        continue;
+      }
+      writer.reset(new ResultFileWriter());
+    }
+    if (fields.size() < 7 || !is_index(fields[0])) {
+      THROW_RUNTIME(csvPath << ":" << lineNo << ": expected an index and 6 result fields");
+    }
+    Benchmark::Result result;
+    result.pct01 = std::strtod(fields[1].c_str(), nullptr);
+    result.pct10 = std::strtod(fields[2].c_str(), nullptr);
+    result.pct50 = std::strtod(fields[3].c_str(), nullptr);
+    result.pct90 = std::strtod(fields[4].c_str(), nullptr);
+    result.pct99 = std::strtod(fields[5].c_str(), nullptr);
+    result.stddev = std::strtod(fields[6].c_str(), nullptr);
+    writer->add(result, std::vector<std::string>(fields.begin() + 7, fields.end()));
+  }
+  if (!writer) {
+    writer.reset(new ResultFileWriter());
+  }
+  writer->write(path);
+}
+
+void result_file_to_csv(const std::string &path, std::ostream &os) {
+  ResultFile file(path);
+  if (!file.text().empty()) {
+    os << file.text() << "\n";
+  }
+  for (size_t i = 0; i < file.size(); ++i) {
+    Benchmark::Result r = file.result(i);
+    os << i << "|" << r.pct01 << "|" << r.pct10 << "|" << r.pct50 << "|" << r.pct90 << "|"
+       << r.pct99 << "|" << r.stddev;
+    for (const uint32_t *k = file.row_begin(i); k < file.row_end(i); ++k) {
+      os << "|" << file.op(*k);
+    }
+    os << "\n";
+  }
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+TEST_CASE("[cpu]" " " "result file") {
+
+  char csvPath[] = "/tmp/tenzing-results-XXXXXX";
+  char path[] = "/tmp/tenzing-results-XXXXXX";
+  for (char *p : {csvPath, path}) {
+    int fd = mkstemp(p);
+    REQUIRE(fd >= 0);
+    close(fd);
+  }
+
+  // the way the searches write CSV
+  const std::string csv = "{\"maxSeqs\":-1}\n"
+                          "0|1|2|3|4|5|0.5|{\"name\":\"a\"}|{\"name\":\"b\"}\n"
+                          "1|1e-05|2e-05|3e-05|4e-05|5e-05|6e-06|{\"name\":\"b\"}\n"
+                          "2|6|7|8|9|10|1|{\"name\":\"a\"}|{\"name\":\"c\"}|{\"name\":\"b\"}\n";
+  {
+    std::ofstream os(csvPath);
+    os << csv;
+  }
+
+  csv_to_result_file(csvPath, path);
+  REQUIRE(ResultFile::is_result_file(path));
+  CHECK(!ResultFile::is_result_file(csvPath));
+
+  {
+    ResultFile file(path);
+    CHECK(file.text() == "{\"maxSeqs\":-1}");
+    REQUIRE(file.size() == 3);
+    REQUIRE(file.num_ops() == 3); // each operation is stored once
+    CHECK(file.column(ResultFile::pct50)[2] == 8);
+    CHECK(file.result(1).pct01 == 1e-5);
+    CHECK(file.result(0).stddev == 0.5);
+    REQUIRE(file.row_end(2) - file.row_begin(2) == 3);
+    CHECK(file.op(file.row_begin(2)[0]) == "{\"name\":\"a\"}");
+    CHECK(file.op(file.row_begin(2)[1]) == "{\"name\":\"c\"}");
+    CHECK(file.row_begin(1)[0] == file.row_begin(0)[1]);
+  }
+
+  // and back to the same CSV
+  std::stringstream ss;
+  result_file_to_csv(path, ss);
+  CHECK(ss.str() == csv);
+
+  SUBCASE("no header") {
+    {
+      std::ofstream os(csvPath);
+      os << "0|1|2|3|4|5|6\n";
+    }
+    csv_to_result_file(csvPath, path);
+    ResultFile file(path);
+    CHECK(file.text().empty());
+    REQUIRE(file.size() == 1);
+    CHECK(file.row_begin(0) == file.row_end(0));
+  }
+
+  SUBCASE("corrupt") {
+    std::string bytes;
+    {
+      std::ifstream is(path, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }
+    ResultFile::Header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    auto rewrite = [&](uint64_t offset, const void *p, size_t n) {
+      std::string b = bytes;
+      b.replace(offset, n, static_cast<const char *>(p), n);
+      std::ofstream os(path, std::ios::binary | std::ios::trunc);
+      os << b;
+    };
+
+    // a cell that is not an operation
+    const uint32_t badCell = h.nOps;
+    rewrite(h.cells, &badCell, sizeof(badCell));
+    CHECK_THROWS(ResultFile(path));
+
+    // a row that ends before it starts
+    const uint64_t badStart = h.nCells + 1;
+    rewrite(h.rowStart + sizeof(uint64_t), &badStart, sizeof(badStart));
+    CHECK_THROWS(ResultFile(path));
+
+    // sizes whose products overflow
+    const uint64_t manyCells = uint64_t(1) << 62; // * sizeof(uint32_t) wraps to 0
+    rewrite(offsetof(ResultFile::Header, nCells), &manyCells, sizeof(manyCells));
+    CHECK_THROWS(ResultFile(path));
+    const uint64_t manyRows = std::numeric_limits<uint64_t>::max(); // + 1 wraps to 0
+    rewrite(offsetof(ResultFile::Header, nRows), &manyRows, sizeof(manyRows));
+    CHECK_THROWS(ResultFile(path));
+
+    // a section that can't be used in place
+    const uint64_t misaligned = h.columns + 4;
+    rewrite(offsetof(ResultFile::Header, columns), &misaligned, sizeof(misaligned));
+    CHECK_THROWS(ResultFile(path));
+
+    rewrite(0, bytes.data(), 0);
+    CHECK(ResultFile(path).size() == 3);
+  }
+
+  SUBCASE("bad input") {
+    {
+      std::ofstream os(csvPath);
+      os << "0|1|2\n";
+    }
+    CHECK_THROWS(csv_to_result_file(csvPath, path));
+    CHECK_THROWS(ResultFile(csvPath));
+  }
+
+  std::remove(csvPath);
+  std::remove(path);
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
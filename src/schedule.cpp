@@ -11,302 +11,266 @@
 #include "tenzing/randomness.hpp"
 
 #include <algorithm>
+#include <map>
+#include <set>
 #include <typeinfo>
 #include <typeindex>
 #include <numeric>
 
 
-int Schedule::remove_redundant_syncs(Sequence<BoundOp> &order) {
-    using op_t = std::shared_ptr<BoundOp>;
+namespace {
 
-    int removed = 0;
+/* the operations of a sequence, and which of them have been removed
+*/
+class SyncRemoval {
+public:
+    using op_t = std::shared_ptr<BoundOp>;
 
-    auto is_css = [](const op_t &op) -> bool {
-        return bool(std::dynamic_pointer_cast<StreamSync>(op));
-    };
-    auto is_cer = [](const op_t &op) -> bool {
-        return bool(std::dynamic_pointer_cast<CudaEventRecord>(op));
-    };
+    explicit SyncRemoval(const Sequence<BoundOp> &order)
+        : ops_(order.begin(), order.end()), removed_(ops_.size(), false) {
+        for (size_t i = 0; i < ops_.size(); ++i) {
+            if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(ops_[i])) {
+                cess_[ces->event()].push_back(i);
+            }
+        }
+    }
 
+    size_t size() const { return ops_.size(); }
+    bool removed(size_t i) const { return removed_[i]; }
+    const op_t &op(size_t i) const { return ops_[i]; }
 
-    auto find = [&](const op_t &op) -> Sequence<BoundOp>::iterator {
-        auto it = order.begin();
-        for (; it < order.end(); ++it) {
-            if (*it == op) return it;
-        }
-        return it;
-    };
+    void remove(size_t i) {
+        STDERR("remove " << ops_[i]->desc());
+        removed_[i] = true;
+        ++n_;
+    }
 
-    // true if two CER represent the same point in the same stream
-    auto same_stream_state = [&](
-        const std::shared_ptr<CudaEventRecord> &a,
-        const std::shared_ptr<CudaEventRecord> &b) -> bool {
+    int num_removed() const { return n_; }
 
-        if (a->stream() != b->stream()) {
-            return false;
+    /* position of the last remaining cudaEventSync of `event` after position `after`,
+       or size() if there is none
+    */
+    size_t last_ces(const Event &event, size_t after) {
+        std::map<Event, std::vector<size_t>>::iterator it = cess_.find(event);
+        if (cess_.end() == it) {
+            return size();
+        }
+        // removed syncs are never needed again
+        std::vector<size_t> &cess = it->second;
+        while (!cess.empty() && removed_[cess.back()]) {
+            cess.pop_back();
         }
+        if (cess.empty() || cess.back() <= after) {
+            return size();
+        }
+        return cess.back();
+    }
 
-        auto ai = find(a);
-        auto bi = find(b);
-        for (auto it = ai; it < bi; ++it) {
-            if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(*it)) {
-                return false;
+    Sequence<BoundOp> remaining() const {
+        Sequence<BoundOp> ret;
+        for (size_t i = 0; i < ops_.size(); ++i) {
+            if (!removed_[i]) {
+                ret.push_back(ops_[i]);
             }
         }
-        return true;
-    };
-
-    
-    // restart after any successful change
-    bool changed = true;
-enter_changed_loop:
-    while (changed) {
-        changed = false;
-
-
-        // remove any CER that is never CSWE or CES
-        for (auto first = order.begin(); first < order.end(); ++first) {
-            if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(*first)) {
-
-                bool erase = true; // assume this event should be erased
+        return ret;
+    }
 
-                // cancel erase if a later sync uses the event
-                for (auto second = first+1; second < order.end(); ++second) {
-                    if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(*second)) {
-                        if (cer->event() == ces->event()) {
-                            erase = false;
-                        }
-                    }
-                    if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(*second)) {
-                        if (cer->event() == cswe->event()) {
-                            erase = false;
-                        }
-                    }
-                }
+private:
+    std::vector<op_t> ops_;
+    std::vector<bool> removed_;
+    std::map<Event, std::vector<size_t>> cess_; // positions of the cudaEventSyncs of each event
+    int n_ = 0;
+};
 
-                if (erase) {
-                    ++removed;
-                    order.erase(first);
-                    changed = true;
-                    goto enter_changed_loop;
-                }
+/* remove any CSWE or StreamWait where there is no GPU operation following in the waiting stream
+   CER is cleaned up separately
+*/
+void remove_unused_waits(SyncRemoval &sr) {
+    std::set<Stream> used; // streams with a GPU operation later in the sequence
+    for (size_t i = sr.size(); i-- > 0;) {
+        if (sr.removed(i)) {
+            continue;
+        }
+        if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(sr.op(i))) {
+            used.insert(bgo->stream());
+        } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(sr.op(i))) {
+            if (0 == used.count(cswe->stream())) {
+                sr.remove(i);
+            }
+        } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(sr.op(i))) {
+            if (0 == used.count(sw->waiter())) {
+                sr.remove(i);
+            } else {
+                // later work in the waiter also waits for earlier waits in the waitee
+                used.insert(sw->waitee());
             }
         }
+    }
+}
 
-        // remove any CSWE where there is no GPU operation following in the stream
-        // CER is cleaned up separately
-        for (auto cswei = order.begin(); cswei < order.end(); ++cswei) {
-            if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(*cswei)) {
-                // search for following GPU op in synchronized stream
-                bool found = false;
-                for (auto second = cswei+1; second < order.end(); ++second) {
-                    if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(*second)) {
-                        if (bgo->stream() == cswe->stream()) {
-                            found = true;
-                            break;
-                        }
-                    }
-                }
-                if (!found) {
-                    order.erase(cswei);
-                    changed = true;
-                    ++removed;
-                    goto enter_changed_loop;
-                }
+/* remove the first of any two CSS in the same stream if they represent the same state
+   remove the first to sync as late as possible
+*/
+void remove_repeated_stream_syncs(SyncRemoval &sr) {
+    size_t prev = sr.size(); // the previous remaining stream sync
+    bool gpuOpBetween = false;
+    for (size_t i = 0; i < sr.size(); ++i) {
+        if (sr.removed(i)) {
+            continue;
+        }
+        if (std::dynamic_pointer_cast<BoundGpuOp>(sr.op(i))) {
+            gpuOpBetween = true;
+        } else if (auto ss = std::dynamic_pointer_cast<StreamSync>(sr.op(i))) {
+            // if they don't sync the same stream, this might be a way of synchronizing two streams
+            if (prev < sr.size() && !gpuOpBetween &&
+                std::static_pointer_cast<StreamSync>(sr.op(prev))->stream() == ss->stream()) {
+                sr.remove(prev);
             }
+            prev = i;
+            gpuOpBetween = false;
         }
+    }
+}
 
-        // remove the first of any two CSS in the same stream if they represent the same state
-        // remove the first to sync as late as possible
-        for (auto first = order.begin(); first != order.end(); ++first) {
-            if (is_css(*first)) {
-
-                // find next ss
-                auto second = first+1;
-                for (; second != order.end(); ++second) {
-                    if (is_css(*second)) {
-                        break;
-                    }
-                }
-
-                // no next stream sync
-                if (order.end() == second) {
-                    break;
-                }
-
-
-                // two stream syncs, first and second
-                auto ss1 = std::dynamic_pointer_cast<StreamSync>(*first);
-                auto ss2 = std::dynamic_pointer_cast<StreamSync>(*second);
-                if (!ss1 || !ss2) THROW_RUNTIME("");
-
-                // synchronize the same stream
-                // if they don't, this might be a way of synchronizing two streams, so leave it in
-                if (ss1->stream() == ss2->stream()) {
-
-                    // look for any GPU operations between them
-                    bool gpuOpBetween = false;
-                    for (auto it = first+1; it < second; ++it) {
-                        if (auto gpu = std::dynamic_pointer_cast<BoundGpuOp>(*it)) {
-                            gpuOpBetween = true;
-                            break;
-                        }
-                    }
-
-                    if (!gpuOpBetween) {
-                        changed = true;
-                        ++removed;
-                        order.erase(first);
-                        goto enter_changed_loop;
-                    }
-                }
+/* remove any CER that is never CSWE or CES
+*/
+void remove_unused_records(SyncRemoval &sr) {
+    std::set<Event> used; // events waited for or synced later in the sequence
+    for (size_t i = sr.size(); i-- > 0;) {
+        if (sr.removed(i)) {
+            continue;
+        }
+        if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(sr.op(i))) {
+            used.insert(ces->event());
+        } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(sr.op(i))) {
+            used.insert(cswe->event());
+        } else if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(sr.op(i))) {
+            if (0 == used.count(cer->event())) {
+                sr.remove(i);
             }
         }
+    }
+}
 
-
-
-
-
-
-        /* Search for two CERs that represent the same point in a stream
-        remove the first one, and its corresponding CES to delay the sync as late as possible
-        */
-        for (auto first = order.begin(); first != order.end(); ++first) {
-            if (is_cer(*first)) {
-
-                // find next ss
-                auto second = first+1;
-                for (; second != order.end(); ++second) {
-                    if (is_cer(*second)) {
-                        break;
-                    }
-                }
-
-                // no next cudaEventRecord
-                if (order.end() == second) {
-                    break;
-                }
-
-
-                // two event records, first and second
-                auto cer1 = std::dynamic_pointer_cast<CudaEventRecord>(*first);
-                auto cer2 = std::dynamic_pointer_cast<CudaEventRecord>(*second);
-                if (!cer1 || !cer2) THROW_RUNTIME("");
-
-                // represent the same point in the execution
-                if (same_stream_state(cer1, cer2)) {
-
-                    // find the cudaEventSync which uses each event
-                    auto ces1 = order.end();
-                    auto ces2 = order.end();
-
-                    // start search at first since sync 1 may come before record2
-                    for (auto needle = first+1; needle != order.end(); ++needle) {
-                        auto ces = std::dynamic_pointer_cast<CudaEventSync>(*needle);
-                        if (ces) {
-                            // found CER2's sync
-                            if (ces->event() == cer1->event()) {
-                                ces1 = needle;
-                            } else if (ces->event() == cer2->event()) {
-                                ces2 = needle;
-                            }
-                        }
-                    }
-                    if (ces1 == order.end() || ces2 == order.end()) {
-                        THROW_RUNTIME("couldn't find cudaEventSync for cudaEventRecord");
-                    }
-
-                    // remove the event that's synced first
+/* Search for two consecutive CERs that represent the same point in a stream
+   remove the one whose CES is later, and that CES, to delay the sync as late as possible
+*/
+void remove_same_state_records(SyncRemoval &sr) {
+    size_t prev = sr.size(); // the previous remaining event record
+    bool gpuOpBetween = false;
+    for (size_t i = 0; i < sr.size(); ++i) {
+        if (sr.removed(i)) {
+            continue;
+        }
+        if (std::dynamic_pointer_cast<BoundGpuOp>(sr.op(i))) {
+            gpuOpBetween = true;
+            continue;
+        }
+        auto cer2 = std::dynamic_pointer_cast<CudaEventRecord>(sr.op(i));
+        if (!cer2) {
+            continue;
+        }
+        if (prev < sr.size() && !gpuOpBetween) {
+            auto cer1 = std::static_pointer_cast<CudaEventRecord>(sr.op(prev));
+            if (cer1->stream() == cer2->stream()) {
+                // either may be synced before cer2, since sync 1 may come before record 2
+                const size_t ces1 = sr.last_ces(cer1->event(), prev);
+                const size_t ces2 = sr.last_ces(cer2->event(), prev);
+                if (ces1 < sr.size() && ces2 < sr.size()) {
                     if (ces2 < ces1) {
-                        order.erase(ces1);
-                        order.erase(first);
-                        changed = true;
-                        removed += 2;
-                        goto enter_changed_loop;
+                        sr.remove(ces1);
+                        sr.remove(prev);
                     } else if (ces1 < ces2) {
-                        order.erase(ces2);
-                        order.erase(second);
-                        changed = true;
-                        removed += 2;
-                        goto enter_changed_loop;
+                        // cer1 is still the previous record, and nothing is between it and the next
+                        sr.remove(ces2);
+                        sr.remove(i);
+                        continue;
                     }
                 }
             }
         }
+        prev = i;
+        gpuOpBetween = false;
+    }
+}
 
-        /* search for two event records (1, then 2) in the same stream
-
-            if the first event is synced after the second is synced,
-            it is guaranteed to have happened at the second sync
-            and the first record/sync is not needed
+/* search for two consecutive event records (1, then 2) in the same stream
 
-            FIXME: This could be extended to CudaStreamWaitEvent, so long as the
-            two streams that are waiting are the same, just like how
-            CudaEventSyncs both sync the CPU
-        */
-        for (auto first = order.begin(); first != order.end(); ++first) {
-            if (is_cer(*first)) {
+    if the first event is synced after the second is synced,
+    it is guaranteed to have happened at the second sync
+    and the first record/sync is not needed
 
-                // find next cer
-                auto second = first+1;
-                for (; second != order.end(); ++second) {
-                    if (is_cer(*second)) {
-                        break;
-                    }
-                }
-                // no next cudaEventRecord
-                if (order.end() == second) {
-                    break;
-                }
-
-                // two event records, first and second
-                auto cer1 = std::dynamic_pointer_cast<CudaEventRecord>(*first);
-                auto cer2 = std::dynamic_pointer_cast<CudaEventRecord>(*second);
-                if (!cer1 || !cer2) THROW_RUNTIME("");
+    FIXME: This could be extended to CudaStreamWaitEvent, so long as the
+    two streams that are waiting are the same, just like how
+    CudaEventSyncs both sync the CPU
+*/
+void remove_covered_records(SyncRemoval &sr) {
+    // remaining event records. Removing the last one makes the one before it consecutive with
+    // the next record
+    std::vector<size_t> records;
+    for (size_t i = 0; i < sr.size(); ++i) {
+        if (sr.removed(i)) {
+            continue;
+        }
+        auto cer2 = std::dynamic_pointer_cast<CudaEventRecord>(sr.op(i));
+        if (!cer2) {
+            continue;
+        }
+        while (!records.empty()) {
+            const size_t prev = records.back();
+            auto cer1 = std::static_pointer_cast<CudaEventRecord>(sr.op(prev));
+            if (cer1->stream() != cer2->stream()) {
+                break;
+            }
+            // there may not be a CudaEventSync (e.g., CudaStreamWaitEvent instead)
+            const size_t ces1 = sr.last_ces(cer1->event(), prev);
+            const size_t ces2 = sr.last_ces(cer2->event(), prev);
+            if (ces1 == sr.size() || ces2 == sr.size() || !(ces2 < ces1)) {
+                break;
+            }
+            // sync for event 2 is first, remove first event & sync
+            sr.remove(ces1);
+            sr.remove(prev);
+            records.pop_back();
+        }
+        records.push_back(i);
+    }
+}
 
-                // record the same stream
-                if (cer1->stream() == cer2->stream()) {
+} // namespace
 
+/* Each rule is a single pass over the sequence. Later rules only run once earlier ones have
+   nothing left to remove, so rules are applied in the same priority as one at a time.
+   Removing a CER and its CES only gives an earlier rule more to do if another CER records the
+   same event, so this usually takes one round.
 
-                    // find ces1 and ces2
-                    auto ces1 = order.end();
-                    auto ces2 = order.end();
+   A StreamWait records and waits for its own event, so only remove_unused_waits applies to it.
+   The record rules assume each event is recorded once, as the synchronizers generate. If an
+   event is recorded more than once, which record a sync is matched with can differ from the
+   rule-at-a-time algorithm these replaced.
+*/
+int Schedule::remove_redundant_syncs(Sequence<BoundOp> &order) {
 
-                    // start search at first cer since ces1 may come before cer2
-                    for (auto needle = first+1; needle != order.end(); ++needle) {
-                        auto ces = std::dynamic_pointer_cast<CudaEventSync>(*needle);
-                        if (ces) {
-                            if (ces->event() == cer1->event()) {
-                                ces1 = needle;
-                            } else if (ces->event() == cer2->event()) {
-                                ces2 = needle;
-                            }
-                        }
-                    }
+    SyncRemoval sr(order);
 
-                    // there may not be a CudaEventSync (e.g., CudaStreamWaitEvent instead)
-                    // search for the next part of CER
-                    if (order.end() == ces1 || order.end() == ces2) {
-                        continue;
-                    }
+    int before;
+    do {
+        // these only make more for each other in this order
+        remove_unused_waits(sr);
+        remove_repeated_stream_syncs(sr);
+        remove_unused_records(sr);
 
-                    // sync for event 2 is first, remove first event & sync
-                    if (ces2 < ces1) {
-                        // remove last one first to not invalidate iterator
-                        STDERR("remove " << (*ces1)->desc());
-                        order.erase(ces1);
-                        STDERR("remove " << (*first)->desc());
-                        order.erase(first);
-                        changed = true;
-                        removed += 2;
-                        goto enter_changed_loop;
-                    }
-                }
-            }
+        before = sr.num_removed();
+        remove_same_state_records(sr);
+        if (sr.num_removed() == before) {
+            remove_covered_records(sr);
         }
-    } // changed loop
-
+    } while (sr.num_removed() != before);
 
+    if (sr.num_removed() > 0) {
+        order = sr.remaining();
+    }
 
     {
         std::string s;
@@ -317,7 +281,7 @@ enter_changed_loop:
         STDERR("remove_redundant_syncs result is: " << s);
     }
 
-    return removed;
+    return sr.num_removed();
 }
 
 int Schedule::remove_redundant_syncs() {
@@ -359,7 +323,7 @@ std::vector<Schedule> make_schedules(Graph<BoundOp> &g)
 
                     // check if nextOp's preds are all done
                     bool allDone = true;
-                    for (std::shared_ptr<BoundOp> check : g.preds_[nextOp])
+                    for (std::shared_ptr<BoundOp> check : g.preds(g.find(nextOp)))
                     {
                         if (curr.order.end() == std::find(curr.order.begin(), curr.order.end(), check))
                         {
@@ -374,7 +338,7 @@ std::vector<Schedule> make_schedules(Graph<BoundOp> &g)
                         Schedule next = curr;
                         next.remaining.erase(nextOp);
                         next.order.push_back(nextOp);
-                        for (const std::shared_ptr<BoundOp> &succ : g.succs_[nextOp])
+                        for (const std::shared_ptr<BoundOp> &succ : g.succs(g.find(nextOp)))
                         {
                             next.remaining.insert(succ);
                         }
@@ -402,9 +366,9 @@ std::vector<Schedule> make_schedules_random(Graph<BoundOp> &g, size_t n)
     {
         op_t end;
         // find end node and set to 1
-        for (auto &node : g.succs_) {
-            if (node.first->name() == "end") {
-                end = node.first;
+        for (auto u : g.vertices()) {
+            if (g.op(u)->name() == "end") {
+                end = g.op(u);
             }
         }
         pathsToEnd[end] = 1;
@@ -414,18 +378,18 @@ std::vector<Schedule> make_schedules_random(Graph<BoundOp> &g, size_t n)
         while(changed) {
             changed = false;
 
-            for (auto &kv : g.succs_) {
-                if (end == kv.first) {
+            for (auto u : g.vertices()) {
+                if (end == g.op(u)) {
                     continue; // don't update end
                 }
-                auto it = pathsToEnd.insert(std::make_pair(kv.first, 0));
+                auto it = pathsToEnd.insert(std::make_pair(g.op(u), 0));
                 int curVal = it.first->second;
                 int newVal = 0;
-                for (auto &succ : kv.second) {
+                for (auto &succ : g.succs(u)) {
                     auto it2 = pathsToEnd.insert(std::make_pair(succ, 0));
                     newVal += it2.first->second;
                 }
-                pathsToEnd[kv.first] = newVal;
+                pathsToEnd[g.op(u)] = newVal;
                 if (curVal != newVal) {
                     changed = true;
                 }
@@ -488,7 +452,7 @@ std::vector<Schedule> make_schedules_random(Graph<BoundOp> &g, size_t n)
             // std::cerr << "selected " << selected->name() << "\n";
 
             // all the selected node's successors who have all their preds visited and are not themselves visited to the frontier
-            for (auto &succ : g.succs_.at(selected)) {
+            for (auto &succ : g.succs(g.find(selected))) {
 
                 // try next if succ already visited
                 {
@@ -501,7 +465,7 @@ std::vector<Schedule> make_schedules_random(Graph<BoundOp> &g, size_t n)
 
                 // if a successors's pred has not already been visited, skip it
                 bool allPredsVisited = true;
-                for (auto &succPred : g.preds_.at(succ)) {
+                for (auto &succPred : g.preds(g.find(succ))) {
                     auto it = std::find(sched.order.begin(), sched.order.end(), succPred);
                     if (it == sched.order.end()) {
                         // std::cerr << succ->name() << " has unvisited pred (" << succPred->name()<< ")\n";
@@ -659,3 +623,210 @@ bool Schedule::by_op_typeid(const Schedule &a, const Schedule &b) {
 
 
 
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/test_ops.hpp"
+
+#include <sstream>
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "remove redundant syncs") {
+
+    auto k = [](const std::string &name, Stream::id_t s) {
+        return std::make_shared<BoundGpuOp>(std::make_shared<Kernel>(name), Stream(s));
+    };
+    auto cer = [](Event::id_t e, Stream::id_t s) {
+        return std::make_shared<CudaEventRecord>(Event(e), Stream(s));
+    };
+    auto cswe = [](Stream::id_t s, Event::id_t e) {
+        return std::make_shared<CudaStreamWaitEvent>(Stream(s), Event(e));
+    };
+    auto ces = [](Event::id_t e) { return std::make_shared<CudaEventSync>(Event(e)); };
+    auto ss = [](Stream::id_t s) { return std::make_shared<StreamSync>(Stream(s)); };
+
+    auto a = k("a", 0);
+    auto b = k("b", 1);
+    auto c = std::make_shared<NoOp>("c");
+
+    SUBCASE("nothing to remove") {
+        Sequence<BoundOp> seq({a, cer(0, 0), cswe(1, 0), b, cer(1, 1), ces(1), c});
+        const Sequence<BoundOp> orig = seq;
+        CHECK(0 == Schedule::remove_redundant_syncs(seq));
+        CHECK(seq.vector() == orig.vector());
+    }
+
+    SUBCASE("unused record and wait") {
+        // the wait has no later GPU operation in stream 1, so the record is unused too
+        Sequence<BoundOp> seq({a, cer(0, 0), cswe(1, 0), c});
+        CHECK(2 == Schedule::remove_redundant_syncs(seq));
+        CHECK(seq.vector() == std::vector<std::shared_ptr<BoundOp>>({a, c}));
+    }
+
+    SUBCASE("repeated stream sync") {
+        auto ss1 = ss(0);
+        auto ss2 = ss(0);
+        Sequence<BoundOp> seq({a, ss1, c, ss2, k("d", 0), ss(0)});
+        CHECK(1 == Schedule::remove_redundant_syncs(seq));
+        REQUIRE(seq.size() == 5);
+        CHECK(seq[1] == c); // the earlier of the two is removed
+        CHECK(seq[2] == ss2);
+    }
+
+    SUBCASE("records of the same state") {
+        // the second record is synced first, so the first record and its sync are not needed
+        auto cer2 = cer(1, 0);
+        auto ces2 = ces(1);
+        Sequence<BoundOp> seq({a, cer(0, 0), cer2, ces2, ces(0), c});
+        CHECK(2 == Schedule::remove_redundant_syncs(seq));
+        CHECK(seq.vector() == std::vector<std::shared_ptr<BoundOp>>({a, cer2, ces2, c}));
+    }
+
+    SUBCASE("covered record") {
+        // a is complete when the later record of stream 0 is synced
+        auto cer2 = cer(1, 0);
+        auto ces2 = ces(1);
+        auto d = k("d", 0);
+        Sequence<BoundOp> seq({a, cer(0, 0), d, cer2, ces2, ces(0), c});
+        CHECK(2 == Schedule::remove_redundant_syncs(seq));
+        CHECK(seq.vector() == std::vector<std::shared_ptr<BoundOp>>({a, d, cer2, ces2, c}));
+    }
+
+    SUBCASE("chain of covered records") {
+        auto cer3 = cer(2, 0);
+        auto ces3 = ces(2);
+        Sequence<BoundOp> seq(
+            {a, cer(0, 0), k("d", 0), cer(1, 0), k("e", 0), cer3, ces3, ces(0), ces(1), c});
+        CHECK(4 == Schedule::remove_redundant_syncs(seq));
+        REQUIRE(seq.size() == 6);
+        CHECK(seq[3] == cer3);
+        CHECK(seq[4] == ces3);
+    }
+
+    SUBCASE("stream waits") {
+        // nothing runs in stream 1 after the first wait, so it is not needed
+        auto sw1 = std::make_shared<StreamWait>(Stream(0), Stream(1), Event(0));
+        auto sw2 = std::make_shared<StreamWait>(Stream(0), Stream(1), Event(1));
+        Sequence<BoundOp> seq({a, sw1, c});
+        CHECK(1 == Schedule::remove_redundant_syncs(seq));
+        CHECK(seq.vector() == std::vector<std::shared_ptr<BoundOp>>({a, c}));
+
+        // b waits for stream 0 through the second wait, which waits for stream 2
+        auto cswe2 = cswe(0, 2);
+        seq = Sequence<BoundOp>({cer(2, 2), cswe2, sw2, b});
+        CHECK(0 == Schedule::remove_redundant_syncs(seq));
+    }
+}
+
+/* Sequences and what the algorithm this replaced (one rule application at a time, restarting
+   from the front after each) left of them. Each token is one operation:
+   k<stream> a GPU operation, r<event><stream> a CudaEventRecord, w<stream><event> a
+   CudaStreamWaitEvent, c<event> a CudaEventSync, s<stream> a StreamSync.
+
+   The sequences are random, with each event recorded once and waited for or synced only after it
+   is recorded, as the synchronizers generate them.
+*/
+TEST_CASE("[cpu]" " " "remove redundant syncs matches recorded results") {
+    const char *cases[][2] = {
+      {"k1 r01 r11 r20 c0 r31 k0 s0 c0 r40 r51 w11",
+       "k1 r01 c0 k0 s0 c0"},
+      {"s0 r01 r10 r20 k0 r31",
+       "s0 k0"},
+      {"k1 k1 s0 k1 k1 s1 k1",
+       "k1 k1 s0 k1 k1 s1 k1"},
+      {"r00 w00 r11 r20 r31 r40 r50 c4 w04 w11 w01 r61 r70",
+       "r40 c4"},
+      {"r00 w00 r11 w11",
+       ""},
+      {"r00 w00 k0 r11 w00 k1 r21 r30 c1 r41",
+       "r00 w00 k0 r11 k1 c1"},
+      {"r00 c0 k1 r11 k0 k0 r21",
+       "r00 c0 k1 k0 k0"},
+      {"s1 r00 r10 w10 s1 r21 w01 r31 r41 w00 w11 r50 c4 c4",
+       "s1 r41 c4 c4"},
+      {"k1 r01 k0 k1 s0 k1",
+       "k1 k0 k1 s0 k1"},
+      {"k0 r01 w10 s1 c0 k0 w10 w00 r11",
+       "k0 r01 s1 c0 k0"},
+      {"s0 r00 c0 k1 k1 c0 r11 r21 r30",
+       "s0 r00 c0 k1 k1 c0"},
+      {"k1 k1 k0 s0 s1 k1 s0 s1 s1",
+       "k1 k1 k0 s0 s1 k1 s0 s1"},
+      {"s1 r00 s1 k0 w10 k1 s1 k1 k1 r10 k1 r20 r30",
+       "r00 s1 k0 w10 k1 s1 k1 k1 k1"},
+      {"k0 s0 r01 s0 k1 k0 w00 r10 r20",
+       "k0 s0 k1 k0"},
+      {"r01 r10 r21 s0 c2 s0 s0 c0 w01 k0 r30 k1 k1",
+       "r01 r10 r21 c2 s0 c0 w01 k0 k1 k1"},
+      {"r00 s1 r10 k0 r20 c2 k1 k0 r31 c1 w00 k1 r40",
+       "s1 k0 r20 c2 k1 k0 k1"},
+      {"k1 s0 r00 s0 w00 r10",
+       "k1 s0"},
+      {"k1 r00 r11 c0 k1 c1",
+       "k1 r00 r11 c0 k1 c1"},
+      {"r00 r11 r21 r30 s0 s1 k0 c2 k1 c1 w12 s0 w01 w12",
+       "r21 s0 s1 k0 c2 k1 s0"},
+      {"k1 k0 s0 k1 k1 k1",
+       "k1 k0 s0 k1 k1 k1"},
+      {"k0 r01 c0 r11 r21 r31 c3 r40 k0",
+       "k0 r01 c0 k0"},
+      {"r00 r10 r21 c0 s0 k0 w01 c1",
+       "r00 c0 s0 k0"},
+      {"r01 r11 w11 k0 k0 k1 c1 r20 w00 w11 k0 w00 k1 k1 c0 r30",
+       "r11 w11 k0 k0 k1 c1 w00 w11 k0 k1 k1"},
+      {"r00 w00 w00 c0 r10 s0 r20 k0 c2 r31 w11 s1",
+       "r00 w00 w00 c0 s0 k0 s1"},
+      {"r01 r11 c1 k1 s1 s1 k0 s0 c0 w01 r21 r31 k0 c1",
+       "r01 c1 k1 s1 k0 s0 c0 w01 k0"},
+      {"s1 k1 r00 r11 c1 w11 s0 s1 r21 c2 s0 c2 c1 r30 s0",
+       "s1 k1 c1 s0 s1 r21 c2 c2 s0"},
+      {"s0 r00 r10 k1 k1 c1 k0 c0",
+       "s0 r10 k1 k1 c1 k0"},
+      {"k0 s0 k0 s0 r00 c0 r10 k0 r20 s0 c2 c0",
+       "k0 s0 k0 s0 c0 k0 r20 s0 c2"},
+      {"r00 w10 w00 k1 r10 r20 k1 k0 s0 k1 s1 r30 c1 c2 k1 k1",
+       "r00 w10 w00 k1 r10 k1 k0 s0 k1 s1 c1 k1 k1"},
+      {"r00 c0 r10 c1 k1 r21 r30 s1",
+       "r00 c0 k1 s1"},
+      {"k1 k1 r01 s0 r11 c1 k0 c0 w00",
+       "k1 k1 s0 r11 c1 k0"},
+      {"k1 k1 k0 r01 c0 r11 c1 r21 w01",
+       "k1 k1 k0 r01 c0"}
+    };
+
+    for (const auto &cs : cases) {
+        Sequence<BoundOp> seq;
+        std::map<const BoundOp *, std::string> tokens;
+        std::stringstream in(cs[0]);
+        std::string t;
+        while (in >> t) {
+            const int x = t[1] - '0';
+            const int y = t.size() > 2 ? t[2] - '0' : 0;
+            std::shared_ptr<BoundOp> op;
+            if ('k' == t[0]) {
+                op = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("k"), Stream(x));
+            } else if ('r' == t[0]) {
+                op = std::make_shared<CudaEventRecord>(Event(x), Stream(y));
+            } else if ('w' == t[0]) {
+                op = std::make_shared<CudaStreamWaitEvent>(Stream(x), Event(y));
+            } else if ('c' == t[0]) {
+                op = std::make_shared<CudaEventSync>(Event(x));
+            } else {
+                op = std::make_shared<StreamSync>(Stream(x));
+            }
+            seq.push_back(op);
+            tokens[op.get()] = t;
+        }
+
+        Schedule::remove_redundant_syncs(seq);
+        std::string out;
+        for (const auto &op : seq) {
+            out += (out.empty() ? "" : " ") + tokens[op.get()];
+        }
+        CHECK_MESSAGE(out == cs[1], cs[0]);
+    }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
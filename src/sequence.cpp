@@ -8,6 +8,9 @@
 #include "tenzing/cuda/ops_cuda.hpp"
 #include "tenzing/operation_serdes.hpp"
 
+#include <nlohmann/json.hpp>
+
+#include <map>
 #include <sstream>
 
 std::string Equivalence::str() const {
@@ -85,6 +88,29 @@ Equivalence get_equivalence(const Sequence<BoundOp> &a, const Sequence<BoundOp>
   return eq;
 }
 
+std::string canonical_sequence(const Sequence<BoundOp> &seq) {
+  std::map<Stream, size_t> streams;
+  std::map<Event, size_t> events;
+
+  nlohmann::json j = nlohmann::json::array();
+  for (const std::shared_ptr<BoundOp> &op : seq) {
+    nlohmann::json js = nlohmann::json::array();
+    nlohmann::json je = nlohmann::json::array();
+    if (auto hs = std::dynamic_pointer_cast<HasStream>(op)) {
+      for (const Stream &s : hs->get_streams()) {
+        js.push_back(streams.emplace(s, streams.size()).first->second);
+      }
+    }
+    if (auto he = std::dynamic_pointer_cast<HasEvent>(op)) {
+      for (const Event &e : he->get_events()) {
+        je.push_back(events.emplace(e, events.size()).first->second);
+      }
+    }
+    j.push_back({op->name(), js, je});
+  }
+  return j.dump();
+}
+
 Sequence<BoundOp> mpi_bcast(const Sequence<BoundOp> &order, const Graph<OpBase> &g, MPI_Comm comm) {
 
   int rank, size;
@@ -137,33 +163,178 @@ std::string get_desc_delim(const Sequence<BoundOp> &seq, const std::string &deli
   return s;
 }
 
-template <>
-Sequence<BoundOp>::const_iterator
-Sequence<BoundOp>::find_unbound(const std::shared_ptr<OpBase> &e) const {
+namespace {
+
+// op with its event replaced, or nullptr if op is not a kind recolor_events() knows about
+std::shared_ptr<BoundOp> with_event(const std::shared_ptr<BoundOp> &op, const Event &event) {
+  if (auto cer = std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+    return std::make_shared<CudaEventRecord>(event, cer->stream(), cer->name());
+  } else if (auto cswe = std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+    return std::make_shared<CudaStreamWaitEvent>(cswe->stream(), event, cswe->name());
+  } else if (auto ces = std::dynamic_pointer_cast<CudaEventSync>(op)) {
+    return std::make_shared<CudaEventSync>(event, ces->name());
+  } else if (auto sw = std::dynamic_pointer_cast<StreamWait>(op)) {
+    return std::make_shared<StreamWait>(sw->waitee(), sw->waiter(), event, sw->name());
+  }
+  return nullptr;
+}
 
-  // unbound version if bound
-  std::shared_ptr<OpBase> ue;
-  if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(e)) {
-    ue = bgo->unbound();
-  } else {
-    ue = e;
+// a lifetime from a record (or the first use) to the last use before the next record
+struct Lifetime {
+  Event event;
+  size_t start;
+  size_t end;
+};
+
+/* the lifetimes of the events in seq in order of their start, and the lifetime each op's event is
+   in (-1 for none). False if seq uses an unexpected kind of operation with events
+*/
+bool event_lifetimes(const Sequence<BoundOp> &seq, std::vector<Lifetime> &lifetimes,
+                     std::vector<size_t> &opLifetime) {
+  std::map<Event, size_t> current; // the lifetime of each event so far
+  opLifetime.assign(seq.size(), size_t(-1));
+
+  for (size_t i = 0; i < seq.size(); ++i) {
+    const std::shared_ptr<BoundOp> &op = seq[i];
+    auto he = std::dynamic_pointer_cast<HasEvent>(op);
+    if (!he) {
+      continue;
+    }
+    const std::vector<Event> events = he->get_events();
+    if (1 != events.size() || !with_event(op, events[0])) {
+      return false;
+    }
+    const Event &event = events[0];
+
+    const bool record = std::dynamic_pointer_cast<CudaEventRecord>(op) ||
+                        std::dynamic_pointer_cast<StreamWait>(op);
+    std::map<Event, size_t>::iterator it = current.find(event);
+    if (record || current.end() == it) {
+      current[event] = lifetimes.size();
+      lifetimes.push_back(Lifetime{event, i, i});
+    } else {
+      lifetimes[it->second].end = i;
+    }
+    opLifetime[i] = current[event];
   }
+  return true;
+}
 
-  for (auto it = ops_.begin(); it < ops_.end(); ++it) {
+} // namespace
 
-    // get unbound version if bound
-    std::shared_ptr<OpBase> uve;
-    if (auto bgo = std::dynamic_pointer_cast<BoundGpuOp>(*it)) {
-      uve = bgo->unbound();
+Sequence<BoundOp> recolor_events(const Sequence<BoundOp> &seq) {
+  std::vector<Lifetime> lifetimes;
+  std::vector<size_t> opLifetime;
+  if (!event_lifetimes(seq, lifetimes, opLifetime)) {
+    return seq;
+  }
+
+  // lifetimes are in order of their start. Give each the smallest id not used by a live one
+  std::vector<Event::id_t> color(lifetimes.size());
+  std::vector<size_t> busyUntil; // by id, the end of the last lifetime colored with it
+  for (size_t l = 0; l < lifetimes.size(); ++l) {
+    Event::id_t id = 0;
+    while (id < busyUntil.size() && busyUntil[id] >= lifetimes[l].start) {
+      ++id;
+    }
+    if (id == busyUntil.size()) {
+      busyUntil.push_back(0);
+    }
+    busyUntil[id] = lifetimes[l].end;
+    color[l] = id;
+  }
+
+  Sequence<BoundOp> ret;
+  for (size_t i = 0; i < seq.size(); ++i) {
+    const std::shared_ptr<BoundOp> &op = seq[i];
+    if (size_t(-1) == opLifetime[i]) {
+      ret.push_back(op);
     } else {
-      uve = *it;
+      const Event event(color[opLifetime[i]]);
+      if (std::dynamic_pointer_cast<HasEvent>(op)->get_events()[0] == event) {
+        ret.push_back(op);
+      } else {
+        ret.push_back(with_event(op, event));
+      }
+    }
+  }
+  return ret;
+}
+
+std::map<Event, size_t> share_events(const Sequence<BoundOp> &seq) {
+  std::map<Event, size_t> ret;
+  std::vector<Lifetime> lifetimes;
+  std::vector<size_t> opLifetime;
+  if (!event_lifetimes(seq, lifetimes, opLifetime)) {
+    // one each, in order of first use
+    for (const auto &op : seq) {
+      if (auto he = std::dynamic_pointer_cast<HasEvent>(op)) {
+        for (const Event &event : he->get_events()) {
+          ret.insert(std::make_pair(event, ret.size()));
+        }
+      }
     }
+    return ret;
+  }
+
+  std::map<Event, std::vector<const Lifetime *>> byEvent; // every lifetime of each event
+  for (const Lifetime &l : lifetimes) {
+    byEvent[l.event].push_back(&l);
+  }
 
-    if (uve->eq(ue)) {
+  // in order of first use, give each event the first index none of its lifetimes overlap
+  std::vector<std::vector<const Lifetime *>> shared; // the lifetimes that use each index
+  for (const Lifetime &first : lifetimes) {
+    if (ret.count(first.event)) {
+      continue;
+    }
+    const std::vector<const Lifetime *> &mine = byEvent[first.event];
+    auto overlaps = [&](const std::vector<const Lifetime *> &theirs) {
+      for (const Lifetime *a : mine) {
+        for (const Lifetime *b : theirs) {
+          if (a->start <= b->end && b->start <= a->end) {
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+    size_t index = 0;
+    while (index < shared.size() && overlaps(shared[index])) {
+      ++index;
+    }
+    if (index == shared.size()) {
+      shared.push_back({});
+    }
+    shared[index].insert(shared[index].end(), mine.begin(), mine.end());
+    ret[first.event] = index;
+  }
+  return ret;
+}
+
+ResourceMap provision_events(const Sequence<BoundOp> &seq, CudaEventPool &pool) {
+  pool.reset();
+  std::vector<cudaEvent_t> cevents;
+  ResourceMap rMap;
+  for (const auto &kv : share_events(seq)) {
+    while (kv.second >= cevents.size()) {
+      cevents.push_back(pool.new_event());
+    }
+    rMap.insert(kv.first, cevents[kv.second]);
+  }
+  return rMap;
+}
+
+template <>
+Sequence<BoundOp>::const_iterator
+Sequence<BoundOp>::find_unbound(const std::shared_ptr<OpBase> &e) const {
+  const OpBase::id_t ue = e->unbound_id();
+  for (auto it = begin(); it < end(); ++it) {
+    if ((*it)->unbound_id() == ue) {
       return it;
     }
   }
-  return ops_.end();
+  return end();
 }
 
 #if TENZING_ENABLE_TESTS == 1
@@ -173,4 +344,122 @@ TEST_CASE("[cpu]" " " "empty sequence") {
   Sequence<OpBase> seq;
   CHECK(seq.size() == 0);
 }
+
+TEST_CASE("[cpu]" " " "sequence prefix sharing") {
+  std::vector<std::shared_ptr<OpBase>> ops;
+  for (int i = 0; i < 5; ++i) {
+    ops.push_back(std::make_shared<NoOp>("op" + std::to_string(i)));
+  }
+
+  Sequence<OpBase> a({ops[0], ops[1]});
+  Sequence<OpBase> b = a; // shares a's operations
+  a.push_back(ops[2]);
+  b.push_back(ops[3]);
+  REQUIRE(a.size() == 3);
+  REQUIRE(b.size() == 3);
+  CHECK(a[2] == ops[2]);
+  CHECK(b[2] == ops[3]);
+  CHECK(a[1] == b[1]);
+  CHECK(a.back() == ops[2]);
+
+  // appending after materializing keeps the vector up to date
+  b.push_back(ops[4]);
+  CHECK(b.vector() == std::vector<std::shared_ptr<OpBase>>({ops[0], ops[1], ops[3], ops[4]}));
+  b.pop_back();
+  b.pop_back();
+  CHECK(b.vector() == std::vector<std::shared_ptr<OpBase>>({ops[0], ops[1]}));
+
+  // erasing relinks only this sequence
+  Sequence<OpBase> c = a;
+  auto it = c.erase(c.begin() + 1);
+  CHECK(*it == ops[2]);
+  CHECK(c.vector() == std::vector<std::shared_ptr<OpBase>>({ops[0], ops[2]}));
+  CHECK(a.vector() == std::vector<std::shared_ptr<OpBase>>({ops[0], ops[1], ops[2]}));
+  c.push_back(ops[4]);
+  Sequence<OpBase> d = c;
+  CHECK(d.vector() == std::vector<std::shared_ptr<OpBase>>({ops[0], ops[2], ops[4]}));
+
+  c.clear();
+  CHECK(c.size() == 0);
+  CHECK(c.begin() == c.end());
+  CHECK(d.size() == 3);
+}
+TEST_CASE("[cpu]" " " "sequence event recoloring") {
+  auto start = std::make_shared<Start>();
+  auto cer = [](Event::id_t e, Stream::id_t s) {
+    return std::make_shared<CudaEventRecord>(Event(e), Stream(s));
+  };
+  auto cswe = [](Stream::id_t s, Event::id_t e) {
+    return std::make_shared<CudaStreamWaitEvent>(Stream(s), Event(e));
+  };
+  auto ces = [](Event::id_t e) { return std::make_shared<CudaEventSync>(Event(e)); };
+
+  // the events of seq, in order
+  auto events = [](const Sequence<BoundOp> &seq) {
+    std::vector<Event::id_t> ret;
+    for (const auto &op : seq) {
+      if (auto he = std::dynamic_pointer_cast<HasEvent>(op)) {
+        ret.push_back(he->get_events()[0].id_);
+      }
+    }
+    return ret;
+  };
+
+  SUBCASE("new unique event") {
+    Sequence<BoundOp> seq({start});
+    CHECK(seq.new_unique_event() == Event(0));
+    seq.push_back(cer(3, 0));
+    CHECK(seq.new_unique_event() == Event(4));
+    seq.push_back(ces(1));
+    CHECK(seq.new_unique_event() == Event(4));
+    seq.pop_back();
+    seq.pop_back();
+    CHECK(seq.new_unique_event() == Event(0));
+  }
+
+  SUBCASE("disjoint lifetimes share an event") {
+    Sequence<BoundOp> seq(
+        {start, cer(0, 0), cswe(1, 0), cer(1, 1), ces(1), cer(2, 0), cswe(1, 2)});
+    Sequence<BoundOp> re = recolor_events(seq);
+    REQUIRE(re.size() == seq.size());
+    CHECK(events(re) == std::vector<Event::id_t>({0, 0, 0, 0, 0, 0}));
+    CHECK(re[0] == start);
+    CHECK(re[1] == seq[1]); // unchanged operations are kept
+    CHECK(std::dynamic_pointer_cast<CudaEventRecord>(re[3])->stream() == Stream(1));
+  }
+
+  SUBCASE("overlapping lifetimes") {
+    Sequence<BoundOp> seq({start, cer(5, 0), cer(7, 1), cswe(1, 5), cswe(0, 7), cer(9, 0), ces(9)});
+    CHECK(events(recolor_events(seq)) == std::vector<Event::id_t>({0, 1, 0, 1, 0, 0}));
+  }
+
+  SUBCASE("each record starts a lifetime") {
+    // event 0 is recorded twice; event 1 is live between them
+    Sequence<BoundOp> seq({start, cer(0, 0), cswe(1, 0), cer(1, 1), cer(0, 0), ces(1), ces(0)});
+    CHECK(events(recolor_events(seq)) == std::vector<Event::id_t>({0, 0, 0, 1, 0, 1}));
+  }
+
+  SUBCASE("stream wait") {
+    auto sw = std::make_shared<StreamWait>(Stream(0), Stream(1), Event(4));
+    Sequence<BoundOp> seq({start, cer(2, 0), sw, ces(2)});
+    CHECK(events(recolor_events(seq)) == std::vector<Event::id_t>({0, 1, 0}));
+  }
+
+  SUBCASE("share events") {
+    typedef std::map<Event, size_t> Shared;
+    Sequence<BoundOp> seq({start, cer(0, 0), cswe(1, 0), cer(1, 1), ces(1), cer(2, 0), cswe(1, 2)});
+    CHECK(share_events(seq) == Shared({{Event(0), 0}, {Event(1), 0}, {Event(2), 0}}));
+
+    seq = Sequence<BoundOp>(
+        {start, cer(5, 0), cer(7, 1), cswe(1, 5), cswe(0, 7), cer(9, 0), ces(9)});
+    CHECK(share_events(seq) == Shared({{Event(5), 0}, {Event(7), 1}, {Event(9), 0}}));
+
+    // an event shares with another only if none of their lifetimes overlap
+    seq = Sequence<BoundOp>({start, cer(0, 0), cswe(1, 0), cer(1, 1), cer(0, 0), ces(1), ces(0)});
+    CHECK(share_events(seq) == Shared({{Event(0), 0}, {Event(1), 1}}));
+    seq = Sequence<BoundOp>({start, cer(0, 0), cswe(1, 0), cer(1, 1), ces(1), cer(0, 0), ces(0)});
+    CHECK(share_events(seq) == Shared({{Event(0), 0}, {Event(1), 0}}));
+  }
+}
+
 #endif // TENZING_ENABLE_TESTS == 1
\ No newline at end of file
@@ -1,15 +1,113 @@
 #include "tenzing/state.hpp"
 
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
 namespace SDP {
 
+namespace {
+
+/* renumber streams and events in order of first appearance
+ */
+class Relabeling {
+  std::map<Stream, uint64_t> streams_;
+  std::map<Event, uint64_t> events_;
+
+public:
+  uint64_t stream(const Stream &s) { return streams_.emplace(s, streams_.size()).first->second; }
+  uint64_t event(const Event &e) { return events_.emplace(e, events_.size()).first->second; }
+  size_t num_streams() const { return streams_.size(); }
+  size_t num_events() const { return events_.size(); }
+};
+
+/* an identity for op that does not depend on its streams or events
+ */
+std::pair<uint64_t, uint64_t> op_identity(const OpBase &op) {
+  if (op.unbound_id() != op.id()) { // a bound operation, identified by the unbound one
+    return std::make_pair(0, op.unbound_id());
+  } else if (dynamic_cast<const HasStream *>(&op) || dynamic_cast<const HasEvent *>(&op)) {
+    // synchronization operations compare by their streams and events, so identify them by name
+    return std::make_pair(1, hash_combine(op.tag(), std::hash<std::string>()(op.name())));
+  } else {
+    return std::make_pair(0, op.id());
+  }
+}
+
+void append_op(std::vector<uint64_t> &key, const OpBase &op) {
+  const std::pair<uint64_t, uint64_t> identity = op_identity(op);
+  key.push_back(identity.first);
+  key.push_back(identity.second);
+}
+
+/* append the relabeled streams and events of op
+ */
+void append_resources(std::vector<uint64_t> &key, Relabeling &relabel, const OpBase &op) {
+  if (auto hs = dynamic_cast<const HasStream *>(&op)) {
+    const std::vector<Stream> streams = hs->get_streams();
+    key.push_back(streams.size());
+    for (const Stream &stream : streams) {
+      key.push_back(relabel.stream(stream));
+    }
+  } else {
+    key.push_back(0);
+  }
+  if (auto he = dynamic_cast<const HasEvent *>(&op)) {
+    const std::vector<Event> events = he->get_events();
+    key.push_back(events.size());
+    for (const Event &event : events) {
+      key.push_back(relabel.event(event));
+    }
+  } else {
+    key.push_back(0);
+  }
+}
+
+/* append the vertices and edges of graph
+ */
+void append_graph(std::vector<uint64_t> &key, Relabeling &relabel, const Graph<OpBase> &graph) {
+  // graphs derived from the same graph may number their vertices differently (e.g. different
+  // expansions), so walk them in order of operation id instead
+  std::vector<std::pair<OpBase::id_t, Graph<OpBase>::vid_t>> order;
+  for (Graph<OpBase>::vid_t v : graph.vertices()) {
+    order.push_back(std::make_pair(graph.op(v)->unbound_id(), v));
+  }
+  std::sort(order.begin(), order.end());
+
+  key.push_back(order.size());
+  std::vector<OpBase::id_t> succs;
+  for (const auto &uv : order) {
+    const OpBase &op = *graph.op(uv.second);
+    append_op(key, op);
+    append_resources(key, relabel, op);
+
+    succs.clear();
+    for (const auto &succ : graph.succs(uv.second)) {
+      succs.push_back(succ->unbound_id());
+    }
+    std::sort(succs.begin(), succs.end());
+    key.push_back(succs.size());
+    key.insert(key.end(), succs.begin(), succs.end());
+  }
+}
+
+} // namespace
+
+Fingerprint::Fingerprint(std::vector<uint64_t> &&key) : key_(std::move(key)), hash_(0) {
+  std::hash<uint64_t> hasher;
+  for (uint64_t k : key_) {
+    hash_ = hash_combine(hash_, hasher(k));
+  }
+}
+
 std::vector<std::shared_ptr<BoundOp>> State::get_syncs_before_op(const std::shared_ptr<BoundOp> &op) const {
   std::vector<std::shared_ptr<BoundOp>> syncs;
 
-  if (Synchronizer::is_synced(op, graph_, sequence_)) {
+  if (::is_synced(op, graph_, hb_)) {
     STDERR(op->desc() << " is synced");
   } else { // otherwise synchronizers should be added
     STDERR(op->desc() << " is not synced with preds");
-    syncs = Synchronizer::make_syncs(op, graph_, sequence_, true);
+    syncs = ::make_syncs(sync_, op, graph_, hb_);
     {
       std::stringstream ss;
       ss << "generated synchronizers for " << op->desc() << ":";
@@ -22,15 +120,54 @@ std::vector<std::shared_ptr<BoundOp>> State::get_syncs_before_op(const std::shar
   return syncs;
 }
 
-std::vector<std::shared_ptr<Decision>> State::get_decisions(Platform &plat, const bool quiet) const {
+bool State::is_asleep(const std::shared_ptr<BoundOp> &op) const {
+  for (const auto &s : sleep_) {
+    if (s->id() == op->id()) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  // find all nodes in graph that are available
-  std::vector<std::shared_ptr<OpBase>> frontier = graph_.frontier(sequence_.vector());
+std::vector<Stream> State::assignable_streams(const Platform &plat) const {
+  std::unordered_set<Stream::id_t> used;
+  auto use = [&](const OpBase &op) {
+    if (auto hs = dynamic_cast<const HasStream *>(&op)) {
+      for (const Stream &stream : hs->get_streams()) {
+        used.insert(stream.id_);
+      }
+    }
+  };
+  for (const auto &op : sequence_) {
+    use(*op);
+  }
+  for (Graph<OpBase>::vid_t v : graph_.vertices()) {
+    use(*graph_.op(v));
+  }
 
+  // like a restricted growth string: every used stream, and only the first unused one
+  std::vector<Stream> ret;
+  bool fresh = false;
+  for (const Stream &stream : plat.streams_) {
+    if (used.count(stream.id_)) {
+      ret.push_back(stream);
+    } else if (!fresh) {
+      ret.push_back(stream);
+      fresh = true;
+    }
+  }
+  return ret;
+}
+
+std::vector<Decision> State::get_decisions(Platform &plat, const bool quiet) const {
 
-  std::vector<std::shared_ptr<Decision>> decisions;
+  std::vector<Decision> decisions;
+  std::vector<Stream> streams; // computed the first time a GpuOp needs it
+  bool haveStreams = false;
 
-  for (const auto &op : frontier) {
+  // all nodes in graph that are available
+  for (Graph<OpBase>::vid_t v : ready_.ready()) {
+    const std::shared_ptr<OpBase> &op = graph_.op(v);
 
     // any BoundOp that are available to actually execute (or a synchronization thereof)
     if (auto bop = std::dynamic_pointer_cast<BoundOp>(op)) {
@@ -40,27 +177,35 @@ std::vector<std::shared_ptr<Decision>> State::get_decisions(Platform &plat, cons
 
       // if not, this op is available
       if (syncs.empty()) {
-        decisions.push_back(std::make_shared<ExecuteOp>(bop));
+        if (!is_asleep(bop)) {
+          decisions.push_back(ExecuteOp(bop));
+        }
       } else { // otherwise, a synchronization of this op should be available
         for (const std::shared_ptr<BoundOp> &sync : syncs) {
-          decisions.push_back(std::make_shared<ExecuteOp>(sync));
+          if (!is_asleep(sync)) {
+            decisions.push_back(ExecuteOp(sync));
+          }
         }
       }
     }
     // any GpuOp that can be assigned to a stream
     else if (auto gop = std::dynamic_pointer_cast<GpuOp>(op)) {
-      for (const Stream stream : plat.streams_) {
-        decisions.push_back(std::make_shared<AssignOpStream>(gop, stream));
+      if (!haveStreams) {
+        streams = assignable_streams(plat);
+        haveStreams = true;
+      }
+      for (const Stream &stream : streams) {
+        decisions.push_back(AssignOpStream(gop, stream));
       }
     }
     // any CompoundOp that can be expanded
     else if (auto cop1 = std::dynamic_pointer_cast<CompoundOp>(op)) {
-      decisions.push_back(std::make_shared<ExpandOp>(cop1));
+      decisions.push_back(ExpandOp(cop1));
     }
     // and ChoiceOp that can be chosen
     else if (auto cop2 = std::dynamic_pointer_cast<ChoiceOp>(op)) {
       for (const auto &choice : cop2->choices()) {
-        decisions.push_back(std::make_shared<ChooseOp>(cop2, choice));
+        decisions.push_back(ChooseOp(cop2, choice));
       }
     }
   }
@@ -68,61 +213,264 @@ std::vector<std::shared_ptr<Decision>> State::get_decisions(Platform &plat, cons
   return decisions;
 }
 
-State State::apply(const Decision &d) const {
+/* the state after one Decision, for Decision::visit
+ */
+struct State::Apply {
+  const State &state;
 
-  try {
-    const ExecuteOp &to = dynamic_cast<const ExecuteOp &>(d);
-    State ret = *this;
+  State operator()(const ExecuteOp &to) const {
+    State ret = state;
     ret.sequence_.push_back(to.op);
+    ret.ready_.execute(ret.graph_, to.op);
+    ret.hb_.append(to.op);
+
+    // operations that don't commute with to.op wake up
+    ret.sleep_.clear();
+    for (const auto &s : state.sleep_) {
+      if (independent(*s, *to.op)) {
+        ret.sleep_.push_back(s);
+      }
+    }
     return ret;
-  } catch (std::bad_cast&) {
-    // pass
   }
 
-  try {
-    const ExpandOp &eo = dynamic_cast<const ExpandOp &>(d);
-    return State(graph_.clone_but_expand(eo.op, eo.op->graph()), sequence_);
-  } catch (std::bad_cast&) {
-    // pass
+  State operator()(const ExpandOp &eo) const {
+    // the sequence is unchanged, so hb_ is too
+    State ret = state;
+    ret.graph_ = state.graph_.clone_but_expand(eo.op, eo.op->graph());
+    ret.ready_ = ReadySet(ret.graph_, ret.sequence_);
+    return ret;
   }
 
-  try {
-    const AssignOpStream &aos = dynamic_cast<const AssignOpStream &>(d);
-    State ret = *this;
-    ret.graph_ = graph_.clone_but_replace(std::make_shared<BoundGpuOp>(aos.op, aos.stream), aos.op);
+  // the remaining decisions replace a vertex in place, so ready_ and sleep_ are unchanged
+  State operator()(const AssignOpStream &aos) const {
+    State ret = state;
+    ret.graph_ =
+        state.graph_.clone_but_replace(std::make_shared<BoundGpuOp>(aos.op, aos.stream), aos.op);
     return ret;
-  } catch (std::bad_cast&) {
-    // pass
   }
 
-  try {
-    const ChooseOp &co = dynamic_cast<const ChooseOp &>(d);
-    return State(graph_.clone_but_replace(co.replacement, co.orig), sequence_);
-  } catch (std::bad_cast&) {
-    // pass
+  State operator()(const ChooseOp &co) const {
+    State ret = state;
+    ret.graph_ = state.graph_.clone_but_replace(co.replacement, co.orig);
+    return ret;
   }
+};
+
+State State::apply(const Decision &d) const { return d.visit(Apply{*this}); }
 
-  THROW_RUNTIME("failed to apply decision, unexpected Decision type");
+void State::sleep_siblings(const std::vector<Decision> &decisions, size_t i) {
+  /* partial-order reduction: the states after earlier sibling operations will go on to execute
+     decisions[i]. If decisions[i] doesn't interact with that operation, it is asleep here.
+     Decisions that only modify the graph commute with any execution.
+  */
+  if (!por_) {
+    return;
+  }
+  const ExecuteOp *eo = decisions[i].get_if<ExecuteOp>();
+  for (size_t k = 0; k < i; ++k) {
+    if (const ExecuteOp *prev = decisions[k].get_if<ExecuteOp>()) {
+      if (!eo || independent(*prev->op, *eo->op)) {
+        sleep_.push_back(prev->op);
+      }
+    }
+  }
 }
 
 std::vector<State> State::frontier(Platform &plat, bool quiet) {
 
   // get all possible Decisions that can be made from this state
-  std::vector<std::shared_ptr<Decision>> decisions = get_decisions(plat);
+  std::vector<Decision> decisions = get_decisions(plat);
 
-  // apply decisions to the state
+  // apply decisions to the state, keeping only the first of any equivalent states
   std::vector<State> result;
-  for (const auto &decision : decisions) {
-    State state = apply(*decision);
-    result.push_back(state);
-  }
+  std::unordered_set<Fingerprint, Fingerprint::Hash> seen;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    State state = apply(decisions[i]);
 
-// remove duplicate states
-#warning unimplemented state deduplication
+    state.sleep_siblings(decisions, i);
+
+    if (seen.insert(state.fingerprint()).second) {
+      result.push_back(state);
+    }
+  }
+  STDERR(decisions.size() - result.size() << " equivalent states removed");
 
   return result;
 }
 
+void SearchState::apply(const Decision &d) {
+  log_.push_back(Undo{d.kind(), ReadySet::Undo{Graph<OpBase>::npos, 0}, HappensBefore::Undo(),
+                      Graph<OpBase>::npos, nullptr, nullptr, nullptr, state_.sleep_});
+  Undo &u = log_.back();
+
+  switch (d.kind()) {
+  case Decision::Kind::execute: {
+    const std::shared_ptr<BoundOp> &op = d.get_if<ExecuteOp>()->op;
+    state_.sequence_.push_back(op);
+    u.ready = state_.ready_.execute(state_.graph_, op);
+    u.hb = state_.hb_.append(op);
+    state_.sleep_.clear();
+    for (const auto &s : u.sleep) {
+      if (independent(*s, *op)) {
+        state_.sleep_.push_back(s);
+      }
+    }
+    break;
+  }
+  case Decision::Kind::expand: {
+    const ExpandOp &eo = *d.get_if<ExpandOp>();
+    Graph<OpBase> expanded = state_.graph_.clone_but_expand(eo.op, eo.op->graph());
+    u.graph.reset(new Graph<OpBase>(std::move(state_.graph_)));
+    u.readySet.reset(new ReadySet(std::move(state_.ready_)));
+    state_.graph_ = std::move(expanded);
+    state_.ready_ = ReadySet(state_.graph_, state_.sequence_);
+    break;
+  }
+  case Decision::Kind::assign: {
+    const AssignOpStream &aos = *d.get_if<AssignOpStream>();
+    u.v = state_.graph_.find(aos.op);
+    if (Graph<OpBase>::npos != u.v) {
+      u.replaced = state_.graph_.op(u.v);
+      state_.graph_.replace_vertex(u.v, std::make_shared<BoundGpuOp>(aos.op, aos.stream));
+    }
+    break;
+  }
+  case Decision::Kind::choose: {
+    const ChooseOp &co = *d.get_if<ChooseOp>();
+    u.v = state_.graph_.find(co.orig);
+    if (Graph<OpBase>::npos != u.v) {
+      u.replaced = state_.graph_.op(u.v);
+      state_.graph_.replace_vertex(u.v, co.replacement);
+    }
+    break;
+  }
+  }
+}
+
+void SearchState::apply(const std::vector<Decision> &decisions, size_t i) {
+  apply(decisions[i]);
+  state_.sleep_siblings(decisions, i);
+}
+
+void SearchState::undo() {
+  if (log_.empty()) {
+    THROW_RUNTIME("nothing to undo");
+  }
+  Undo &u = log_.back();
+
+  switch (u.kind) {
+  case Decision::Kind::execute:
+    state_.ready_.undo(state_.graph_, u.ready);
+    state_.hb_.undo(u.hb);
+    state_.sequence_.pop_back();
+    break;
+  case Decision::Kind::expand:
+    state_.graph_ = std::move(*u.graph);
+    state_.ready_ = std::move(*u.readySet);
+    break;
+  case Decision::Kind::assign:
+  case Decision::Kind::choose:
+    if (Graph<OpBase>::npos != u.v) {
+      state_.graph_.replace_vertex(u.v, u.replaced);
+    }
+    break;
+  }
+  state_.sleep_ = std::move(u.sleep);
+  log_.pop_back();
+}
+
+Fingerprint State::fingerprint() const {
+  std::vector<uint64_t> key;
+  Relabeling relabel;
+
+  key.push_back(sequence_.size());
+  for (const auto &op : sequence_) {
+    append_op(key, *op);
+    append_resources(key, relabel, *op);
+  }
+  append_graph(key, relabel, graph_);
+  return Fingerprint(std::move(key));
+}
+
+Fingerprint State::transposition_fingerprint() const {
+  std::vector<uint64_t> key;
+  Relabeling relabel;
+
+  // the executed operations, ordered by identity. Equal identities keep their sequence order
+  std::vector<std::pair<std::pair<uint64_t, uint64_t>, size_t>> order;
+  for (size_t i = 0; i < sequence_.size(); ++i) {
+    order.push_back(std::make_pair(op_identity(*sequence_[i]), i));
+  }
+  std::sort(order.begin(), order.end());
+
+  key.push_back(order.size());
+  std::vector<uint64_t> rank(order.size());
+  for (size_t r = 0; r < order.size(); ++r) {
+    const OpBase &op = *sequence_[order[r].second];
+    append_op(key, op);
+    append_resources(key, relabel, op);
+    rank[order[r].second] = r + 1; // 0 is no operation
+  }
+
+  /* the order of executed operations that do not commute, as a transitive reduction. Following
+     the independent_of() declarations, a NoOp commutes with everything, a launch only with
+     launches into other streams, and every other operation (issued by the host) with nothing.
+     So it is enough to give, for each operation:
+     - the host operation before it, which orders the host operations
+     - for a launch, the launch before it in the same stream
+     - for a host operation, the last launch into each stream since the host operation before it
+     - for a wait or sync on an event, the record it waits for
+     which is O(n), rather than every pair that does not commute.
+  */
+  std::vector<std::vector<uint64_t>> before(sequence_.size());
+  uint64_t host = 0;                     // the latest host operation
+  std::map<Stream, uint64_t> lastLaunch; // the latest launch into each stream
+  std::map<Stream, uint64_t> sinceHost;  // the same, since the latest host operation
+  std::map<Event, uint64_t> lastRecord;  // the latest record of each event
+  for (size_t i = 0; i < sequence_.size(); ++i) {
+    const BoundOp &op = *sequence_[i];
+    std::vector<uint64_t> &b = before[rank[i] - 1];
+    if (dynamic_cast<const NoOp *>(&op)) {
+      continue;
+    } else if (auto gpu = dynamic_cast<const BoundGpuOp *>(&op)) {
+      b.push_back(host);
+      b.push_back(lastLaunch[gpu->stream()]);
+      lastLaunch[gpu->stream()] = rank[i];
+      sinceHost[gpu->stream()] = rank[i];
+      continue;
+    }
+
+    b.push_back(host);
+    b.push_back(sinceHost.size());
+    for (const auto &kv : sinceHost) {
+      b.push_back(kv.second);
+    }
+    std::sort(b.end() - sinceHost.size(), b.end()); // by rank, not by the stream's label
+    sinceHost.clear();
+    host = rank[i];
+
+    if (auto he = dynamic_cast<const HasEvent *>(&op)) {
+      const bool record =
+          dynamic_cast<const CudaEventRecord *>(&op) || dynamic_cast<const StreamWait *>(&op);
+      for (const Event &event : he->get_events()) {
+        if (record) {
+          lastRecord[event] = rank[i];
+        } else {
+          b.push_back(lastRecord[event]);
+        }
+      }
+    }
+  }
+  for (const std::vector<uint64_t> &b : before) {
+    key.push_back(b.size());
+    key.insert(key.end(), b.begin(), b.end());
+  }
+
+  append_graph(key, relabel, graph_);
+  return Fingerprint(std::move(key));
+}
+
 Equivalence get_equivalence(const State &a, const State &b) {
   
   Equivalence seqEq = get_equivalence(a.sequence(), b.sequence());
@@ -143,4 +491,248 @@ Equivalence get_equivalence(const State &a, const State &b) {
 }
 
 
-} // namespace SDP
\ No newline at end of file
+} // namespace SDP
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/mpi/ops_mpi.hpp"
+#include "tenzing/test_ops.hpp"
+
+#include <functional>
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "state fingerprint") {
+  Graph<OpBase> graph;
+  auto noop = std::make_shared<NoOp>("noop");
+  graph.start_then(noop);
+  graph.then_finish(noop);
+  auto start = std::dynamic_pointer_cast<BoundOp>(graph.start());
+
+  // record an event in one stream and wait for it in another
+  auto sync = [&](Stream a, Stream b, Event e) {
+    return Sequence<BoundOp>({start, std::make_shared<CudaEventRecord>(e, a),
+                              std::make_shared<CudaStreamWaitEvent>(b, e)});
+  };
+
+  const SDP::Fingerprint f = SDP::State(graph, sync(Stream(1), Stream(2), Event(0))).fingerprint();
+
+  // same up to relabeling streams and events
+  CHECK(f == SDP::State(graph, sync(Stream(2), Stream(1), Event(3))).fingerprint());
+  CHECK(f == SDP::State(graph, sync(Stream(2), Stream(3), Event(0))).fingerprint());
+
+  // no relabeling makes the waiter the same stream as the recorder
+  CHECK(f != SDP::State(graph, sync(Stream(1), Stream(1), Event(0))).fingerprint());
+
+  // different operations
+  CHECK(f != SDP::State(graph, Sequence<BoundOp>({start, noop})).fingerprint());
+  CHECK(f != SDP::State(graph).fingerprint());
+}
+
+TEST_CASE("[cpu]" " " "state transposition fingerprint") {
+  Graph<OpBase> graph;
+  auto a = std::make_shared<NoOp>("a");
+  auto b = std::make_shared<NoOp>("b");
+  graph.start_then(a);
+  graph.start_then(b);
+  graph.then_finish(a);
+  graph.then_finish(b);
+  auto start = std::dynamic_pointer_cast<BoundOp>(graph.start());
+
+  SDP::State ab(graph, Sequence<BoundOp>({start, a, b}));
+  SDP::State ba(graph, Sequence<BoundOp>({start, b, a}));
+  CHECK(ab.fingerprint() != ba.fingerprint());
+  CHECK(ab.transposition_fingerprint() == ba.transposition_fingerprint());
+  CHECK(ab.transposition_fingerprint() !=
+        SDP::State(graph, Sequence<BoundOp>({start, a})).transposition_fingerprint());
+
+  // the order operations use a stream matters
+  auto cer = std::make_shared<CudaEventRecord>(Event(0), Stream(1));
+  auto cswe = std::make_shared<CudaStreamWaitEvent>(Stream(2), Event(0));
+  SDP::State recordFirst(graph, Sequence<BoundOp>({start, cer, a, cswe}));
+  SDP::State recordLater(graph, Sequence<BoundOp>({start, a, cer, cswe}));
+  SDP::State waitFirst(graph, Sequence<BoundOp>({start, cswe, a, cer}));
+  CHECK(recordFirst.transposition_fingerprint() == recordLater.transposition_fingerprint());
+  CHECK(recordFirst.transposition_fingerprint() != waitFirst.transposition_fingerprint());
+
+  // host operations with no stream keep their order
+  char buf[4];
+  MPI_Request req, other;
+  auto irecv =
+      std::make_shared<Irecv>(Irecv::Args{buf, 4, MPI_BYTE, 0, 0, MPI_COMM_WORLD, &req}, "irecv");
+  auto wait = std::make_shared<Wait>(Wait::Args{&other, MPI_STATUS_IGNORE}, "wait");
+  SDP::State postFirst(graph, Sequence<BoundOp>({start, irecv, wait}));
+  SDP::State postLater(graph, Sequence<BoundOp>({start, wait, irecv}));
+  CHECK(postFirst.transposition_fingerprint() != postLater.transposition_fingerprint());
+
+  // so does a launch and a host operation
+  auto k = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("k"), Stream(1));
+  SDP::State launchFirst(graph, Sequence<BoundOp>({start, k, wait}));
+  SDP::State launchLater(graph, Sequence<BoundOp>({start, wait, k}));
+  CHECK(launchFirst.transposition_fingerprint() != launchLater.transposition_fingerprint());
+
+  // but launches into different streams commute
+  auto k2 = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("k2"), Stream(2));
+  CHECK(SDP::State(graph, Sequence<BoundOp>({start, k, k2})).transposition_fingerprint() ==
+        SDP::State(graph, Sequence<BoundOp>({start, k2, k})).transposition_fingerprint());
+
+  // the key grows linearly with the sequence, though most pairs of operations do not commute
+  Sequence<BoundOp> seq({start});
+  for (int i = 0; i < 200; ++i) {
+    for (const auto &op : std::vector<std::shared_ptr<BoundOp>>({k, k2, cer, cswe, a, wait})) {
+      seq.push_back(op);
+    }
+  }
+  const SDP::Fingerprint f = SDP::State(graph, seq).transposition_fingerprint();
+  CHECK(f.size() <= 16 * seq.size());
+}
+
+TEST_CASE("[cpu]" " " "state partial-order reduction") {
+  // start -> a -> finish
+  //       -> b ->
+  //       -> c ->
+  Graph<OpBase> graph;
+  for (const char *name : {"a", "b", "c"}) {
+    auto op = std::make_shared<NoOp>(name);
+    graph.start_then(op);
+    graph.then_finish(op);
+  }
+  Platform plat(MPI_COMM_WORLD);
+
+  // count the complete sequences reachable from initial
+  auto count = [&](const SDP::State &initial) {
+    size_t complete = 0;
+    std::vector<SDP::State> worklist({initial});
+    while (!worklist.empty()) {
+      SDP::State curr = worklist.back();
+      worklist.pop_back();
+      std::vector<SDP::State> frontier = curr.frontier(plat);
+      if (frontier.empty() && curr.complete()) {
+        ++complete;
+      }
+      worklist.insert(worklist.end(), frontier.begin(), frontier.end());
+    }
+    return complete;
+  };
+
+  SDP::State initial(graph);
+  CHECK(count(initial) == 6);
+  initial.set_partial_order_reduction(true);
+  CHECK(count(initial) == 1);
+
+  // the first operation is asleep after executing the second one instead
+  std::vector<SDP::State> frontier = initial.frontier(plat);
+  REQUIRE(frontier.size() == 3);
+  CHECK(frontier[0].sleep_set().empty());
+  REQUIRE(frontier[1].sleep_set().size() == 1);
+  CHECK(frontier[1].sleep_set()[0] == frontier[0].sequence().vector().back());
+  CHECK(frontier[1].get_decisions(plat).size() == 1);
+}
+
+TEST_CASE("[cpu]" " " "state stream symmetry") {
+  // start -> k1 -> finish
+  //       -> k2 ->
+  Graph<OpBase> graph;
+  auto k1 = std::make_shared<Kernel>("k1");
+  auto k2 = std::make_shared<Kernel>("k2");
+  graph.start_then(k1);
+  graph.start_then(k2);
+  graph.then_finish(k1);
+  graph.then_finish(k2);
+
+  // streams without the CUDA resources, which get_decisions() does not need
+  Platform plat(MPI_COMM_WORLD);
+  for (Stream::id_t i = 0; i < 3; ++i) {
+    plat.streams_.push_back(Stream(i));
+  }
+
+  auto assigned = [](const std::vector<Decision> &decisions) {
+    std::vector<std::pair<std::string, Stream::id_t>> ret;
+    for (const Decision &decision : decisions) {
+      if (const AssignOpStream *aos = decision.get_if<AssignOpStream>()) {
+        ret.push_back(std::make_pair(aos->op->name(), aos->stream.id_));
+      }
+    }
+    return ret;
+  };
+
+  // no stream is used, so only the first one is offered
+  SDP::State initial(graph);
+  std::vector<std::pair<std::string, Stream::id_t>> expected{{"k1", 0}, {"k2", 0}};
+  CHECK(assigned(initial.get_decisions(plat)) == expected);
+
+  // stream 0 is used, so stream 1 is the only new one offered
+  SDP::State state = initial.apply(AssignOpStream(k1, Stream(0)));
+  expected = {{"k2", 0}, {"k2", 1}};
+  CHECK(assigned(state.get_decisions(plat)) == expected);
+
+  // streams used before the first unused one are all offered
+  state = initial.apply(AssignOpStream(k1, Stream(2)));
+  expected = {{"k2", 0}, {"k2", 2}};
+  CHECK(assigned(state.get_decisions(plat)) == expected);
+}
+
+TEST_CASE("[cpu]" " " "search state apply and undo") {
+  // start -> a -> k1 -> finish
+  //       -> b -> k2 ->
+  Graph<OpBase> graph;
+  auto a = std::make_shared<NoOp>("a");
+  auto b = std::make_shared<NoOp>("b");
+  auto k1 = std::make_shared<Kernel>("k1");
+  auto k2 = std::make_shared<Kernel>("k2");
+  graph.start_then(a);
+  graph.start_then(b);
+  graph.then(a, k1);
+  graph.then(b, k2);
+  graph.then_finish(k1);
+  graph.then_finish(k2);
+
+  Platform plat(MPI_COMM_WORLD);
+  for (Stream::id_t i = 0; i < 2; ++i) {
+    plat.streams_.push_back(Stream(i));
+  }
+
+  // complete sequences from copying states
+  std::function<size_t(const SDP::State &)> countCopies = [&](const SDP::State &state) {
+    std::vector<SDP::State> frontier = SDP::State(state).frontier(plat);
+    size_t n = frontier.empty() && state.complete();
+    for (const SDP::State &next : frontier) {
+      n += countCopies(next);
+    }
+    return n;
+  };
+
+  // complete sequences from one state, checking that undo() restores it
+  std::function<size_t(SDP::SearchState &)> countInPlace = [&](SDP::SearchState &state) {
+    const SDP::Fingerprint before = state.state().fingerprint();
+    const size_t depth = state.depth();
+    std::vector<Decision> decisions = state.state().get_decisions(plat);
+    size_t n = decisions.empty() && state.state().complete();
+    std::unordered_set<SDP::Fingerprint, SDP::Fingerprint::Hash> seen;
+    for (size_t i = 0; i < decisions.size(); ++i) {
+      state.apply(decisions, i);
+      REQUIRE(state.depth() == depth + 1);
+      if (seen.insert(state.state().fingerprint()).second) {
+        n += countInPlace(state);
+      }
+      state.undo();
+      REQUIRE(state.state().fingerprint() == before);
+      REQUIRE(state.state().get_decisions(plat).size() == decisions.size());
+    }
+    return n;
+  };
+
+  for (bool por : {false, true}) {
+    SDP::State initial(graph);
+    initial.set_partial_order_reduction(por);
+    SDP::SearchState state(initial);
+    const size_t copies = countCopies(initial);
+    CHECK(copies > 0);
+    CHECK(countInPlace(state) == copies);
+    CHECK(state.depth() == 0);
+    CHECK(state.state().sequence().size() == 1);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
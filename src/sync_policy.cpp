@@ -0,0 +1,205 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/sync_policy.hpp"
+
+#include "tenzing/event_synchronizer.hpp"
+#include "tenzing/stream_synchronizer.hpp"
+
+const char *to_string(SyncPolicy policy) {
+  switch (policy) {
+  case SyncPolicy::event:
+    return "event";
+  case SyncPolicy::stream_sync:
+    return "stream_sync";
+  case SyncPolicy::stream_wait:
+    return "stream_wait";
+  case SyncPolicy::search:
+    return "search";
+  }
+  THROW_RUNTIME("unexpected SyncPolicy");
+}
+
+void to_json(nlohmann::json &j, const SyncPolicy &policy) { j = to_string(policy); }
+
+void from_json(const nlohmann::json &j, SyncPolicy &policy) {
+  const std::string s = j;
+  for (SyncPolicy p : {SyncPolicy::event, SyncPolicy::stream_sync, SyncPolicy::stream_wait,
+                       SyncPolicy::search}) {
+    if (s == to_string(p)) {
+      policy = p;
+      return;
+    }
+  }
+  THROW_RUNTIME("unexpected SyncPolicy '" << s << "'");
+}
+
+bool is_synced(const std::shared_ptr<BoundOp> &bo, const Graph<OpBase> &g,
+               const HappensBefore &hb) {
+  return EventSynchronizer::is_synced(bo, g, hb);
+}
+
+std::vector<std::shared_ptr<BoundOp>> make_syncs(SyncPolicy policy,
+                                                 const std::shared_ptr<BoundOp> &bo,
+                                                 const Graph<OpBase> &g, const HappensBefore &hb) {
+  switch (policy) {
+  case SyncPolicy::event:
+    return EventSynchronizer::make_syncs(bo, g, hb);
+  case SyncPolicy::stream_sync:
+    return StreamSyncSynchronizer::make_syncs(bo, g, hb);
+  case SyncPolicy::stream_wait:
+    return StreamWaitSynchronizer::make_syncs(bo, g, hb);
+  case SyncPolicy::search: {
+    std::vector<std::shared_ptr<BoundOp>> syncs;
+    for (SyncPolicy p : {SyncPolicy::event, SyncPolicy::stream_sync, SyncPolicy::stream_wait}) {
+      for (const std::shared_ptr<BoundOp> &sync : make_syncs(p, bo, g, hb)) {
+        bool dup = false;
+        for (const std::shared_ptr<BoundOp> &s : syncs) {
+          dup = dup || s->eq(sync);
+        }
+        if (!dup) {
+          syncs.push_back(sync);
+        }
+      }
+    }
+    return syncs;
+  }
+  }
+  THROW_RUNTIME("unexpected SyncPolicy");
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include "tenzing/test_ops.hpp"
+
+#include "tenzing/state.hpp"
+
+#include <functional>
+
+using test_ops::Kernel;
+
+TEST_CASE("[cpu]" " " "sync policies") {
+  // start -> a (stream 0) -> b (stream 1) -> c -> finish
+  Graph<OpBase> graph;
+  auto a = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("a"), Stream(0));
+  auto b = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("b"), Stream(1));
+  auto c = std::make_shared<NoOp>("c");
+  graph.start_then(a);
+  graph.then(a, b);
+  graph.then(b, c);
+  graph.then_finish(c);
+
+  Platform plat(MPI_COMM_WORLD);
+  for (Stream::id_t i = 0; i < 2; ++i) {
+    plat.streams_.push_back(Stream(i));
+  }
+
+  SUBCASE("make syncs") {
+    auto start = std::dynamic_pointer_cast<BoundOp>(graph.start());
+    const HappensBefore hb(Sequence<BoundOp>({start, a}));
+    REQUIRE(!is_synced(b, graph, hb));
+
+    std::vector<std::shared_ptr<BoundOp>> syncs = make_syncs(SyncPolicy::event, b, graph, hb);
+    REQUIRE(syncs.size() == 1);
+    CHECK(std::dynamic_pointer_cast<CudaEventRecord>(syncs[0]));
+
+    syncs = make_syncs(SyncPolicy::stream_sync, b, graph, hb);
+    REQUIRE(syncs.size() == 1);
+    CHECK(syncs[0]->eq(std::make_shared<StreamSync>(Stream(0))));
+
+    syncs = make_syncs(SyncPolicy::stream_wait, b, graph, hb);
+    REQUIRE(syncs.size() == 1);
+    auto sw = std::dynamic_pointer_cast<StreamWait>(syncs[0]);
+    REQUIRE(sw);
+    CHECK(sw->waitee() == Stream(0));
+    CHECK(sw->waiter() == Stream(1));
+
+    CHECK(make_syncs(SyncPolicy::search, b, graph, hb).size() == 3);
+  }
+
+  // follow the first decision until there are none
+  auto greedy = [&](SyncPolicy policy) {
+    SDP::State state(graph);
+    state.set_sync_policy(policy);
+    for (std::vector<Decision> ds = state.get_decisions(plat); !ds.empty();
+         ds = state.get_decisions(plat)) {
+      state = state.apply(ds[0]);
+    }
+    REQUIRE(state.complete());
+    return state.sequence();
+  };
+
+  // the kinds of sync operations in seq
+  auto kinds = [](const Sequence<BoundOp> &seq) {
+    std::vector<std::string> ret;
+    for (const auto &op : seq) {
+      if (std::dynamic_pointer_cast<CudaEventRecord>(op)) {
+        ret.push_back("CER");
+      } else if (std::dynamic_pointer_cast<CudaStreamWaitEvent>(op)) {
+        ret.push_back("CSWE");
+      } else if (std::dynamic_pointer_cast<CudaEventSync>(op)) {
+        ret.push_back("CES");
+      } else if (std::dynamic_pointer_cast<StreamSync>(op)) {
+        ret.push_back("StreamSync");
+      } else if (std::dynamic_pointer_cast<StreamWait>(op)) {
+        ret.push_back("StreamWait");
+      }
+    }
+    return ret;
+  };
+
+  SUBCASE("event") {
+    CHECK(kinds(greedy(SyncPolicy::event)) ==
+          std::vector<std::string>{"CER", "CSWE", "CER", "CES"});
+  }
+
+  SUBCASE("stream sync") {
+    CHECK(kinds(greedy(SyncPolicy::stream_sync)) ==
+          std::vector<std::string>{"StreamSync", "StreamSync"});
+  }
+
+  SUBCASE("stream wait") {
+    CHECK(kinds(greedy(SyncPolicy::stream_wait)) ==
+          std::vector<std::string>{"StreamWait", "CER", "CES"});
+  }
+
+  SUBCASE("search") {
+    // complete sequences reachable from state
+    std::function<size_t(const SDP::State &)> count = [&](const SDP::State &state) {
+      std::vector<SDP::State> frontier = SDP::State(state).frontier(plat);
+      size_t n = frontier.empty() && state.complete();
+      for (const SDP::State &next : frontier) {
+        n += count(next);
+      }
+      return n;
+    };
+
+    size_t total = 0;
+    for (SyncPolicy policy :
+         {SyncPolicy::event, SyncPolicy::stream_sync, SyncPolicy::stream_wait}) {
+      SDP::State state(graph);
+      state.set_sync_policy(policy);
+      const size_t n = count(state);
+      CHECK(n > 0);
+      total += n;
+    }
+
+    // every policy's sequences, and mixes of them
+    SDP::State state(graph);
+    state.set_sync_policy(SyncPolicy::search);
+    CHECK(count(state) > total);
+  }
+
+  SUBCASE("json") {
+    for (SyncPolicy policy : {SyncPolicy::event, SyncPolicy::stream_sync, SyncPolicy::stream_wait,
+                              SyncPolicy::search}) {
+      nlohmann::json j = policy;
+      CHECK(j.get<SyncPolicy>() == policy);
+    }
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
@@ -0,0 +1,207 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+#include "tenzing/trace.hpp"
+
+#include <algorithm>
+
+Trace::Trace(size_t capacity, int rank, bool gpuEvents)
+    : slots_(capacity), next_(0), count_(0), rank_(rank), gpuEvents_(gpuEvents),
+      epoch_(std::chrono::steady_clock::now()) {
+  if (0 == capacity) {
+    THROW_RUNTIME("trace needs room for at least one record");
+  }
+  for (Slot &slot : slots_) {
+    slot.pending = false;
+    if (gpuEvents_) {
+      CUDA_RUNTIME(cudaEventCreate(&slot.start));
+      CUDA_RUNTIME(cudaEventCreate(&slot.stop));
+    }
+  }
+}
+
+Trace::~Trace() {
+  if (gpuEvents_) {
+    for (Slot &slot : slots_) {
+      CUDA_RUNTIME(cudaEventDestroy(slot.start));
+      CUDA_RUNTIME(cudaEventDestroy(slot.stop));
+    }
+  }
+}
+
+void Trace::resolve(Slot &slot) {
+  float ms;
+  CUDA_RUNTIME(cudaEventSynchronize(slot.stop));
+  CUDA_RUNTIME(cudaEventElapsedTime(&ms, slot.start, slot.stop));
+  slot.record.gpu = ms / 1e3;
+  slot.pending = false;
+}
+
+std::vector<Trace::Record> Trace::records() {
+  std::vector<Record> ret;
+  const size_t n = std::min(count_, slots_.size());
+  // the oldest record is at next_ once the buffer has wrapped
+  const size_t first = count_ > slots_.size() ? next_ : 0;
+  for (size_t i = 0; i < n; ++i) {
+    Slot &slot = slots_[(first + i) % slots_.size()];
+    if (slot.pending) {
+      resolve(slot);
+    }
+    ret.push_back(slot.record);
+  }
+  return ret;
+}
+
+std::map<std::string, Benchmark::Result> fit_op_times(const CompiledSequence &cs,
+                                                      const std::vector<Trace::Record> &records,
+                                                      Benchmark::Result *launch) {
+  std::map<std::string, std::vector<double>> times;
+  std::vector<double> launches;
+  for (const Trace::Record &r : records) {
+    if (r.seq != cs.id()) {
+      continue;
+    }
+    if (r.index >= cs.instrs().size()) {
+      THROW_RUNTIME("trace record for instruction " << r.index << " of a sequence with "
+                                                    << cs.instrs().size());
+    }
+    const CompiledSequence::Instr &in = cs.instrs()[r.index];
+    if (r.gpu >= 0) {
+      times[in.op->name()].push_back(r.gpu);
+    } else if (CompiledSequence::Instr::Kind::gpu == in.kind) {
+      launches.push_back(r.stop - r.start);
+    } else {
+      times[in.op->name()].push_back(r.stop - r.start);
+    }
+  }
+
+  std::map<std::string, Benchmark::Result> ret;
+  for (auto &kv : times) {
+    ret[kv.first] = Benchmark::summarize(kv.second);
+  }
+  if (launch) {
+    *launch = launches.empty() ? Benchmark::Result() : Benchmark::summarize(launches);
+  }
+  return ret;
+}
+
+void calibrate(SimulatedBenchmarker::Model &model,
+               const std::map<std::string, Benchmark::Result> &times,
+               const Benchmark::Result *launch) {
+  for (const auto &kv : times) {
+    model.times[kv.first] = kv.second.pct50;
+  }
+  if (launch && launch->nIters > 0) {
+    model.launch = launch->pct50;
+  }
+}
+
+#if TENZING_ENABLE_TESTS == 1
+#include <doctest/doctest.hpp>
+
+#include <thread>
+
+// events around GPU operations are tested in test/test_gpu_trace.cu
+TEST_CASE("[cpu]" " " "trace") {
+  // takes about `secs` on the host
+  struct Sleep : public CpuOp {
+    std::string name_;
+    double secs_;
+    Sleep(const std::string &name, double secs) : name_(name), secs_(secs) {}
+    void run(Platform &) override {
+      std::this_thread::sleep_for(std::chrono::duration<double>(secs_));
+    }
+    std::string name() const override { return name_; }
+    bool operator<(const Sleep &rhs) const { return name_ < rhs.name_; }
+    bool operator==(const Sleep &rhs) const { return name_ == rhs.name_; }
+    CLONE_DEF(Sleep);
+    LT_DEF(Sleep);
+    EQ_DEF(Sleep);
+  };
+
+  Platform plat(MPI_COMM_WORLD);
+  auto fast = std::make_shared<Sleep>("fast", 0);
+  auto slow = std::make_shared<Sleep>("slow", 2e-3);
+  Sequence<BoundOp> seq({std::make_shared<Start>(), fast, slow, std::make_shared<Finish>()});
+  CompiledSequence cs = CompiledSequence::compile(seq, plat);
+  REQUIRE(cs.instrs().size() == 2);
+
+  SUBCASE("records") {
+    Trace trace(10, 3);
+    cs.run(plat, trace);
+    cs.run(plat, trace);
+    std::vector<Trace::Record> records = trace.records();
+    REQUIRE(records.size() == 4);
+    CHECK(trace.dropped() == 0);
+    for (size_t i = 0; i < records.size(); ++i) {
+      CHECK(records[i].seq == cs.id());
+      CHECK(records[i].index == i % 2);
+      CHECK(records[i].rank == 3);
+      CHECK(records[i].gpu == -1);
+      CHECK(records[i].start <= records[i].stop);
+      if (i > 0) {
+        CHECK(records[i - 1].stop <= records[i].start);
+      }
+    }
+    CHECK(records[1].stop - records[1].start >= 2e-3);
+  }
+
+  SUBCASE("ring buffer keeps the latest") {
+    Trace trace(3);
+    cs.run(plat, trace);
+    cs.run(plat, trace);
+    CHECK(trace.dropped() == 1);
+    std::vector<Trace::Record> records = trace.records();
+    REQUIRE(records.size() == 3);
+    CHECK(records[0].index == 1);
+    CHECK(records[1].index == 0);
+    CHECK(records[2].index == 1);
+    trace.clear();
+    CHECK(trace.records().empty());
+  }
+
+  SUBCASE("fit") {
+    Trace trace(100);
+    for (int i = 0; i < 10; ++i) {
+      cs.run(plat, trace);
+    }
+    std::map<std::string, Benchmark::Result> times = fit_op_times(cs, trace.records());
+    REQUIRE(times.size() == 2);
+    CHECK(times["fast"].pct50 < times["slow"].pct50);
+    CHECK(times["slow"].pct01 >= 2e-3);
+
+    SimulatedBenchmarker::Model model;
+    calibrate(model, times);
+    CHECK(model.times["slow"] == times["slow"].pct50);
+    SimulatedBenchmarker sim(model);
+    CHECK(sim.simulate(seq) == doctest::Approx(times["fast"].pct50 + times["slow"].pct50));
+
+    // no GPU operations to time a launch from
+    Benchmark::Result launch;
+    fit_op_times(cs, trace.records(), &launch);
+    CHECK(launch.nIters == 0);
+    calibrate(model, times, &launch);
+    CHECK(model.launch == SimulatedBenchmarker::Model().launch);
+  }
+
+  SUBCASE("fit one sequence of several") {
+    // the same operations, so only the sequence id tells their records apart
+    CompiledSequence reversed = CompiledSequence::compile(Sequence<BoundOp>({slow, fast}), plat);
+    REQUIRE(reversed.id() != cs.id());
+    Trace trace(100);
+    for (int i = 0; i < 5; ++i) {
+      cs.run(plat, trace);
+      reversed.run(plat, trace);
+    }
+    std::map<std::string, Benchmark::Result> times = fit_op_times(cs, trace.records());
+    REQUIRE(times.size() == 2);
+    CHECK(times["fast"].nIters == 5);
+    CHECK(times["slow"].nIters == 5);
+    CHECK(times["fast"].pct50 < times["slow"].pct50);
+    CHECK(fit_op_times(reversed, trace.records())["slow"].pct01 >= 2e-3);
+  }
+}
+
+#endif // TENZING_ENABLE_TESTS == 1
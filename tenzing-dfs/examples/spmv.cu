@@ -6,6 +6,8 @@
 /*! \file
  */
 
+#include <argparse/argparse.hpp>
+
 #include "tenzing/benchmarker.hpp"
 #include "tenzing/cuda/cuda_runtime.hpp"
 #include "tenzing/graph.hpp"
@@ -52,6 +54,24 @@ int main(int argc, char **argv) {
     tenzing::reproduce::dump_with_cli(argc, argv);
   }
 
+  tenzing::dfs::Opts opts;
+  opts.benchOpts.nIters = 50;
+  opts.maxSeqs = 15000; // only generate 15k non-unique sequences before terminating DFS
+
+  std::string resultsPath;
+  argparse::Parser parser("SpMV design-space exploration using depth-first search");
+  parser.add_option(resultsPath, "--results")
+      ->help("also write the results to this ResultFile");
+  parser.add_option(opts.cachePath, "--cache")
+      ->help("reuse benchmark results from, and save them to, this file");
+  parser.add_option(opts.cacheTag, "--cache-tag")
+      ->help("identifies this machine among the results in the cache");
+  parser.no_unrecognized();
+  if (!parser.parse(argc, argv)) {
+    std::cerr << parser.help();
+    exit(EXIT_FAILURE);
+  }
+
   MPI_Barrier(MPI_COMM_WORLD);
 
   {
@@ -112,12 +132,12 @@ int main(int argc, char **argv) {
 
   EmpiricalBenchmarker benchmarker;
 
-  tenzing::dfs::Opts opts;
-  opts.benchOpts.nIters = 50;
-  opts.maxSeqs = 15000; // only generate 15k non-unique sequences before terminating DFS
-
   tenzing::dfs::Result result = tenzing::dfs::explore(orig, plat, benchmarker, opts);
 
-  if (0 == rank)
+  if (0 == rank) {
     result.dump_csv();
+    if (!resultsPath.empty()) {
+      result.dump_results(resultsPath);
+    }
+  }
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include "tenzing/benchmark_cache.hpp"
 #include "tenzing/benchmarker.hpp"
 #include "tenzing/cuda/ops_cuda.hpp"
 #include "tenzing/graph.hpp"
@@ -26,9 +27,13 @@ namespace dfs {
 struct Opts {
   int64_t maxSeqs; /// generate no more than this many sequences during DFS traversal. Some of these
                    /// sequences may be equivalent. Negative numbers mean unlimited.
+  bool partialOrderReduction; /// only generate one order of independent operations
+  SyncPolicy syncPolicy;      /// how to synchronize operations, SyncPolicy::search for all ways
   Benchmark::Opts benchOpts;
+  std::string cachePath; /// if not empty, reuse and save results in this BenchmarkCache file
+  std::string cacheTag;  /// identifies the machine in the cache's benchmark_signature()
 
-  Opts() : maxSeqs(-1) {}
+  Opts() : maxSeqs(-1), partialOrderReduction(false), syncPolicy(SyncPolicy::event) {}
 };
 void to_json(nlohmann::json &j, const Opts &opts);
 
@@ -41,6 +46,7 @@ struct Result {
   std::vector<SimResult> simResults;
   Opts opts_; /// options used to generate this result
   void dump_csv() const; // dump CSV to stdout
+  void dump_results(const std::string &path) const; // write a ResultFile
 
   Result() = delete;
   Result(const Opts &opts) : opts_(opts) {}
@@ -72,12 +78,17 @@ struct Stop {
 std::vector<Sequence<BoundOp>> get_all_sequences(
     const Graph<OpBase> &g, Platform &plat,
     int64_t maxSeqs =
-        -1 /// return once this many sequences have been generated. Negative is unlimited.
+        -1, /// return once this many sequences have been generated. Negative is unlimited.
+    bool partialOrderReduction =
+        false, /// skip sequences that only reorder independent operations, see SDP::State
+    SyncPolicy syncPolicy = SyncPolicy::event /// how to synchronize operations
 );
 
+/* benchmark with `benchmarker` itself, ignoring opts.cachePath
+ */
 template <typename Benchmarker>
-Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
-               const Opts &opts = Opts()) {
+Result explore_uncached(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
+                        const Opts &opts = Opts()) {
 
   int rank = 0, size = 1;
   MPI_Comm_rank(plat.comm(), &rank);
@@ -88,7 +99,7 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
   std::vector<Sequence<BoundOp>> seqs;
   if (0 == rank) {
     // generate all sequences
-    seqs = get_all_sequences(g, plat, opts.maxSeqs);
+    seqs = get_all_sequences(g, plat, opts.maxSeqs, opts.partialOrderReduction, opts.syncPolicy);
 
     // remove equivalent sequences
     STDERR("remove equivalent sequences");
@@ -142,29 +153,9 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
     }
     sut = mpi_bcast(sut, g, plat.comm());
 
-    // provision resources for this program
-    {
-      eventPool.reset();
-      ResourceMap rMap;
-      {
-        std::vector<HasEvent *> ops;
-
-        for (const auto &op : sut) {
-          if (HasEvent *he = dynamic_cast<HasEvent *>(op.get())) {
-            ops.push_back(he);
-          }
-        }
-
-        for (HasEvent *op : ops) {
-          for (Event event : op->get_events()) {
-            if (!rMap.contains(event)) {
-              rMap.insert(event, eventPool.new_event());
-            }
-          }
-        }
-      }
-      plat.resource_map() = rMap;
-    }
+    // provision resources for this program. Events whose lifetimes don't overlap share a
+    // cudaEvent_t, but keep their ids, so the recorded sequence matches results from other runs
+    plat.resource_map() = provision_events(sut, eventPool);
 
     // STDERR("benchmark");
 
@@ -176,5 +167,25 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
   unregister_handler();
   return res;
 }
+
+/* benchmark with `benchmarker` through a CachingBenchmarker if opts.cachePath is set
+ */
+template <typename Benchmarker>
+Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
+               const Opts &opts = Opts()) {
+  if (opts.cachePath.empty()) {
+    return explore_uncached(g, plat, benchmarker, opts);
+  }
+  CachingBenchmarker<Benchmarker> cached(benchmarker, opts.cachePath,
+                                         benchmark_signature(g, plat, opts.cacheTag));
+  Result res = explore_uncached(g, plat, cached, opts);
+
+  int rank = 0;
+  MPI_Comm_rank(plat.comm(), &rank);
+  if (0 == rank) {
+    STDERR("benchmark cache: " << cached.hits() << " hits, " << cached.misses() << " misses");
+  }
+  return res;
+}
 } // namespace dfs
 } // namespace tenzing
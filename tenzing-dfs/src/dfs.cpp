@@ -5,79 +5,76 @@
 
 #include "tenzing/dfs/dfs.hpp"
 
+#include "tenzing/result_file.hpp"
+
+#include <unordered_set>
+
 namespace tenzing {
 namespace dfs {
 
 void to_json(nlohmann::json &j, const Opts &opts) {
   j.clear();
   j["dfs__Opts"]["maxSeqs"] = opts.maxSeqs;
+  j["dfs__Opts"]["partialOrderReduction"] = opts.partialOrderReduction;
+  j["dfs__Opts"]["syncPolicy"] = opts.syncPolicy;
+  j["dfs__Opts"]["cachePath"] = opts.cachePath;
+  j["dfs__Opts"]["cacheTag"] = opts.cacheTag;
 }
 
-std::vector<Sequence<BoundOp>> get_all_sequences(const Graph<OpBase> &g, Platform &plat,
-                                                 int64_t maxSeqs) {
-  std::vector<SDP::State> worklist;
-  std::vector<Sequence<BoundOp>> ret;
-
-  auto boundStart = std::dynamic_pointer_cast<BoundOp>(g.start());
-  if (!boundStart) {
-    THROW_RUNTIME("");
-  }
+namespace {
 
-  SDP::State initial(g, {boundStart});
-  worklist.push_back(initial);
+/* add every complete sequence reachable from state to ret, depth first.
+   state is modified in place and restored before returning
+*/
+void visit(SDP::SearchState &state, Platform &plat, int64_t maxSeqs,
+           std::vector<Sequence<BoundOp>> &ret) {
 
-  while (!worklist.empty()) {
+  if (maxSeqs >= 0 && int64_t(ret.size()) >= maxSeqs) {
+    return;
+  }
 
-    STDERR("get_all_sequences: worklist " << worklist.size() << " complete " << ret.size());
+  std::vector<Decision> decisions = state.state().get_decisions(plat);
 
-    if (ret.size() >= maxSeqs) {
-      break;
+  if (decisions.empty()) {
+    // with partial-order reduction, a state may be a dead end that another branch completes
+    if (state.state().complete()) {
+      ret.push_back(state.state().sequence());
+      STDERR("get_all_sequences: depth " << state.depth() << " complete " << ret.size());
     }
+    return;
+  }
 
-    // DFS
-    SDP::State curr = worklist.back();
-    worklist.pop_back();
-
-    // get the frontier from the current state
-    std::vector<SDP::State> frontier = curr.frontier(plat, true);
-
-    // especially at the beginning of the search, some elements in the frontier may be equivalent
-    // no need to search them all
-    {
-      size_t numEq = 0;
-      for (auto fi = frontier.begin(); fi < frontier.end(); ++fi) {
-        for (auto fj = fi + 1; fj < frontier.end(); ++fj) {
-          if (get_equivalence(*fi, *fj)) {
-            frontier.erase(fj);
-            ++numEq;
-            --fj;
-          }
-        }
-      }
-      STDERR(numEq << " equivalents removed");
+  // like State::frontier(), only visit the first of any equivalent states
+  std::unordered_set<SDP::Fingerprint, SDP::Fingerprint::Hash> seen;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    state.apply(decisions, i);
+    if (seen.insert(state.state().fingerprint()).second) {
+      visit(state, plat, maxSeqs, ret);
     }
+    state.undo();
+  }
+}
 
-#if 0
-    {
-      std::string s;
-      for (const auto &op : frontier) {
-        s += op->desc();
-        s += ", ";
-      }
-      STDERR("get_all_sequences: graph frontier is: " << s);
-    }
-#endif
+} // namespace
 
-    if (frontier.empty()) { // this state is complete
-      ret.push_back(curr.sequence());
-    } else {
+std::vector<Sequence<BoundOp>> get_all_sequences(const Graph<OpBase> &g, Platform &plat,
+                                                 int64_t maxSeqs, bool partialOrderReduction,
+                                                 SyncPolicy syncPolicy) {
+  std::vector<Sequence<BoundOp>> ret;
 
-      for (const SDP::State &state : frontier) {
-        worklist.push_back(state);
-      }
-    }
+  auto boundStart = std::dynamic_pointer_cast<BoundOp>(g.start());
+  if (!boundStart) {
+    THROW_RUNTIME("");
   }
 
+  SDP::State initial(g, {boundStart});
+  initial.set_partial_order_reduction(partialOrderReduction);
+  initial.set_sync_policy(syncPolicy);
+
+  // apply and undo decisions on a single state, so memory grows with the depth of the search
+  SDP::SearchState state(initial);
+  visit(state, plat, maxSeqs, ret);
+
   return ret;
 }
 
@@ -104,5 +101,14 @@ void Result::dump_csv() const {
   }
 }
 
+void Result::dump_results(const std::string &path) const {
+  nlohmann::json optsJson = opts_;
+  ResultFileWriter writer(optsJson.dump());
+  for (const SimResult &simres : simResults) {
+    writer.add(simres.benchResult, simres.seq);
+  }
+  writer.write(path);
+}
+
 } // namespace dfs
 } // namespace tenzing
\ No newline at end of file
@@ -5,10 +5,13 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <mpi.h>
 
+#include <argparse/argparse.hpp>
+
 #include "tenzing/halo_exchange/ops_halo_exchange.hpp"
 #include "tenzing/init.hpp"
 #include "tenzing/numeric.hpp"
@@ -19,8 +22,6 @@
 #include "tenzing/mcts/mcts.hpp"
 
 template <typename Strategy> int doit(int argc, char **argv) {
-  (void)argc;
-  (void)argv;
 
   typedef HaloExchange::StorageOrder StorageOrder;
   typedef HaloExchange::Args Args;
@@ -35,6 +36,24 @@ template <typename Strategy> int doit(int argc, char **argv) {
     tenzing::reproduce::dump_with_cli(argc, argv);
   }
 
+  tenzing::mcts::Opts opts;
+  opts.benchOpts.nIters = 50;
+  opts.dumpTreePrefix = "halo";
+
+  std::string resultsPath;
+  argparse::Parser parser("halo exchange design-space exploration using monte-carlo tree search");
+  parser.add_option(resultsPath, "--results")
+      ->help("also write the results to this ResultFile");
+  parser.add_option(opts.cachePath, "--cache")
+      ->help("reuse benchmark results from, and save them to, this file");
+  parser.add_option(opts.cacheTag, "--cache-tag")
+      ->help("identifies this machine among the results in the cache");
+  parser.no_unrecognized();
+  if (!parser.parse(argc, argv)) {
+    std::cerr << parser.help();
+    exit(EXIT_FAILURE);
+  }
+
 
 
   typedef double Real;
@@ -149,15 +168,14 @@ template <typename Strategy> int doit(int argc, char **argv) {
   Platform platform = Platform::make_n_streams(2, MPI_COMM_WORLD);
   EmpiricalBenchmarker benchmarker;
 
-  tenzing::mcts::Opts opts;
-  opts.benchOpts.nIters = 50;
-  opts.dumpTreePrefix = "halo";
-
   STDERR("mcts...");
   tenzing::mcts::Result result =
       tenzing::mcts::explore<Strategy>(orig, platform, benchmarker, opts);
 
   result.dump_csv();
+  if (0 == rank && !resultsPath.empty()) {
+    result.dump_results(resultsPath);
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -47,12 +47,23 @@ template <typename Strategy> int doit(tenzing::mcts::Opts &opts, int argc, char
   int m = 150000; // matrix size
 
   bool noExpandRollout = false;
+  std::string resultsPath;
   argparse::Parser parser("SpMV design-space exporation using monte-carlo tree search");
   parser.add_option(opts.nIters, "--mcts-iters", "-i")->help("how many MCTS iterations to do");
   parser.add_option(opts.benchOpts.nIters, "--benchmark-iters", "-b")
       ->help("how many benchmark measurements to do.");
+  parser.add_option(opts.benchOpts.racing.pct, "--race-pct")
+      ->help("stop measuring schedules that are clearly slower at this percentile (0 to disable)");
   parser.add_option(m, "--matrix-m", "-m")->help("random matrix dimension");
   parser.add_flag(noExpandRollout, "--no-expand-rollout")->help("don't expand rollout");
+  parser.add_flag(opts.transpositions, "--transpositions")
+      ->help("share tree nodes between decision orders that reach equivalent states");
+  parser.add_option(resultsPath, "--results")
+      ->help("also write the results to this ResultFile");
+  parser.add_option(opts.cachePath, "--cache")
+      ->help("reuse benchmark results from, and save them to, this file");
+  parser.add_option(opts.cacheTag, "--cache-tag")
+      ->help("identifies this machine among the results in the cache");
   parser.no_unrecognized();
 
   if (!parser.parse(argc, argv)) {
@@ -127,8 +138,12 @@ template <typename Strategy> int doit(tenzing::mcts::Opts &opts, int argc, char
   STDERR("mcts...");
 
   tenzing::mcts::Result result = tenzing::mcts::explore<Strategy>(orig, platform, benchmarker, opts);
-  if (0 == rank)
+  if (0 == rank) {
     result.dump_csv();
+    if (!resultsPath.empty()) {
+      result.dump_results(resultsPath);
+    }
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -8,10 +8,12 @@
 #include <chrono>
 #include <fstream>
 #include <functional>
+#include <set>
 #include <vector>
 
 #include "mpi.h"
 
+#include "tenzing/benchmark_cache.hpp"
 #include "tenzing/cast.hpp"
 #include "tenzing/graph.hpp"
 #include "tenzing/numeric.hpp"
@@ -35,6 +37,7 @@ typedef std::chrono::duration<double> Duration;
 struct Result {
   std::vector<SimResult> simResults;
   void dump_csv() const; // dump CSV to stdout
+  void dump_results(const std::string &path) const; // write a ResultFile
 };
 
 /* options for MCTS
@@ -44,9 +47,15 @@ struct Opts {
   bool dumpTree;              // dump the tree dot files every so often
   std::string dumpTreePrefix; // prefix to use for the tree
   bool expandRollout;         // expand the rollout nodes in the tree
+  bool transpositions;        // share one node between decision orders reaching equivalent states
+  SyncPolicy syncPolicy;      // how to synchronize operations, SyncPolicy::search to search for it
   Benchmark::Opts benchOpts;  // options for the runs
+  std::string cachePath;      // if not empty, reuse and save results in this BenchmarkCache file
+  std::string cacheTag;       // identifies the machine in the cache's benchmark_signature()
 
-  Opts() : dumpTree(true), expandRollout(true) {}
+  Opts()
+      : dumpTree(true), expandRollout(true), transpositions(false),
+        syncPolicy(SyncPolicy::event) {}
 };
 
 template <typename Strategy>
@@ -65,7 +74,13 @@ void dump_graphviz(const std::string &path, const Node<Strategy> &root) {
   bool hideChildrenOneRollout = true;   // hide children of nodes with one rollout
   bool hideNoRollouts = true;           // hide nodes with 0 rollouts
 
+  // nodes may be shared by several parents, only dump them once
+  std::set<const Node *> dumpedNodes, dumpedEdges;
+
   std::function<void(const Node &)> dump_nodes = [&](const Node &node) -> void {
+    if (!dumpedNodes.insert(&node).second) {
+      return;
+    }
     os << "node_" << &node << " [label=\"";
     os << node.graphviz_name();
     os << "\n"
@@ -98,6 +113,9 @@ void dump_graphviz(const std::string &path, const Node<Strategy> &root) {
 
   // print the edges from the node to its children
   std::function<void(const Node &)> dump_edges = [&](const Node &node) -> void {
+    if (!dumpedEdges.insert(&node).second) {
+      return;
+    }
     // if hiding children, the children nodes will not be created so don't draw edges
     if (hideChildrenFullyVisited && node.fullyVisited_) {
       return;
@@ -151,9 +169,11 @@ struct Stop {
   }
 };
 
+/* search with `benchmarker` itself, ignoring opts.cachePath
+ */
 template <typename Strategy, typename Benchmarker>
-Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
-               const Opts &opts = Opts()) {
+Result explore_uncached(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
+                        const Opts &opts = Opts()) {
 
   using Context = typename Strategy::Context;
   using Node = Node<Strategy>;
@@ -165,7 +185,11 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
   Node root;
   if (0 == rank) {
     STDERR("create root...");
-    root = Node(g, TENZING_MUST_CAST(BoundOp, g.start_));
+    root = Node(g, TENZING_MUST_CAST(BoundOp, g.start()));
+    if (opts.transpositions) {
+      root.transpositions_ = std::make_shared<typename Node::Transpositions>();
+    }
+    root.syncPolicy_ = opts.syncPolicy;
   }
   MPI_Barrier(plat.comm());
 
@@ -243,29 +267,11 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
       STDERR("bcast sequence");
     order = mpi_bcast(order, g, plat.comm());
 
-    // provision resources for this program
+    // provision resources for this program. Events whose lifetimes don't overlap share a
+    // cudaEvent_t, but keep their ids, so the recorded order matches results from other runs
     {
       TENZING_COUNTER_EXPR(double start = MPI_Wtime());
-      eventPool.reset();
-      ResourceMap rMap;
-      {
-        std::vector<HasEvent *> ops;
-
-        for (const auto &op : order) {
-          if (HasEvent *he = dynamic_cast<HasEvent *>(op.get())) {
-            ops.push_back(he);
-          }
-        }
-
-        for (HasEvent *op : ops) {
-          for (Event event : op->get_events()) {
-            if (!rMap.contains(event)) {
-              rMap.insert(event, eventPool.new_event());
-            }
-          }
-        }
-      }
-      plat.resource_map() = rMap;
+      plat.resource_map() = provision_events(order, eventPool);
       TENZING_COUNTER_OP(mcts, RMAP_TIME, += MPI_Wtime() - start);
     }
 
@@ -325,4 +331,24 @@ Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
   return result;
 }
 
+/* search, benchmarking with `benchmarker` through a CachingBenchmarker if opts.cachePath is set
+ */
+template <typename Strategy, typename Benchmarker>
+Result explore(const Graph<OpBase> &g, Platform &plat, Benchmarker &benchmarker,
+               const Opts &opts = Opts()) {
+  if (opts.cachePath.empty()) {
+    return explore_uncached<Strategy>(g, plat, benchmarker, opts);
+  }
+  CachingBenchmarker<Benchmarker> cached(benchmarker, opts.cachePath,
+                                         benchmark_signature(g, plat, opts.cacheTag));
+  Result result = explore_uncached<Strategy>(g, plat, cached, opts);
+
+  int rank;
+  MPI_Comm_rank(plat.comm(), &rank);
+  if (0 == rank) {
+    STDERR("benchmark cache: " << cached.hits() << " hits, " << cached.misses() << " misses");
+  }
+  return result;
+}
+
 } // namespace tenzing::mcts
\ No newline at end of file
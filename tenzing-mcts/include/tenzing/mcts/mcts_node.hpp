@@ -14,7 +14,11 @@
 #include <martinmoene/optional.hpp>
 
 #include <algorithm>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace tenzing::mcts {
 
@@ -34,9 +38,69 @@ template <typename Strategy> struct Node {
   using Context = typename Strategy::Context;
   using State = typename Strategy::State;
 
-  Node *parent_;
-  std::vector<Node> children_;
+  /* nodes already in the tree, by SDP::State::transposition_fingerprint() of their state.
+     Different decision orders that reach an equivalent state share a node, so the tree is a DAG
+  */
+  typedef std::unordered_map<SDP::Fingerprint, std::weak_ptr<Node>, SDP::Fingerprint::Hash>
+      Transpositions;
+
+  /* the children of a node, iterated as Node&.
+     With a transposition table, a child may be shared with other parents
+  */
+  class Children {
+    typedef std::vector<std::shared_ptr<Node>> vector_type;
+    vector_type nodes_;
+
+  public:
+    template <typename V> class iterator_t {
+      typename vector_type::const_iterator it_;
+
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef V value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef V *pointer;
+      typedef V &reference;
+
+      explicit iterator_t(typename vector_type::const_iterator it) : it_(it) {}
+      V &operator*() const { return **it_; }
+      V *operator->() const { return it_->get(); }
+      iterator_t &operator++() {
+        ++it_;
+        return *this;
+      }
+      bool operator==(const iterator_t &rhs) const { return it_ == rhs.it_; }
+      bool operator!=(const iterator_t &rhs) const { return it_ != rhs.it_; }
+    };
+    typedef iterator_t<Node> iterator;
+    typedef iterator_t<const Node> const_iterator;
+
+    iterator begin() { return iterator(nodes_.begin()); }
+    iterator end() { return iterator(nodes_.end()); }
+    const_iterator begin() const { return const_iterator(nodes_.begin()); }
+    const_iterator end() const { return const_iterator(nodes_.end()); }
+    size_t size() const { return nodes_.size(); }
+    bool empty() const { return nodes_.empty(); }
+    Node &operator[](size_t i) { return *nodes_[i]; }
+    const Node &operator[](size_t i) const { return *nodes_[i]; }
+
+    bool contains(const Node *node) const {
+      for (const std::shared_ptr<Node> &n : nodes_) {
+        if (n.get() == node) {
+          return true;
+        }
+      }
+      return false;
+    }
+    void push_back(const std::shared_ptr<Node> &node) { nodes_.push_back(node); }
+  };
+
+  Node *parent_;               // the node that created this one
+  std::vector<Node *> parents_; // all nodes that have this one as a child
+  Node *via_; // the parent this node was most recently selected through, for backprop
+  Children children_;
   Optional<std::shared_ptr<BoundOp>> op_;
+  Sequence<BoundOp> sequence_; // get_sequence(), sharing its prefix with parent_'s
   bool expanded_;
   bool fullyVisited_;   // if this subtree fully expanded
   float valueEstimate_; // an estimate of this node's value if it doesn't have enough playouts
@@ -47,17 +111,24 @@ template <typename Strategy> struct Node {
   // state required for whatever the strategy is
   State state_;
 
+  // shared by all nodes in the tree, or null if transpositions are not tracked
+  std::shared_ptr<Transpositions> transpositions_;
+
+  // how create_children() synchronizes operations, the same for all nodes in the tree
+  SyncPolicy syncPolicy_ = SyncPolicy::event;
+
   Node(const Graph<OpBase> &graph, const std::shared_ptr<BoundOp> &op)
-      : parent_(nullptr), op_(op), expanded_(false), fullyVisited_(false),
+      : parent_(nullptr), via_(nullptr), op_(op), sequence_({op}), expanded_(false),
+        fullyVisited_(false),
         valueEstimate_(std::numeric_limits<float>::infinity()), // estimate an infinite value before
                                                                 // a child is visited
         n_(0), graph_(graph) {}
   Node(const Graph<OpBase> &graph)
-      : parent_(nullptr), expanded_(false), fullyVisited_(false),
+      : parent_(nullptr), via_(nullptr), expanded_(false), fullyVisited_(false),
         valueEstimate_(std::numeric_limits<float>::infinity()), n_(0), graph_(graph) {}
   Node() : Node(Graph<OpBase>()) {}
 
-  // subtree size (including this one)
+  // subtree size (including this one). Nodes shared by several parents are counted once
   size_t size() const;               // how many nodes
   size_t unvisited_size() const;     // how nodes without a rollout
   size_t fully_visited_size() const; // how many fully-visited nodes
@@ -79,7 +150,7 @@ template <typename Strategy> struct Node {
   // optionally expand nodes in the tree along the way
   RolloutResult get_rollout(Platform &plat, bool expand = true);
 
-  // backpropagate results up the tree.
+  // backpropagate results up the path that was selected to reach this node.
   // invokes Strategy::backprop
   void backprop(Context &ctx, const Benchmark::Result &br);
 
@@ -91,7 +162,8 @@ template <typename Strategy> struct Node {
   std::string graphviz_label() const;
   std::string graphviz_name() const;
 
-  // get the sequence through the tree to get here (including this node)
+  // get the sequence through the tree to get here (including this node), following the nodes
+  // that created each node
   Sequence<BoundOp> get_sequence() const;
 
   /// \brief short description of node
@@ -99,7 +171,13 @@ template <typename Strategy> struct Node {
 
 private:
   // create all the children of a node
-  std::vector<Node> create_children(Platform &plat, bool quiet = false);
+  Children create_children(Platform &plat, bool quiet = false);
+
+  // call f once for each node in this subtree
+  template <typename F> void for_each_unique(F f) const;
+
+  // mark this node fully visited if all its children are
+  void update_fully_visited();
 
   // create children, and attach to node
   void ensure_children(Platform &plat);
@@ -114,7 +192,8 @@ private:
 */
 std::vector<std::shared_ptr<BoundOp>>
 get_frontier(Platform &plat, const Graph<OpBase> &g,
-             const std::vector<std::shared_ptr<BoundOp>> &completed);
+             const std::vector<std::shared_ptr<BoundOp>> &completed,
+             SyncPolicy policy = SyncPolicy::event);
 
 template <typename Strategy> bool Node<Strategy>::is_terminal() const {
 
@@ -133,27 +212,38 @@ template <typename Strategy> bool Node<Strategy>::is_leaf() const {
   return false;
 }
 
-template <typename Strategy> size_t Node<Strategy>::size() const {
-  size_t acc = 1; // this node
-  for (const auto &child : children_) {
-    acc += child.size();
+template <typename Strategy>
+template <typename F>
+void Node<Strategy>::for_each_unique(F f) const {
+  std::unordered_set<const Node *> seen;
+  std::vector<const Node *> worklist{this};
+  while (!worklist.empty()) {
+    const Node *node = worklist.back();
+    worklist.pop_back();
+    if (seen.insert(node).second) {
+      f(*node);
+      for (const Node &child : node->children_) {
+        worklist.push_back(&child);
+      }
+    }
   }
+}
+
+template <typename Strategy> size_t Node<Strategy>::size() const {
+  size_t acc = 0;
+  for_each_unique([&](const Node &) { ++acc; });
   return acc;
 }
 
 template <typename Strategy> size_t Node<Strategy>::unvisited_size() const {
-  size_t acc = 0 == n_ ? 1 : 0; // this node
-  for (const auto &child : children_) {
-    acc += child.unvisited_size();
-  }
+  size_t acc = 0;
+  for_each_unique([&](const Node &node) { acc += 0 == node.n_ ? 1 : 0; });
   return acc;
 }
 
 template <typename Strategy> size_t Node<Strategy>::fully_visited_size() const {
-  size_t acc = fullyVisited_ ? 1 : 0; // this node
-  for (const auto &child : children_) {
-    acc += child.fully_visited_size();
-  }
+  size_t acc = 0;
+  for_each_unique([&](const Node &node) { acc += node.fullyVisited_ ? 1 : 0; });
   return acc;
 }
 
@@ -236,6 +326,7 @@ template <typename Strategy> Node<Strategy> &Node<Strategy>::select(Context &ctx
       STDERR("selected " << children_[im].desc() << " uct=" << m);
     }
 
+    children_[im].via_ = this;
     return children_[im].select(ctx);
   }
 #else
@@ -317,6 +408,7 @@ template <typename Strategy> Node<Strategy> &Node<Strategy>::select(Context &ctx
     if (0 == children_[im].n_) {
       return *this;
     } else {
+      children_[im].via_ = this;
       return children_[im].select(ctx);
     }
   }
@@ -327,6 +419,19 @@ template <typename Strategy>
 void Node<Strategy>::backprop(Context &ctx, const Benchmark::Result &br) {
   ++n_; // additional playout
 
+  update_fully_visited();
+
+  Strategy::backprop(ctx, *this, br);
+  if (via_) {
+    via_->backprop(ctx, br);
+  }
+}
+
+template <typename Strategy> void Node<Strategy>::update_fully_visited() {
+  if (fullyVisited_) {
+    return;
+  }
+
   if (children_.empty()) {
     if (expanded_) {
       fullyVisited_ = expanded_;
@@ -343,9 +448,11 @@ void Node<Strategy>::backprop(Context &ctx, const Benchmark::Result &br) {
     }
   }
 
-  Strategy::backprop(ctx, *this, br);
-  if (parent_) {
-    parent_->backprop(ctx, br);
+  // a parent that is not on the current backprop path would not see this otherwise
+  if (fullyVisited_) {
+    for (Node *parent : parents_) {
+      parent->update_fully_visited();
+    }
   }
 }
 
@@ -361,9 +468,23 @@ template <typename Strategy> Node<Strategy> &Node<Strategy>::expand(Platform &pl
     // first unplayed node
     for (auto &child : children_) {
       if (0 == child.n_) {
+        child.via_ = this;
         return child;
       }
     }
+    // the children may all be shared with other parents and already played.
+    // prefer the least-played one that still has orderings to visit
+    if (transpositions_) {
+      Node *least = &children_[0];
+      for (auto &child : children_) {
+        if (std::make_pair(child.fullyVisited_, child.n_) <
+            std::make_pair(least->fullyVisited_, least->n_)) {
+          least = &child;
+        }
+      }
+      least->via_ = this;
+      return *least;
+    }
     THROW_RUNTIME("expand called on non-leaf node (has children, but no unplayed children)");
   }
 }
@@ -392,36 +513,41 @@ typename Node<Strategy>::RolloutResult Node<Strategy>::get_rollout(Platform &pla
     STDERR("get_rollout");
   }
 
-  // if we don't expand, expand/traverse subtree in a copy of this node that will be
+  // if we don't expand, expand/traverse unexpanded nodes in copies that will be
   // discarded when this function returns.
   // Otherwise, just expand/traverse the subtree in this node so it persists in the tree
-  Node copy;
-  Node *currNode = nullptr;
-  if (expand) {
-    currNode = this;
-  } else {
-    copy = *this;
-    currNode = &copy;
-  }
+  std::vector<std::shared_ptr<Node>> copies;
+  Node *prevNode = parent_;
+  Node *currNode = this;
 
   while (currNode) {
+    if (!expand && !currNode->expanded_) {
+      copies.push_back(std::make_shared<Node>(*currNode));
+      currNode = copies.back().get();
+      currNode->transpositions_ = nullptr; // don't link the tree to discarded nodes
+    }
+
     // if expanded the tree, backprop from the new leaf.
     if (expand) {
       res.backpropStart = currNode;
     }
 
-    // add current node to path
-    if (currNode->op_)
-      res.sequence.push_back(*(currNode->op_));
+    // the path to the current node. A node shared with another parent continues the sequence
+    // that created it
+    res.sequence = currNode->get_sequence();
 
     // create children
     currNode->ensure_children(plat);
 
     // select from children at random
+    prevNode = currNode;
     if (currNode->children_.empty()) {
       currNode = nullptr;
     } else {
       currNode = &currNode->children_[rand() % currNode->children_.size()];
+      if (expand) {
+        currNode->via_ = prevNode;
+      }
     }
   }
 
@@ -512,28 +638,57 @@ template <typename Strategy> std::string Node<Strategy>::graphviz_name() const {
 }
 
 template <typename Strategy>
-std::vector<Node<Strategy>> Node<Strategy>::create_children(Platform &plat, bool quiet) {
-  std::vector<Node<Strategy>> children;
-
-  // get the path we took to be here
-  Sequence<BoundOp> path = get_sequence();
+typename Node<Strategy>::Children Node<Strategy>::create_children(Platform &plat, bool quiet) {
+  Children children;
 
-  // construct sequential decision state
-  SDP::State sdpState(graph_, path);
+  // construct sequential decision state from the path we took to be here
+  SDP::State sdpState(graph_, sequence_);
+  sdpState.set_sync_policy(syncPolicy_);
 
   // get all possible decisions to make at this state
-  std::vector<std::shared_ptr<Decision>> decisions = sdpState.get_decisions(plat, quiet);
+  std::vector<Decision> decisions = sdpState.get_decisions(plat, quiet);
 
   // create child nodes in
   for (const auto &decision : decisions) {
 
-    SDP::State cState = sdpState.apply(*decision);
+    SDP::State cState = sdpState.apply(decision);
+
+    // link to an existing node for an equivalent state
+    SDP::Fingerprint key;
+    if (transpositions_) {
+      key = cState.transposition_fingerprint();
+      typename Transpositions::iterator it = transpositions_->find(key);
+      if (transpositions_->end() != it) {
+        if (std::shared_ptr<Node> existing = it->second.lock()) {
+          if (!children.contains(existing.get())) {
+            STDERR(decision.desc() << " reaches existing " << existing->desc());
+            existing->parents_.push_back(this);
+            children.push_back(existing);
+          }
+          continue;
+        }
+      }
+    }
 
-    if (auto eo = std::dynamic_pointer_cast<ExecuteOp>(decision)) {
-      children.push_back(Node(cState.graph(), eo->op));
+    std::shared_ptr<Node> child;
+    if (const ExecuteOp *eo = decision.get_if<ExecuteOp>()) {
+      child = std::make_shared<Node>(cState.graph(), eo->op);
     } else { // otherwise, include just the revised graph
-      children.push_back(Node(cState.graph()));
+      child = std::make_shared<Node>(cState.graph());
     }
+    child->parent_ = this;
+    child->sequence_ = sequence_;
+    if (child->op_) {
+      child->sequence_.push_back(*child->op_);
+    }
+    child->parents_.push_back(this);
+    child->via_ = this;
+    child->transpositions_ = transpositions_;
+    child->syncPolicy_ = syncPolicy_;
+    if (transpositions_) {
+      (*transpositions_)[key] = child;
+    }
+    children.push_back(child);
   }
 
   return children;
@@ -552,15 +707,7 @@ template <typename Strategy> void Node<Strategy>::ensure_children(Platform &plat
 }
 
 template <typename Strategy> Sequence<BoundOp> Node<Strategy>::get_sequence() const {
-  Sequence<BoundOp> seq;
-  const Node *current = this;
-  while (current) {
-    if (op_)
-      seq.push_back(*(current->op_));
-    current = current->parent_;
-  }
-  std::reverse(seq.begin(), seq.end());
-  return seq;
+  return sequence_;
 }
 
 template <typename Strategy> std::string Node<Strategy>::desc() const {
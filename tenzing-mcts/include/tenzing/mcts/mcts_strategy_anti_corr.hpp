@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -18,35 +20,27 @@ struct AntiCorrelation {
 
   struct Context : public StrategyContext {}; // unused
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
   };
   const static int nBins = 10;
 
-  static std::vector<uint64_t> histogram(const std::vector<double> &v,
+  static std::vector<uint64_t> histogram(const QuantileSketch &v,
                                          const double tMin, // low end of small bin
                                          const double tMax  // high end of large bin
   ) {
-    std::vector<uint64_t> hist(nBins, 0);
-
-    for (double e : v) {
-      size_t i = (e - tMin) / (tMax - tMin) * nBins;
-      if (i >= nBins)
-        i = nBins - 1;
-      ++hist[i];
-    }
-    return hist;
+    return v.histogram(nBins, tMin, tMax);
   }
 
   // assign a value proportional to how much of the
   // space between the slowest and fastest run this child represents
   static double select(const Context &, const MyNode &parent, const MyNode &child) {
     double v;
-    if (parent.state_.times.size() < 2 || child.state_.times.size() < 2) {
+    if (parent.state_.times.count() < 2 || child.state_.times.count() < 2) {
       v = 0;
     } else {
 
-      double tMin = std::min(*parent.state_.times.begin(), *child.state_.times.begin());
-      double tMax = std::max(parent.state_.times.back(), child.state_.times.back());
+      double tMin = std::min(parent.state_.times.min(), child.state_.times.min());
+      double tMax = std::max(parent.state_.times.max(), child.state_.times.max());
 
       // score children by inverse correlation with parent
       auto pHist = histogram(parent.state_.times, tMin, tMax);
@@ -81,10 +75,7 @@ struct AntiCorrelation {
 
   static void backprop(Context &, MyNode &node, const Benchmark::Result &br) {
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
-
-    // order times smallest to largest
-    std::sort(node.state_.times.begin(), node.state_.times.end());
+    node.state_.times.insert(elapsed);
   }
 };
 
@@ -8,6 +8,8 @@
 #include <algorithm>
 #include <limits>
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -22,7 +24,7 @@ struct AvgTime {
   struct Context : public StrategyContext {};
 
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
     double tMin;
     double tMax;
     State()
@@ -37,24 +39,23 @@ struct AvgTime {
     if (child.n_ < 1 || root.n_ < 2) {
       return 0;
     } else {
-      double acc = 0;
-      for (double t : child.state_.times) {
-        double v = (t - root.state_.tMin) / (root.state_.tMax - root.state_.tMin);
-        v = 1 - v;
-        if (v < 0)
-          v = 0;
-        if (v > 1)
-          v = 1;
-        acc += v;
-      }
-      return acc / child.state_.times.size();
+      // every time through the child also went through the root, so none is outside its range
+      // and the average of the mapped times is the mapped average
+      double v = (child.state_.times.mean() - root.state_.tMin) /
+                 (root.state_.tMax - root.state_.tMin);
+      v = 1 - v;
+      if (v < 0)
+        v = 0;
+      if (v > 1)
+        v = 1;
+      return v;
     }
   }
 
   static void backprop(Context & /*ctx*/, MyNode &node, const Benchmark::Result &br) {
     node.state_.tMin = std::min(br.pct10, node.state_.tMin);
     node.state_.tMax = std::max(br.pct10, node.state_.tMax);
-    node.state_.times.push_back(br.pct10);
+    node.state_.times.insert(br.pct10);
   }
 };
 
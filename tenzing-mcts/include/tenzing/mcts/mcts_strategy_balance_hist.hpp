@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -22,24 +24,16 @@ struct BalanceHistogram {
   }; // unused
 
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
   };
 
   const static int nBins = 10;
 
-  static std::vector<uint64_t> histogram(const std::vector<double> &v,
+  static std::vector<uint64_t> histogram(const QuantileSketch &v,
                                          const double tMin, // low end of small bin
                                          const double tMax  // high end of large bin
   ) {
-    std::vector<uint64_t> hist(nBins, 0);
-
-    for (double e : v) {
-      size_t i = (e - tMin) / (tMax - tMin) * nBins;
-      if (i >= nBins)
-        i = nBins - 1;
-      ++hist[i];
-    }
-    return hist;
+    return v.histogram(nBins, tMin, tMax);
   }
 
   // value children who have the most runs that can balance parent histogram bin sizes
@@ -47,7 +41,7 @@ struct BalanceHistogram {
   // figure out which child has the largest proportion of its runs fall into that bin
   // score the child relative to that largest proportion number
   static double select(const Context &ctx, const MyNode &parent, const MyNode &child) {
-    if (parent.state_.times.size() < 1 || child.state_.times.size() < 1) {
+    if (parent.state_.times.empty() || child.state_.times.empty()) {
       return 0;
     } else {
 #if 0
@@ -128,8 +122,8 @@ struct BalanceHistogram {
 
 #if 1
 
-      double tMin = *ctx.root->state_.times.begin();
-      double tMax = ctx.root->state_.times.back();
+      double tMin = ctx.root->state_.times.min();
+      double tMax = ctx.root->state_.times.max();
       auto rHist = histogram(ctx.root->state_.times, tMin, tMax);
       auto cHist = histogram(child.state_.times, tMin, tMax);
 
@@ -184,17 +178,14 @@ struct BalanceHistogram {
 
       STDERR(smallest << " " << largest << " " << need);
       return need;
-      // return need * double(cHist[smallest]) / child.state_.times.size(); // makes things worse?
+      // return need * double(cHist[smallest]) / child.state_.times.count(); // makes things worse?
 #endif
     }
   }
 
   static void backprop(Context &ctx, MyNode &node, const Benchmark::Result &br) {
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
-
-    // order times smallest to largest
-    std::sort(node.state_.times.begin(), node.state_.times.end());
+    node.state_.times.insert(elapsed);
 
     // tell my parent to do the same
     if (!node.parent_) {
@@ -7,6 +7,8 @@
 
 #include <limits>
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -28,46 +30,52 @@ struct Coverage {
 
   // State of the node
   struct State : public StrategyState {
-    std::vector<double> times; // the times of all runs from this node
+    QuantileSketch times; // the times of all runs from this node
   };
 
-  const static int loPct = 0;
   const static int hiPct = 100;
 
+  // the fastest time, which the sketch keeps exactly (a low quantile may be above it)
+  static double lo(const QuantileSketch &times) { return times.min(); }
+  // the hiPct percentile of times
+  static double hi(const QuantileSketch &times) {
+    return hiPct >= 100 ? times.max() : times.quantile(hiPct / 100.0);
+  }
+
   // assign a value proportional to how much of the parent's slow-fast distance
   // the child covers
   static double select(const Context &, const MyNode &child) {
 
     const MyNode &parent = *(child.parent_);
 
-    if (parent.state_.times.size() < 2) {
+    if (parent.state_.times.count() < 2) {
       return 1; // if the parent doesn't have enough runs, assume the child just covers it
-    } else if (child.state_.times.size() < 1) {
+    } else if (child.state_.times.empty()) {
       // if the child has no runs, assume the child covers the parent
 
       // FIXME, this should be the parent's runs at the time
       return 1;
-    } else if (child.state_.times.size() < 2) {
-      double pMax = parent.state_.times[parent.state_.times.size() * hiPct / 100 - 1];
-      double pMin = parent.state_.times[parent.state_.times.size() * loPct / 100];
+    } else if (child.state_.times.count() < 2) {
+      double pMax = hi(parent.state_.times);
+      double pMin = lo(parent.state_.times);
 
       // parent min and max may represent the same rollout and get the same time
       if (pMin == pMax) {
         return 1;
       }
 
-      double v =
-          std::max(child.state_.times[0] - pMin, pMax - child.state_.times[0]) / (pMax - pMin);
+      double t = child.state_.times.min(); // its only time
+      double v = std::max(t - pMin, pMax - t) / (pMax - pMin);
       if (v < 0)
         v = 0;
       if (v > 1)
         v = 1;
       return v;
     } else {
-      double cMax = child.state_.times[child.state_.times.size() * hiPct / 100 - 1];
-      double cMin = child.state_.times[child.state_.times.size() * loPct / 100];
-      double pMax = parent.state_.times[parent.state_.times.size() * hiPct / 100 - 1];
-      double pMin = parent.state_.times[parent.state_.times.size() * loPct / 100];
+      double cMax = hi(child.state_.times);
+      double cMin = lo(child.state_.times);
+      double pMax = hi(parent.state_.times);
+      double pMin = lo(parent.state_.times);
 
       // parent min and max may represent the same rollout and get the same time
       if (pMin == pMax) {
@@ -86,17 +94,12 @@ struct Coverage {
   static void backprop(Context &ctx, MyNode &node, const Benchmark::Result &br) {
 
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
-
-    // order times smallest to largest
-    std::sort(node.state_.times.begin(), node.state_.times.end());
+    node.state_.times.insert(elapsed);
 
     // keep track of a window of central values to compare speeds against
     if (!node.parent_) {
-      size_t loi = node.state_.times.size() * loPct / 100;
-      size_t hii = node.state_.times.size() * hiPct / 100 - 1;
-      ctx.minT = node.state_.times[loi];
-      ctx.maxT = node.state_.times[hii];
+      ctx.minT = lo(node.state_.times);
+      ctx.maxT = hi(node.state_.times);
     }
   }
 };
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -20,40 +22,32 @@ struct NormalizedAntiCorrelation {
     MyNode *root;
   };
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
   };
 
   const static int nBins = 10;
 
-  static std::vector<uint64_t> histogram(const std::vector<double> &v,
+  static std::vector<uint64_t> histogram(const QuantileSketch &v,
                                          const double tMin, // low end of small bin
                                          const double tMax  // high end of large bin
   ) {
-    std::vector<uint64_t> hist(nBins, 0);
-
-    for (double e : v) {
-      size_t i = (e - tMin) / (tMax - tMin) * nBins;
-      if (i >= nBins)
-        i = nBins - 1;
-      ++hist[i];
-    }
-    return hist;
+    return v.histogram(nBins, tMin, tMax);
   }
 
   // assign a value proportional to how much of the
   // space between the slowest and fastest run this child represents
   static double select(const Context &ctx, const MyNode &parent, const MyNode &child) {
-    if (parent.state_.times.size() < 2 || child.state_.times.size() < 2) {
+    if (parent.state_.times.count() < 2 || child.state_.times.count() < 2) {
       return 0;
     } else {
 
 #if 0
-            double tMin = *parent.state_.times.begin();
-            double tMax = parent.state_.times.back();
+            double tMin = parent.state_.times.min();
+            double tMax = parent.state_.times.max();
             auto pHist = histogram(parent.state_.times, tMin, tMax);
 #else
-      double tMin = *ctx.root->state_.times.begin();
-      double tMax = ctx.root->state_.times.back();
+      double tMin = ctx.root->state_.times.min();
+      double tMax = ctx.root->state_.times.max();
       auto pHist = histogram(ctx.root->state_.times, tMin, tMax);
 #endif
       std::vector<double> anticorrs;
@@ -99,10 +93,7 @@ struct NormalizedAntiCorrelation {
 
   static void backprop(Context &ctx, MyNode &node, const Benchmark::Result &br) {
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
-
-    // order times smallest to largest
-    std::sort(node.state_.times.begin(), node.state_.times.end());
+    node.state_.times.insert(elapsed);
 
     if (!node.parent_) {
       ctx.root = &node;
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -24,7 +26,7 @@ struct Random {
   };
 
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
   };
 
   // assign a value proportional to how many children the child has
@@ -45,7 +47,7 @@ struct Random {
 
   static void backprop(Context &ctx, MyNode &node, const Benchmark::Result &br) {
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
+    node.state_.times.insert(elapsed);
 
     if (!node.parent_) {
       // once backprop to root, clear assignment before next traversal
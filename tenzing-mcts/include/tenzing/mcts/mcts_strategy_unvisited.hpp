@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "tenzing/quantile_sketch.hpp"
+
 #include "mcts_node.hpp"
 #include "mcts_strategy.hpp"
 
@@ -19,7 +21,7 @@ struct Unvisited {
   struct Context : public StrategyContext {};
 
   struct State : public StrategyState {
-    std::vector<double> times;
+    QuantileSketch times;
   };
 
   // assign a value proportional to how many children the child has
@@ -32,7 +34,7 @@ struct Unvisited {
 
   static void backprop(Context &, MyNode &node, const Benchmark::Result &br) {
     double elapsed = br.pct10;
-    node.state_.times.push_back(elapsed);
+    node.state_.times.insert(elapsed);
   }
 };
 } // namespace tenzing::mcts
\ No newline at end of file
@@ -4,6 +4,7 @@
  */
 
 #include "tenzing/operation_serdes.hpp"
+#include "tenzing/result_file.hpp"
 #include "tenzing/schedule.hpp"
 
 #include "tenzing/mcts/mcts.hpp"
@@ -30,4 +31,12 @@ void Result::dump_csv() const {
   }
 }
 
+void Result::dump_results(const std::string &path) const {
+  ResultFileWriter writer;
+  for (const SimResult &simres : simResults) {
+    writer.add(simres.benchResult, simres.path);
+  }
+  writer.write(path);
+}
+
 } // namespace tenzing::mcts
@@ -6,7 +6,9 @@
 #include "tenzing/operation.hpp"
 #include "tenzing/cuda/ops_cuda.hpp"
 #include "tenzing/sequence.hpp"
-#include "tenzing/event_synchronizer.hpp"
+#include "tenzing/happens_before.hpp"
+#include "tenzing/ready_set.hpp"
+#include "tenzing/sync_policy.hpp"
 
 #include "tenzing/mcts/mcts_node.hpp"
 
@@ -36,8 +38,7 @@
 */
 std::vector<std::shared_ptr<BoundOp>>
 get_frontier(Platform &plat, const Graph<OpBase> &g,
-             const Sequence<BoundOp> &completed) {
-  typedef EventSynchronizer Synchronizer;
+             const Sequence<BoundOp> &completed, SyncPolicy policy = SyncPolicy::event) {
   /*
   find candidate operations for the frontier
       all predecessors in `completed`
@@ -52,60 +53,10 @@ get_frontier(Platform &plat, const Graph<OpBase> &g,
     STDERR(ss.str());
   }
 
-  STDERR("consider ops with >= 1 pred completed...");
-  std::vector<std::shared_ptr<OpBase>> onePredCompleted;
-  for (const auto &cOp : completed) {
-    STDERR("...succs of " << cOp->desc() << " (@" << cOp.get() << ")");
-
-    // some nodes in the path will not be in the graph (inserted syncs)
-    // other nodes in the path are bound versions of that in the graph
-
-    auto it = g.succs_find_or_find_unbound(cOp);
-    if (g.succs_.end() != it) {
-
-      // all successors of a completed op have at least one pred completed
-      for (const auto &succ : it->second) {
-        // don't add duplicates
-        if (onePredCompleted.end() ==
-            std::find(onePredCompleted.begin(), onePredCompleted.end(), succ)) {
-          onePredCompleted.push_back(succ);
-        }
-      }
-    }
-  }
-
-  {
-    std::stringstream ss;
-    ss << "one pred completed: ";
-    for (const auto &op : onePredCompleted) {
-      ss << op->desc() << ",";
-    }
-    STDERR(ss.str());
-  }
-
-  STDERR("reject ops already done or with incomplete preds...");
   std::vector<std::shared_ptr<OpBase>> candidates;
-  for (const auto &cOp : onePredCompleted) {
-    // reject ops that we've already done
-    if (completed.contains_unbound(cOp)) {
-      STDERR(cOp->name() << " already done");
-      continue;
-    }
-
-    // reject ops that all preds are not done
-    bool allPredsCompleted = true;
-    for (const auto &pred : g.preds_.at(cOp)) {
-      if (!completed.contains_unbound(pred)) {
-        STDERR(cOp->name() << " missing pred " << pred->name());
-        allPredsCompleted = false;
-        break;
-      }
-    }
-    if (!allPredsCompleted) {
-      STDERR(cOp->name() << " missing a pred");
-      continue;
-    }
-    candidates.push_back(cOp);
+  SDP::ReadySet ready(g, completed);
+  for (Graph<OpBase>::vid_t v : ready.ready()) {
+    candidates.push_back(g.op(v));
   }
 
   {
@@ -118,6 +69,7 @@ get_frontier(Platform &plat, const Graph<OpBase> &g,
   }
 
   std::vector<std::shared_ptr<BoundOp>> frontier;
+  const HappensBefore hb(completed);
 
   STDERR("generate frontier from candidates...");
   // candidates may or may not be assigned to resources
@@ -129,12 +81,12 @@ get_frontier(Platform &plat, const Graph<OpBase> &g,
 
     for (const std::shared_ptr<BoundOp> &bound : bounds) {
       // if the candidate is already synchronized with its preds, it can be added to the frontier
-      if (Synchronizer::is_synced(bound, g, completed)) {
+      if (is_synced(bound, g, hb)) {
         STDERR("variation of " << bound->desc() << " is synced");
         frontier.push_back(bound);
       } else { // otherwise synchronizers should be added instead
         STDERR("variation of " << bound->desc() << " is not synced with preds");
-        std::vector<std::shared_ptr<BoundOp>> syncs = Synchronizer::make_syncs(bound, g, completed);
+        std::vector<std::shared_ptr<BoundOp>> syncs = make_syncs(policy, bound, g, hb);
         STDERR("adding synchronizers for " << bound->desc() << " to frontier:");
         for (const auto &sync : syncs) {
           STDERR(sync->desc());
@@ -0,0 +1,60 @@
+#include <doctest/doctest.hpp>
+
+#include "tenzing/compiled_sequence.hpp"
+#include "tenzing/platform.hpp"
+#include "tenzing/test_ops.hpp"
+
+using test_ops::Count;
+using test_ops::Kernel;
+
+TEST_CASE("[gpu]" " " "compiled sequence") {
+
+  typedef CompiledSequence::Instr::Kind Kind;
+
+  Platform plat = Platform::make_n_streams(2, MPI_COMM_WORLD);
+  CudaEventPool pool;
+  plat.resource_map().insert(Event(0), pool.new_event());
+  plat.resource_map().insert(Event(1), pool.new_event());
+
+  std::vector<cudaStream_t> launches;
+  int count = 0;
+  auto a = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("a", &launches), Stream(0));
+  auto b = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("b", &launches), Stream(1));
+
+  Sequence<BoundOp> seq({std::make_shared<Start>(), a,
+                         std::make_shared<CudaEventRecord>(Event(0), Stream(0)),
+                         std::make_shared<CudaStreamWaitEvent>(Stream(1), Event(0)), b,
+                         std::make_shared<NoOp>("noop"), std::make_shared<Count>(&count),
+                         std::make_shared<StreamWait>(Stream(1), Stream(0), Event(1)),
+                         std::make_shared<CudaEventSync>(Event(0)),
+                         std::make_shared<StreamSync>(Stream(1)), std::make_shared<Finish>()});
+
+  CompiledSequence cs = CompiledSequence::compile(seq, plat);
+  CHECK(cs.sequence().size() == seq.size());
+
+  // Start, NoOp, and Finish are dropped
+  const std::vector<CompiledSequence::Instr> &instrs = cs.instrs();
+  REQUIRE(instrs.size() == 8);
+  CHECK(instrs[0].kind == Kind::gpu);
+  CHECK(instrs[0].stream == plat.cuda_stream(Stream(0)));
+  CHECK(instrs[1].kind == Kind::event_record);
+  CHECK(instrs[1].event == plat.cuda_event(Event(0)));
+  CHECK(instrs[2].kind == Kind::stream_wait_event);
+  CHECK(instrs[2].stream == plat.cuda_stream(Stream(1)));
+  CHECK(instrs[3].kind == Kind::gpu);
+  CHECK(instrs[4].kind == Kind::host);
+  CHECK(instrs[5].kind == Kind::stream_wait);
+  CHECK(instrs[5].stream == plat.cuda_stream(Stream(1)));
+  CHECK(instrs[5].waiter == plat.cuda_stream(Stream(0)));
+  CHECK(instrs[5].event == plat.cuda_event(Event(1)));
+  CHECK(instrs[6].kind == Kind::event_sync);
+  CHECK(instrs[7].kind == Kind::stream_sync);
+
+  cs.run(plat);
+  cs.run(plat);
+  CHECK(count == 2);
+  CHECK(launches == std::vector<cudaStream_t>({plat.cuda_stream(Stream(0)),
+                                               plat.cuda_stream(Stream(1)),
+                                               plat.cuda_stream(Stream(0)),
+                                               plat.cuda_stream(Stream(1))}));
+}
@@ -28,10 +28,10 @@ public:
 };
 
 template <typename Dec>
-int count_occurances(const std::vector<std::shared_ptr<Decision>> &ds, const Dec &d) {
+int count_occurances(const std::vector<Decision> &ds, const Dec &d) {
   int count = 0;
-  for (const auto &dp : ds) {
-    if (auto casted = std::dynamic_pointer_cast<Dec>(dp)) {
+  for (const Decision &dp : ds) {
+    if (const Dec *casted = dp.get_if<Dec>()) {
       count += (*casted == d);
     }
   }
@@ -62,15 +62,16 @@ TEST_CASE("[gpu][mpi]" " " "graph with GpuOps") {
   CHECK(initialState.sequence().size() == 1);
 
   std::cerr << "initialState.get_decisions()...\n";
-  std::vector<std::shared_ptr<Decision>> decisions = initialState.get_decisions(plat);
+  std::vector<Decision> decisions = initialState.get_decisions(plat);
 
   for (const auto &dp : decisions) {
-    std::cerr << dp->desc() << "\n";
+    std::cerr << dp.desc() << "\n";
   }
 
-  // kernel 1 should be assigned to each stream
+  // no stream is used yet, so kernel 1 is only assigned to the first one
   CHECK(1 == count_occurances(decisions, AssignOpStream(kernel1, Stream(0))));
-  CHECK(1 == count_occurances(decisions, AssignOpStream(kernel1, Stream(1))));
+  CHECK(0 == count_occurances(decisions, AssignOpStream(kernel1, Stream(1))));
+  CHECK(1 == initialState.frontier(plat).size());
 
   
   SUBCASE("kernel1 in stream 0") {
@@ -90,6 +91,7 @@ TEST_CASE("[gpu][mpi]" " " "graph with GpuOps") {
       CHECK(true == bool(get_equivalence(tmp.graph(), state.graph())));
       STDERR("check state equivalence...");
       CHECK(true == bool(get_equivalence(tmp, state)));
+      CHECK(tmp.fingerprint() == state.fingerprint());
     }
 
     // graph should contain a bound version of kernel 1 with other unbound
@@ -100,7 +102,7 @@ TEST_CASE("[gpu][mpi]" " " "graph with GpuOps") {
     
     decisions = state.get_decisions(plat);
     for (const auto &dp : decisions) {
-      std::cerr << dp->desc() << "\n";
+      std::cerr << dp.desc() << "\n";
     }
 
     CHECK(1 == count_occurances(decisions, ExecuteOp(gkernel1)));
@@ -110,7 +112,7 @@ TEST_CASE("[gpu][mpi]" " " "graph with GpuOps") {
 
     decisions = state.get_decisions(plat);
     for (const auto &dp : decisions) {
-      std::cerr << dp->desc() << "\n";
+      std::cerr << dp.desc() << "\n";
     }
 
   }
@@ -0,0 +1,49 @@
+#include <doctest/doctest.hpp>
+
+#include "tenzing/compiled_sequence.hpp"
+#include "tenzing/platform.hpp"
+#include "tenzing/test_ops.hpp"
+#include "tenzing/trace.hpp"
+
+using test_ops::Count;
+using test_ops::Kernel;
+
+TEST_CASE("[gpu]" " " "trace gpu events") {
+  Platform plat = Platform::make_n_streams(1, MPI_COMM_WORLD);
+  int count = 0;
+  auto kernel = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("kernel"), Stream(0));
+  auto host = std::make_shared<Count>(&count);
+  CompiledSequence cs = CompiledSequence::compile(Sequence<BoundOp>({kernel, host}), plat);
+  Trace trace(2, 0, true);
+  cs.run(plat, trace);
+  std::vector<Trace::Record> records = trace.records();
+  REQUIRE(records.size() == 2);
+  CHECK(records[0].gpu >= 0); // from the events around the kernel
+  CHECK(records[1].gpu == -1);
+
+  Benchmark::Result launch;
+  std::map<std::string, Benchmark::Result> times = fit_op_times(cs, records, &launch);
+  CHECK(times.count("kernel") == 1);
+  CHECK(launch.nIters == 0);
+}
+
+TEST_CASE("[gpu]" " " "trace gpu without events") {
+  Platform plat = Platform::make_n_streams(1, MPI_COMM_WORLD);
+  auto kernel = std::make_shared<BoundGpuOp>(std::make_shared<Kernel>("kernel"), Stream(0));
+  CompiledSequence cs = CompiledSequence::compile(Sequence<BoundOp>({kernel}), plat);
+  Trace trace(10);
+  for (int i = 0; i < 10; ++i) {
+    cs.run(plat, trace);
+  }
+
+  // the host time of the kernel is only its launch
+  Benchmark::Result launch;
+  std::map<std::string, Benchmark::Result> times = fit_op_times(cs, trace.records(), &launch);
+  CHECK(times.empty());
+  CHECK(launch.nIters == 10);
+
+  SimulatedBenchmarker::Model model;
+  calibrate(model, times, &launch);
+  CHECK(model.times.empty());
+  CHECK(model.launch == launch.pct50);
+}
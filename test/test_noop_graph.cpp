@@ -20,14 +20,14 @@ TEST_CASE("[cpu]" " " "graph with no-op") {
   SDP::State initialState(graph);
   CHECK(initialState.sequence().size() == 1);
 
-  std::vector<std::shared_ptr<Decision>> decisions = initialState.get_decisions(plat);
+  std::vector<Decision> decisions = initialState.get_decisions(plat);
 
   // look for Execute op1 exactly once in the decisions
   {
     int count = 0;
     for (const auto &dp : decisions) {
-      std::cerr << dp->desc() << "\n";
-      if (auto eo = std::dynamic_pointer_cast<ExecuteOp>(dp)) {
+      std::cerr << dp.desc() << "\n";
+      if (const ExecuteOp *eo = dp.get_if<ExecuteOp>()) {
         count += (*eo == ExecuteOp(op1));
       }
     }
@@ -35,9 +35,9 @@ TEST_CASE("[cpu]" " " "graph with no-op") {
   }
 
   for (const auto &dp : decisions) {
-    std::cerr << dp->desc() << "\n";
+    std::cerr << dp.desc() << "\n";
 
-    SDP::State nextState = initialState.apply(*dp);
+    SDP::State nextState = initialState.apply(dp);
     CHECK(nextState.sequence().size() == 2);
   }
 }
\ No newline at end of file
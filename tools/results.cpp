@@ -0,0 +1,42 @@
+/* Copyright 2022 National Technology & Engineering Solutions of Sandia, LLC (NTESS). Under the
+ * terms of Contract DE-NA0003525 with NTESS, the U.S. Government retains certain rights in this
+ * software.
+ */
+
+/*! \file
+    \brief Convert search results between CSV and ResultFile
+
+    tenzing-results IN OUT
+
+    If IN is a ResultFile, write it to OUT as CSV (- for stdout).
+    Otherwise, IN is a CSV written by a search, and OUT will be a ResultFile.
+*/
+
+#include "tenzing/result_file.hpp"
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char **argv) {
+  if (3 != argc) {
+    std::cerr << "usage: " << argv[0] << " IN OUT\n";
+    return 1;
+  }
+  const std::string in = argv[1], out = argv[2];
+
+  if (ResultFile::is_result_file(in)) {
+    if ("-" == out) {
+      result_file_to_csv(in, std::cout);
+    } else {
+      std::ofstream os(out);
+      result_file_to_csv(in, os);
+      if (!os) {
+        std::cerr << "couldn't write " << out << "\n";
+        return 1;
+      }
+    }
+  } else {
+    csv_to_result_file(in, out);
+  }
+  return 0;
+}